@@ -30,6 +30,7 @@
 #include <math.h>
 #include <string.h>
 #include <heap.h>
+#include <time.h>
 
 using namespace LIBHeisenKernel;
 using namespace LIBHeisenKernel::Imaging;
@@ -37,7 +38,7 @@ using namespace LIBHeisenKernel::Imaging;
 extern uint8_t ConvertKeycode(KeypressPacket* packet); //In scancodes.cpp
 
 Compositor::Compositor()
-: dirtyRectList()
+: dirtyRectList(), damageList()
 {
     GUI::SetDefaultFont();
     
@@ -79,6 +80,9 @@ Compositor::Compositor()
     // Copy background to backbuffer, otherwise it contains noise at the start
     memcpy(this->backBuffer, this->backgroundBuffer, GUI::Width*GUI::Height*4);
 
+    // The first frame needs to draw the whole screen
+    AddDamage(Rectangle(GUI::Width, GUI::Height));
+
     Print("[Compositor] Requesting Systeminfo\n");
     if(!SystemInfo::RequestSystemInfo())
         return;
@@ -145,106 +149,175 @@ void Compositor::DrawCursor()
         }
 }
 
-// Instead of this function it is also possible to simply add a dirty rectangle for the cursor.
-// But the speed impact is so little that we don't really care about this.
-void Compositor::RemovePreviousCursor()
+void Compositor::AddDamage(Rectangle rect)
 {
-    // How much of the previous cursor should be removed?
-    // These values will be smaller than the cursor width when the mouse is partially in the corner
-    uint8_t x_d = this->prevMouseX + CURSOR_W < GUI::Width  ? CURSOR_W : GUI::Width  - this->prevMouseX;
-    uint8_t y_d = this->prevMouseY + CURSOR_H < GUI::Height ? CURSOR_H : GUI::Height - this->prevMouseY;
+    ApplyDesktopBounds(&rect);
+    if(rect.width <= 0 || rect.height <= 0)
+        return;
 
-    for(uint8_t x = 0; x < x_d; x++)
-        for(uint8_t y = 0; y < y_d; y++)
-            this->backBufferCanvas->SetPixel(this->prevMouseX + x, this->prevMouseY + y, this->backgroundCanvas->GetPixel(this->prevMouseX + x, this->prevMouseY + y));
+    // Merge with every rectangle it touches, this keeps the list free of overlapping areas
+    for(int i = 0; i < this->damageList.size(); )
+    {
+        Rectangle item = this->damageList[i];
+        if(rect.x > item.x + item.width || item.x > rect.x + rect.width || rect.y > item.y + item.height || item.y > rect.y + rect.height) {
+            i++;
+            continue;
+        }
+
+        int left = Math::Min(rect.x, item.x);
+        int top = Math::Min(rect.y, item.y);
+        int right = Math::Max(rect.x + rect.width, item.x + item.width);
+        int bottom = Math::Max(rect.y + rect.height, item.y + item.height);
+        rect = Rectangle(right - left, bottom - top, left, top);
+
+        // The bigger rectangle might touch ones we already checked
+        this->damageList.Remove(i);
+        i = 0;
+    }
+
+    // Too many small areas, just use one rectangle that covers all of them
+    if(this->damageList.size() >= COMPOSITOR_MAX_DAMAGE)
+    {
+        for(Rectangle item : this->damageList) {
+            int left = Math::Min(rect.x, item.x);
+            int top = Math::Min(rect.y, item.y);
+            int right = Math::Max(rect.x + rect.width, item.x + item.width);
+            int bottom = Math::Max(rect.y + rect.height, item.y + item.height);
+            rect = Rectangle(right - left, bottom - top, left, top);
+        }
+        this->damageList.Clear();
+    }
+
+    this->damageList.push_back(rect);
 }
 
-void Compositor::DrawFrame()
+bool Compositor::IsOccluded(int index, Rectangle area)
 {
-    // Check if we have valid values for prevMouseX/Y and check if the mouse has moved
-    if(this->prevMouseX != -1 && this->prevMouseY != -1 && (this->prevMouseX != this->curMouseX || this->prevMouseY != this->curMouseY))
-        RemovePreviousCursor();
-
-    // Update dirty rectangles by drawing the background image at every dirty rect position
-    for(Rectangle rect : dirtyRectList) 
+    // Only the contexts above this one can cover it
+    for(int i = 0; i < index; i++)
     {
-        //Print("[Compositor] Dirty Rectangle (%d,%d,%d,%d)\n", rect.x, rect.y, rect.width, rect.height);
+        ContextInfo* context = this->contextManager->contextList[i];
+        if(context->supportsTransparency)
+            continue;
+
+        if(area.x >= context->x && area.y >= context->y && area.x + area.width <= context->x + (int)context->width && area.y + area.height <= context->y + (int)context->height)
+            return true;
+    }
+    return false;
+}
+
+void Compositor::DrawContextArea(ContextInfo* context, Rectangle area)
+{
+    // Offset of the area within the context buffer
+    uint32_t leftOffset = area.x - context->x;
+    uint32_t topOffset = area.y - context->y;
+
+    // Check if context needs to be drawn using the transparency method
+    if(context->supportsTransparency) {
+        for(int y = 0; y < area.height; y++)
+            Colors::BlendSpan((uint32_t*)(this->backBuffer + (area.y + y)*GUI::Width*4 + area.x*4), (uint32_t*)(this->backgroundBuffer + (area.y + y)*GUI::Width*4 + area.x*4), (uint32_t*)(context->virtAddrServer + (topOffset+y)*context->width*4 + leftOffset*4), area.width);
+    }
+    else { // Otherwise we use the very optimized way of drawing
+        for(int hOffset = 0; hOffset < area.height; hOffset++)
+            memcpy((this->backBuffer + (area.y+hOffset)*GUI::Width*4 + area.x*4), (void*)(context->virtAddrServer + leftOffset*4 + (topOffset + hOffset)*context->width*4), area.width * 4);
+    }
+}
+
+void Compositor::DrawFrame()
+{
+    uint64_t frameStart = Time::Ticks();
 
-        ApplyDesktopBounds(&rect);
-        uint32_t byteWidth = (rect.width + rect.x <= GUI::Width ? rect.width : rect.width-(rect.x + rect.width - GUI::Width))*4;
-        for(uint32_t y = 0; y < (uint32_t)rect.height; y++)
-            memcpy((void*)(backBuffer + ((rect.y + y)*GUI::Width*4) + rect.x*4), (void*)((uint32_t)this->backgroundBuffer + (rect.y + y)*GUI::Width*4 + rect.x*4), byteWidth);
+    // The cursor is removed by redrawing whatever is below it
+    if(this->prevMouseX != this->curMouseX || this->prevMouseY != this->curMouseY) {
+        AddDamage(Rectangle(CURSOR_W, CURSOR_H, this->prevMouseX, this->prevMouseY));
+        AddDamage(Rectangle(CURSOR_W, CURSOR_H, this->curMouseX, this->curMouseY));
     }
+
+    // Areas damaged by the compositor itself, like removed or moved contexts
+    for(Rectangle rect : dirtyRectList) 
+        AddDamage(rect);
     dirtyRectList.Clear(); // After processing all the dirty rects for this frame, we can clear the list.
 
-    // Draw every context bottom to top since the contextList is organized that way
-    for(int i = (this->contextManager->contextList.size()-1); i >= 0; i--)
+    // Collect the damage reported by every context, damage hidden below opaque contexts is ignored
+    for(int i = 0; i < this->contextManager->contextList.size(); i++)
     {
         ContextInfo* context = this->contextManager->contextList[i];
-        if(context->x >= GUI::Width || context->y >= GUI::Height) {
-            Print("[Compositor] Warning! Context %d is out of desktop bounds\n", i);
-            continue; // Skip this context since it will not be visible anyway
-        }
 
-        // Context does not support dirty rectangles
+        // Context does not support dirty rectangles, so we don't know what changed
         if(!context->supportsDirtyRects) {
-            // Create rectangle for this context for easy calculations
             Rectangle contextRectangle = Rectangle(context->width, context->height, context->x, context->y);
             ApplyDesktopBounds(&contextRectangle);
-            
-            uint32_t leftOffset = ((context->x < 0) ? -context->x : 0);
-            uint32_t topOffset = ((context->y < 0) ? -context->y : 0);
-
-            // Check if context needs to be drawn using the transparency method
-            if(context->supportsTransparency) {
-                for(int y = 0; y < contextRectangle.height; y++)
-                    for(int x = 0; x < contextRectangle.width; x++)
-                        *(uint32_t*)(this->backBuffer + (contextRectangle.y + y)*GUI::Width*4 + (contextRectangle.x + x)*4) = Colors::AlphaBlend(*(uint32_t*)(this->backgroundBuffer + (contextRectangle.y + y)*GUI::Width*4 + (contextRectangle.x + x)*4), *(uint32_t*)(context->virtAddrServer + (topOffset+y)*context->width*4 + (leftOffset+x)*4));
-            }
-            else { // Otherwise we use the very optimized way of drawing
-                for(int hOffset = 0; hOffset < contextRectangle.height; hOffset++)
-                    memcpy((this->backBuffer + (contextRectangle.y+hOffset)*GUI::Width*4 + contextRectangle.x*4), (void*)(context->virtAddrServer + leftOffset*4 + (topOffset + hOffset)*context->width*4), contextRectangle.width * 4);
-            }
+            if(!IsOccluded(i, contextRectangle))
+                AddDamage(contextRectangle);
         }
         else if(context->numDirtyRects > 0)
         {
-            //Log(Info, "[Compositor] Drawing dirty rectangles for client");
             for(int dirtyIndex = 0; dirtyIndex < context->numDirtyRects; dirtyIndex++)
             {
-                // Create rectangle for this context for easy calculations
-                Rectangle contextRectangle = Rectangle(context->dirtyRects[dirtyIndex].width, context->dirtyRects[dirtyIndex].height, context->dirtyRects[dirtyIndex].x + context->x, context->dirtyRects[dirtyIndex].y + context->y);
-                ApplyDesktopBounds(&contextRectangle);
-                
-                uint32_t leftOffset = (context->dirtyRects[dirtyIndex].x);
-                uint32_t topOffset = (context->dirtyRects[dirtyIndex].y);
-
-                // Check if context needs to be drawn using the transparency method
-                if(context->supportsTransparency) {
-                    for(int y = 0; y < contextRectangle.height; y++)
-                        for(int x = 0; x < contextRectangle.width; x++)
-                            *(uint32_t*)(this->backBuffer + (contextRectangle.y + y)*GUI::Width*4 + (contextRectangle.x + x)*4) = Colors::AlphaBlend(*(uint32_t*)(this->backgroundBuffer + (contextRectangle.y + y)*GUI::Width*4 + (contextRectangle.x + x)*4), *(uint32_t*)(context->virtAddrServer + (topOffset+y)*context->width*4 + (leftOffset+x)*4));
-                }
-                else { // Otherwise we use the very optimized way of drawing
-                    for(int hOffset = 0; hOffset < contextRectangle.height; hOffset++)
-                        memcpy((this->backBuffer + (contextRectangle.y+hOffset)*GUI::Width*4 + contextRectangle.x*4), (void*)(context->virtAddrServer + leftOffset*4 + (topOffset + hOffset)*context->width*4), contextRectangle.width * 4);
-                }
+                Rectangle dirtyRectangle = Rectangle(context->dirtyRects[dirtyIndex].width, context->dirtyRects[dirtyIndex].height, context->dirtyRects[dirtyIndex].x + context->x, context->dirtyRects[dirtyIndex].y + context->y);
+                ApplyDesktopBounds(&dirtyRectangle);
+                if(!IsOccluded(i, dirtyRectangle))
+                    AddDamage(dirtyRectangle);
             }
             context->numDirtyRects = 0;
         }
+    }
+
+    // Redraw the damaged areas, drawing every context bottom to top since the contextList is organized that way
+    for(Rectangle rect : this->damageList)
+    {
+        //Print("[Compositor] Damaged Rectangle (%d,%d,%d,%d)\n", rect.x, rect.y, rect.width, rect.height);
+
+        if(!IsOccluded(this->contextManager->contextList.size(), rect))
+            for(int y = 0; y < rect.height; y++)
+                memcpy((void*)(backBuffer + ((rect.y + y)*GUI::Width*4) + rect.x*4), (void*)((uint32_t)this->backgroundBuffer + (rect.y + y)*GUI::Width*4 + rect.x*4), rect.width*4);
 
-        // Draw debug info for this context when we should
-        if(this->debugger->enabled)
-            this->debugger->ProcessContext(context);
+        for(int i = (this->contextManager->contextList.size()-1); i >= 0; i--)
+        {
+            ContextInfo* context = this->contextManager->contextList[i];
+
+            Rectangle area;
+            if(!rect.Intersect(Rectangle(context->width, context->height, context->x, context->y), &area))
+                continue;
+            
+            if(!IsOccluded(i, area))
+                DrawContextArea(context, area);
+        }
     }
+
     // Draw debug info when enabled
-    if(this->debugger->enabled)
+    if(this->debugger->enabled) {
+        for(int i = (this->contextManager->contextList.size()-1); i >= 0; i--)
+            this->debugger->ProcessContext(this->contextManager->contextList[i]);
+
         this->debugger->ProcessGeneral();
+    }
 
     // Finally draw the cursor to the backbuffer
     DrawCursor();
 
-    // Swap buffers, after this the frame is visible on the framebuffer
-    memcpy(DirectGUI::GetCanvas()->bufferPointer, this->backBuffer, GUI::Width*GUI::Height*4);
+    // Swap buffers, only the damaged areas are copied to the framebuffer
+    uint64_t swapStart = Time::Ticks();
+    uint8_t* frameBuffer = (uint8_t*)DirectGUI::GetCanvas()->bufferPointer;
+    this->bytesCopied = 0;
+    for(Rectangle rect : this->damageList)
+    {
+        for(int y = 0; y < rect.height; y++)
+            memcpy(frameBuffer + (rect.y + y)*GUI::Width*4 + rect.x*4, this->backBuffer + (rect.y + y)*GUI::Width*4 + rect.x*4, rect.width*4);
+        
+        this->bytesCopied += rect.width * rect.height * 4;
+    }
+    this->damageList.Clear();
+    this->swapTicks += Time::Ticks() - swapStart;
+
+    // Report swap time every COMPOSITOR_SWAP_REPORT frames
+    if(++this->swapFrames == COMPOSITOR_SWAP_REPORT) {
+        Print("[Compositor] Buffer swap took %d ms for the last %d frames\n", (uint32_t)this->swapTicks, COMPOSITOR_SWAP_REPORT);
+        this->swapTicks = 0;
+        this->swapFrames = 0;
+    }
+
+    this->frameTime = Time::Ticks() - frameStart;
 }
 
 void Compositor::ProcessEvents()
@@ -274,8 +347,10 @@ void Compositor::ProcessEvents()
 
             // If the mouse is held down on this context and it is not supposed to be in the background
             // Then we move the context to the front
-            if(mouseDown && !info->background)
+            if(mouseDown && !info->background) {
                 this->contextManager->MoveToFront(info);
+                this->dirtyRectList.push_back(Rectangle(info->width, info->height, info->x, info->y));
+            }
         }
     }
 
@@ -294,18 +369,6 @@ void Compositor::ProcessEvents()
         if(curMouseInfo != 0 && curMouseInfo != prevMouseInfo) {
             IPCSend(curMouseInfo->clientID, IPCMessageType::GUIEvent, GUIEvents::MouseMove, this->prevMouseX, this->prevMouseY, this->curMouseX, this->curMouseY);
         }
-
-        // Apply dirty rectangles if required
-        Rectangle prevMouseRect = Rectangle(CURSOR_W, CURSOR_H, this->prevMouseX, this->prevMouseY);
-        Rectangle curMouseRect = Rectangle(CURSOR_W, CURSOR_H, this->curMouseX, this->curMouseY);
-        ApplyDesktopBounds(&prevMouseRect);
-        ApplyDesktopBounds(&curMouseRect);
-
-        for(ContextInfo* c : contextManager->FindTargetContexts(prevMouseRect))
-            c->AddDirtyArea(0, 0, c->width, c->height);
-
-        for(ContextInfo* c : contextManager->FindTargetContexts(curMouseRect))
-            c->AddDirtyArea(0, 0, c->width, c->height);
     }
 
     // Mouse scroll wheel position has changed
@@ -353,8 +416,8 @@ void Compositor::ProcessEvents()
             Print("[Compositor] Switching debug mode to %b\n", !this->debugger->enabled);
             this->debugger->enabled = !this->debugger->enabled;
 
-            if(this->debugger->enabled == false) // Cleanup mess left by debugger
-                this->dirtyRectList.push_back(Rectangle(GUI::Width, GUI::Height));
+            // Draw or cleanup the debug info on the whole screen
+            this->dirtyRectList.push_back(Rectangle(GUI::Width, GUI::Height));
 
             continue;
         }
@@ -455,6 +518,11 @@ void Compositor::HandleClientRequest(IPCMessage msg)
         {
             Rectangle dirtyRect(msg.arg4, msg.arg5, msg.arg2, msg.arg3);
             this->dirtyRectList.push_back(dirtyRect);
+
+            // The new position is not known from the message, so redraw all contexts of this process
+            for(ContextInfo* c : this->contextManager->contextList)
+                if(c->clientID == msg.source)
+                    this->dirtyRectList.push_back(Rectangle(c->width, c->height, c->x, c->y));
             break;
         }
         // A process requested a close of context
@@ -27,6 +27,8 @@
 #include "debugger.h"
 
 #define COMPOSITOR_DEFAULT_BACKGROUND 0xFFBFFFD0
+#define COMPOSITOR_SWAP_REPORT 1000
+#define COMPOSITOR_MAX_DAMAGE 32
 
 class CompositorDebugger;
 
@@ -121,11 +123,27 @@ protected:
     // List of dirty rectangles
     List<Rectangle> dirtyRectList;
 
+    // Merged areas of the screen that need to be redrawn this frame
+    // The rectangles in this list never overlap each other
+    List<Rectangle> damageList;
+
     /**
      * Which ID does the next context get on creation? 
     */
     int nextContextID = 1;
 
+    // Total ticks spent swapping the backbuffer to the framebuffer
+    uint64_t swapTicks = 0;
+
+    // Amount of frames included in swapTicks
+    uint32_t swapFrames = 0;
+
+    // Time it took to draw the previous frame in ms
+    uint32_t frameTime = 0;
+
+    // Amount of bytes copied to the framebuffer during the previous frame
+    uint32_t bytesCopied = 0;
+
 protected:
     // Makes rectangle fit into desktop rectangle
     void ApplyDesktopBounds(Rectangle* rect);
@@ -133,8 +151,14 @@ protected:
     // Draws the current cursor to the backbuffer
     void DrawCursor();
 
-    // Removes the previous cursor still visible in the backbuffer
-    void RemovePreviousCursor();
+    // Add an area of the screen that needs to be redrawn, merging it with the existing damage
+    void AddDamage(Rectangle rect);
+
+    // Is the area completely covered by an opaque context above the context at index?
+    bool IsOccluded(int index, Rectangle area);
+
+    // Draw the part of the context that is inside area to the backbuffer
+    void DrawContextArea(ContextInfo* context, Rectangle area);
 
     // Function that handles a request from a client
     void HandleClientRequest(IPCMessage message);
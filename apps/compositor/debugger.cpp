@@ -80,6 +80,17 @@ void CompositorDebugger::ProcessGeneral()
         frameCount = 0;
     }
 
-    this->target->backBufferCanvas->DrawFillRect(0xFFAAAAAA, 0, 0, 50, 25);
+    this->target->backBufferCanvas->DrawFillRect(0xFFAAAAAA, 0, 0, 150, 65);
     this->target->backBufferCanvas->DrawString(GUI::defaultFont, Convert::IntToString(fps), 5, 5, 0xFF0000FF);
+
+    // Frame time of the previous frame
+    this->target->backBufferCanvas->DrawString(GUI::defaultFont, "Frame ms: ", 5, 25, 0xFF0000FF);
+    this->target->backBufferCanvas->DrawString(GUI::defaultFont, Convert::IntToString(this->target->frameTime), 90, 25, 0xFF0000FF);
+
+    // Bytes copied to the framebuffer during the previous frame
+    this->target->backBufferCanvas->DrawString(GUI::defaultFont, "Copied: ", 5, 45, 0xFF0000FF);
+    this->target->backBufferCanvas->DrawString(GUI::defaultFont, Convert::IntToString(this->target->bytesCopied), 90, 45, 0xFF0000FF);
+
+    // The values change every frame
+    this->target->AddDamage(Rectangle(150, 65));
 }
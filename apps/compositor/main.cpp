@@ -27,6 +27,9 @@ using namespace LIBHeisenKernel;
 
 int main(int argc, char** argv)
 {
+    // Input and drawing should stay responsive when other applications are busy
+    Process::SetPriority(PROC_PRIORITY_HIGH);
+
     Compositor* mainCompositor = new Compositor();
     while(1) 
     {
@@ -50,6 +53,12 @@ int main(int argc, char** argv)
         ///////////////////////////
         mainCompositor->DrawFrame();
 
+        static bool firstFrame = true;
+        if(firstFrame) {
+            Print("Compositor: first frame after %d ms\n", Process::TimeSinceLaunch());
+            firstFrame = false;
+        }
+
         // Update cursor variables for next run
         mainCompositor->prevMouseX = mainCompositor->curMouseX;
         mainCompositor->prevMouseY = mainCompositor->curMouseY;
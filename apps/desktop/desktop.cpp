@@ -100,6 +100,8 @@ int main(int argc, char** argv)
         }
     }
 
+    Print("Desktop: first frame after %d ms\n", Process::TimeSinceLaunch());
+
     while(1)
     {
         GUI::ProcessEvents();
@@ -0,0 +1,203 @@
+#include <log.h>
+#include <types.h>
+#include <time.h>
+#include <gui/colors.h>
+#include <gui/canvas.h>
+#include <gui/fonts/fontparser.h>
+#include <imaging/pngformat.h>
+#include <string.h>
+#include <vfs.h>
+
+using namespace LIBHeisenKernel;
+using namespace LIBHeisenKernel::Imaging;
+
+// Measures the speed of the drawing routines used by the compositor and the gui library
+
+#define BENCH_FRAMES 20
+#define BENCH_DECODES 5
+
+void PrintResult(const char* name, int width, int height, uint32_t ms)
+{
+    if(ms == 0)
+        ms = 1;
+    Print("%s %dx%d: %d frames in %d ms, %d frames/s\n", name, width, height, BENCH_FRAMES, ms, BENCH_FRAMES * 1000 / ms);
+}
+
+// Blend a full screen of foreground pixels over a background, like a transparent context covering the desktop
+void BenchmarkBlend(int width, int height)
+{
+    uint32_t pixels = width * height;
+    uint32_t* background = new uint32_t[pixels];
+    uint32_t* foreground = new uint32_t[pixels];
+    uint32_t* result = new uint32_t[pixels];
+    if(background == 0 || foreground == 0 || result == 0) {
+        Print("Could not allocate buffers for %dx%d\n", width, height);
+        return;
+    }
+
+    // Translucent window with some opaque and transparent areas in it
+    for(uint32_t i = 0; i < pixels; i++) {
+        background[i] = 0xFF000000 | (i * 2654435761U >> 8);
+        if((i % width) < (uint32_t)width / 4)
+            foreground[i] = 0x00000000;
+        else if((i % width) < (uint32_t)width / 2)
+            foreground[i] = 0xFF202020;
+        else
+            foreground[i] = 0xC0101010 | (i & 0xFF);
+    }
+
+    uint64_t start = Time::Ticks();
+    for(int f = 0; f < BENCH_FRAMES; f++)
+        for(uint32_t i = 0; i < pixels; i++)
+            result[i] = Colors::AlphaBlend(background[i], foreground[i]);
+    PrintResult("AlphaBlend", width, height, (uint32_t)(Time::Ticks() - start));
+
+    start = Time::Ticks();
+    for(int f = 0; f < BENCH_FRAMES; f++)
+        for(int y = 0; y < height; y++)
+            Colors::BlendSpan(result + y * width, background + y * width, foreground + y * width, width);
+    PrintResult("BlendSpan", width, height, (uint32_t)(Time::Ticks() - start));
+
+    delete[] background;
+    delete[] foreground;
+    delete[] result;
+}
+
+// Decode a png file several times, the file is only read once
+void BenchmarkPNG(char* path)
+{
+    uint32_t fileSize = GetFileSize(path);
+    if(fileSize == (uint32_t)-1) {
+        Print("Could not find %s\n", path);
+        return;
+    }
+
+    uint8_t* fileBuf = new uint8_t[fileSize];
+    uint8_t* decodeBuf = new uint8_t[fileSize];
+    ReadFile(path, fileBuf);
+
+    int width = 0, height = 0;
+    uint64_t ticks = 0;
+    for(int i = 0; i < BENCH_DECODES; i++) {
+        // The decoder modifies the header in the buffer
+        memcpy(decodeBuf, fileBuf, fileSize);
+
+        uint64_t start = Time::Ticks();
+        Image* img = PNGDecoder::ConvertRAW(decodeBuf);
+        ticks += Time::Ticks() - start;
+
+        if(img == 0) {
+            Print("Could not decode %s\n", path);
+            break;
+        }
+        width = img->GetWidth();
+        height = img->GetHeight();
+        delete img;
+    }
+    Print("PNG %s (%dx%d): %d ms per decode\n", path, width, height, (uint32_t)ticks / BENCH_DECODES);
+
+    delete[] fileBuf;
+    delete[] decodeBuf;
+}
+
+// Scale an image down with every resize method, like the compositor does with the wallpaper
+void BenchmarkResize(int width, int height, int newWidth, int newHeight)
+{
+    Image* source = new Image(width, height);
+    if(source == 0 || source->GetBufferPtr() == 0) {
+        Print("Could not allocate image of %dx%d\n", width, height);
+        return;
+    }
+
+    uint32_t* pixels = source->GetBufferPtr();
+    for(uint32_t i = 0; i < (uint32_t)(width * height); i++)
+        pixels[i] = 0xFF000000 | (i * 2654435761U >> 8);
+
+    const char* names[] = { "Nearest", "Bilinear", "Box" };
+    ResizeMethod methods[] = { NearestNeighbor, Bilinear, Box };
+    for(int m = 0; m < 3; m++) {
+        uint64_t start = Time::Ticks();
+        Image* result = Image::Resize(source, newWidth, newHeight, methods[m]);
+        uint32_t ms = (uint32_t)(Time::Ticks() - start);
+
+        if(result == 0) {
+            Print("Resize %s failed\n", names[m]);
+            continue;
+        }
+        Print("Resize %s %dx%d -> %dx%d: %d ms\n", names[m], width, height, newWidth, newHeight, ms);
+        delete result;
+    }
+
+    delete source;
+}
+
+// Fill a terminal of columns by rows with text, once per character like the old terminal did and once per line
+void BenchmarkText(Font* font, int columns, int rows)
+{
+    const int lineHeight = 14;
+    int width = columns * 10;
+    int height = rows * lineHeight;
+    uint32_t* buffer = new uint32_t[width * height];
+    char* text = new char[columns * rows];
+    if(buffer == 0 || text == 0) {
+        Print("Could not allocate buffers for %dx%d terminal\n", columns, rows);
+        return;
+    }
+
+    for(int i = 0; i < columns * rows; i++)
+        text[i] = 33 + (i * 7) % 94;
+    Canvas canvas(buffer, width, height);
+    canvas.Clear(0xFF428052);
+
+    char tmpStr[2];
+    tmpStr[1] = '\0';
+    uint64_t start = Time::Ticks();
+    for(int f = 0; f < BENCH_FRAMES; f++)
+        for(int y = 0; y < rows; y++) {
+            int x = 0;
+            for(int c = 0; c < columns; c++) {
+                tmpStr[0] = text[y * columns + c];
+                canvas.DrawString(font, tmpStr, x, y * lineHeight, 0xFFFFFFFF);
+
+                int w, h;
+                font->BoundingBox(tmpStr, &w, &h);
+                x += w;
+            }
+        }
+    uint32_t ms = (uint32_t)(Time::Ticks() - start);
+    Print("DrawString per char %dx%d terminal: %d frames in %d ms\n", columns, rows, BENCH_FRAMES, ms);
+
+    start = Time::Ticks();
+    for(int f = 0; f < BENCH_FRAMES; f++)
+        for(int y = 0; y < rows; y++)
+            canvas.DrawText(font, text + y * columns, columns, 0, y * lineHeight, 0xFFFFFFFF);
+    ms = (uint32_t)(Time::Ticks() - start);
+    Print("DrawText per line %dx%d terminal: %d frames in %d ms\n", columns, rows, BENCH_FRAMES, ms);
+
+    delete[] buffer;
+    delete[] text;
+}
+
+int main(int argc, char** argv)
+{
+    // Icons use all filter types, the logo only uses filter type 0
+    BenchmarkPNG("B:\\desktop\\terminal.png");
+    BenchmarkPNG("B:\\desktop\\settings.png");
+    BenchmarkPNG("B:\\logo-white.png");
+
+    BenchmarkBlend(1024, 768);
+    BenchmarkBlend(1920, 1080);
+
+    BenchmarkResize(3840, 2160, 1920, 1080);
+    BenchmarkResize(1920, 1080, 1024, 768);
+
+    Font* font = FontParser::FromFile("B:\\fonts\\Ubuntu15.cff");
+    if(font) {
+        BenchmarkText(font, 80, 25);
+        BenchmarkText(font, 200, 60);
+    }
+    else
+        Print("Could not load font\n");
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <log.h>
+#include <types.h>
+#include <proc.h>
+#include <ipc.h>
+#include <time.h>
+#include <gui/contextheap.h>
+
+using namespace LIBHeisenKernel;
+
+// Compares sending messages through the kernel with sending them through a shared memory channel
+// The application starts a copy of itself that receives all messages
+
+#define BENCH_MESSAGES 10000
+#define CHANNEL_SIZE 64_KB
+
+// Receiving side, started by the other instance
+int RunConsumer()
+{
+    IPCMessage setup = ICPReceive();
+    int producer = setup.source;
+
+    for(int i = 0; i < BENCH_MESSAGES; i++)
+        ICPReceive(producer);
+    IPCSend(producer);
+
+    IPCChannel channel((void*)setup.arg1, CHANNEL_SIZE, false);
+    for(int i = 0; i < BENCH_MESSAGES; i++)
+        channel.Receive();
+    IPCSend(producer);
+
+    return 0;
+}
+
+void PrintResult(const char* name, uint32_t ms)
+{
+    if(ms == 0)
+        ms = 1;
+    Print("%s: %d messages in %d ms, %d messages/s\n", name, BENCH_MESSAGES, ms, BENCH_MESSAGES * 1000 / ms);
+}
+
+int main(int argc, char** argv)
+{
+    // The producer sends us the setup message before we are started
+    if(IPCAvailable() > 0)
+        return RunConsumer();
+
+    int consumer = Process::Run("B:\\apps\\ipcbench.bin", true);
+    if(consumer == 0) {
+        Print("Could not start consumer process\n");
+        return -1;
+    }
+
+    ContextHeap::Init();
+    uint32_t region = ContextHeap::AllocateArea(CHANNEL_SIZE / 4_KB);
+    if(region == 0 || !Process::CreateSharedMemory(consumer, region, CHANNEL_SIZE)) {
+        Print("Could not create shared memory for channel\n");
+        return -1;
+    }
+
+    IPCChannel channel((void*)region, CHANNEL_SIZE, true);
+    IPCSend(consumer, IPCMessageType::None, region);
+    Process::Unblock(consumer);
+
+    // Every message is a systemcall and is copied into a kernel list
+    uint64_t start = Time::Ticks();
+    for(int i = 0; i < BENCH_MESSAGES; i++)
+        IPCSend(consumer, IPCMessageType::None, i);
+    ICPReceive(consumer);
+    PrintResult("IPCSend", (uint32_t)(Time::Ticks() - start));
+
+    // Messages are copied into shared memory, the kernel is only involved when a side has to wait
+    IPCMessage message;
+    message.source = Process::ID;
+    message.dest = consumer;
+    message.type = IPCMessageType::None;
+
+    start = Time::Ticks();
+    for(int i = 0; i < BENCH_MESSAGES; i++) {
+        message.arg1 = i;
+        channel.Send(message);
+    }
+    ICPReceive(consumer);
+    PrintResult("IPCChannel", (uint32_t)(Time::Ticks() - start));
+
+    Process::DeleteSharedMemory(consumer, region, CHANNEL_SIZE);
+    return 0;
+}
@@ -142,6 +142,7 @@ void PrintPROCInfo()
         Print("        -> Base   = %x\n", (uint32_t)SystemInfo::Properties["processes"][i]["membase"]);
         Print("        -> Size   = %x\n", (uint32_t)SystemInfo::Properties["processes"][i]["memsize"]);
         Print("        -> Heap   = %d Kb\n", ((uint32_t)SystemInfo::Properties["processes"][i]["heap-end"] - (uint32_t)SystemInfo::Properties["processes"][i]["heap-start"]) / 1_KB);
+        Print("        -> Loaded = %d Kb\n", (uint32_t)SystemInfo::Properties["processes"][i]["demand-pages"] * 4);
 
         delete id;
     }
@@ -158,6 +159,44 @@ void PrintMEMInfo()
     Print("  -> Total = %d Mb\n", total / 1_MB);
     Print("  -> Free = %d MB\n", free / 1_MB);
     Print("  -> Used = %d Mb (%d%)\n", used / 1_MB, (uint32_t)(((double)used / (double)total) * 100.0));  
+    Print("  -> Excecutable pages = %d Kb (%d Kb saved by sharing)\n", (uint32_t)SystemInfo::Properties["memory"]["cached"] / 1_KB, (uint32_t)SystemInfo::Properties["memory"]["shared"] / 1_KB);
+}
+
+void PrintHEAPInfo()
+{
+    Print("Kernel Heap:\n");
+    Print("  -> Used = %d Kb\n", (uint32_t)SystemInfo::Properties["heap"]["used"] / 1_KB);
+    Print("  -> Lock Contention = %d\n", (uint32_t)SystemInfo::Properties["heap"]["contention"]);
+    Print("  Caches:\n");
+    int cacheCount = SystemInfo::Properties["slabcaches"].size();
+    for(int i = 0; i < cacheCount; i++) {
+        Print("    %d: %d bytes\n", i, (uint32_t)SystemInfo::Properties["slabcaches"][i]["objectsize"]);
+        Print("        -> Live    = %d\n", (uint32_t)SystemInfo::Properties["slabcaches"][i]["live"]);
+        Print("        -> Slabs   = %d\n", (uint32_t)SystemInfo::Properties["slabcaches"][i]["slabs"]);
+        Print("        -> Allocs  = %d\n", (uint32_t)SystemInfo::Properties["slabcaches"][i]["allocations"]);
+        Print("        -> HitRate = %d%\n", (uint32_t)SystemInfo::Properties["slabcaches"][i]["hitrate"]);
+        Print("        -> Magazine = %d\n", (uint32_t)SystemInfo::Properties["slabcaches"][i]["magazinehits"]);
+    }
+}
+
+void PrintSchedulerInfo()
+{
+    Print("Scheduler:\n");
+    Print("  -> Threads = %d\n", (uint32_t)SystemInfo::Properties["scheduler"]["threads"]);
+    Print("  -> Idle = %d%\n", (uint32_t)SystemInfo::Properties["scheduler"]["idle"]);
+    Print("  -> Wakeups = %d (%d late)\n", (uint32_t)SystemInfo::Properties["scheduler"]["wakeups"], (uint32_t)SystemInfo::Properties["scheduler"]["latewakeups"]);
+    Print("  -> Max Wake Latency = %d cycles\n", (uint32_t)SystemInfo::Properties["scheduler"]["maxwakelatency"]);
+    Print("  -> FPU Traps = %d/s (%d saves avoided/s)\n", (uint32_t)SystemInfo::Properties["fpu"]["traps"], (uint32_t)SystemInfo::Properties["fpu"]["savesavoided"]);
+}
+
+void PrintBlockCacheInfo()
+{
+    Print("Block Cache:\n");
+    Print("  -> Size = %d blocks\n", (uint32_t)SystemInfo::Properties["blockcache"]["size"]);
+    Print("  -> Hits = %d\n", (uint32_t)SystemInfo::Properties["blockcache"]["hits"]);
+    Print("  -> Misses = %d\n", (uint32_t)SystemInfo::Properties["blockcache"]["misses"]);
+    Print("  -> Dirty = %d\n", (uint32_t)SystemInfo::Properties["blockcache"]["dirty"]);
+    Print("  -> Writebacks = %d\n", (uint32_t)SystemInfo::Properties["blockcache"]["writebacks"]);
 }
 
 void PrintBIOSInfo()
@@ -249,6 +288,9 @@ int main(int argc, char** argv)
     PrintGFXInfo();
     PrintPROCInfo();
     PrintMEMInfo();
+    PrintHEAPInfo();
+    PrintSchedulerInfo();
+    PrintBlockCacheInfo();
     PrintBIOSInfo();
     PrintSystemInfo();
     PrintEnclosureInfo();
@@ -17,6 +17,22 @@ TerminalControl* termWindow = 0;
 
 int ExecCommand(char* cmd);
 
+// Write the output of the process to the terminal until it exits
+void ReadOutput()
+{
+    static char buffer[1024 + 1];
+    while(true)
+    {
+        // Blocks until the process writes something, returns 0 once it has exited
+        int count = Process::ReadStdIn(buffer, sizeof(buffer) - 1);
+        if(count <= 0)
+            break;
+        
+        buffer[count] = '\0';
+        termWindow->Write(buffer);
+    }
+}
+
 void GUIThread()
 {
     while(1)
@@ -28,6 +44,13 @@ void GUIThread()
         }
 
         GUI::DrawGUI();
+
+        static bool firstFrame = true;
+        if(firstFrame) {
+            Print("Terminal: first frame after %d ms\n", Process::TimeSinceLaunch());
+            firstFrame = false;
+        }
+
         if(IPCAvailable())
             GUI::ProcessEvents();
         else
@@ -55,14 +78,7 @@ int main(int argc, char** argv)
         {
             Process::BindSTDIO(pid, Process::ID);
             Process::Unblock(pid);
-            while(Process::Active(pid)) {
-                if(Process::StdInAvailable() > 0)
-                    termWindow->Write(Process::ReadStdIn());
-            }
-
-            //Read remaining data from process if available
-            while(Process::StdInAvailable() > 0)
-                termWindow->Write(Process::ReadStdIn());
+            ReadOutput();
         }
         
         delete cmd;
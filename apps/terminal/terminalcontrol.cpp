@@ -168,23 +168,9 @@ void TerminalControl::DrawTo(Canvas* context, int x_abs, int y_abs)
 {
     context->DrawFillRect(0xFF428052, x_abs, y_abs+1, width+1, height-1);
 
-    char tmpStr[2];
-    tmpStr[1] = '\0';
-
-    int xoff = 2;
-    for(int yp = 0; yp < TERM_HEIGH; yp++) {
-        for(int xp = 0; xp < TERM_WIDTH; xp++)
-        {
-            tmpStr[0] = textBuffer[yp * TERM_WIDTH + xp];
-            context->DrawString(this->font, tmpStr, x_abs + xoff, y_abs + 1 + yp*14, textColor);
-
-            Font* fnt = this->font;
-            int w,h = 0;
-            fnt->BoundingBox(tmpStr, &w, &h);
-            xoff += w;
-        }
-        xoff = 2;
-    }
+    // Each line is drawn as one run, empty cells have no glyph and are skipped
+    for(int yp = 0; yp < TERM_HEIGH; yp++)
+        context->DrawText(this->font, textBuffer + yp * TERM_WIDTH, TERM_WIDTH, x_abs + 2, y_abs + 1 + yp*14, textColor);
 }
 
 void TerminalControl::OnKeyDown(uint8_t key, KEYPACKET_FLAGS modifiers)
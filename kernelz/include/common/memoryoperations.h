@@ -14,9 +14,15 @@ namespace HeisenOs
         #define phys2virt(x) ((x) + 3_GB)
         #define virt2phys(x) ((x) - 3_GB)
 
+        // Copies and fills of at least this size bypass the cache using non-temporal stores
+        // Data this big would only push everything else out of the cache
+        #define MEMOPS_NONTEMPORAL_THRESHOLD 256_KB
+
         class MemoryOperations
         {
         public:
+            // Can we use non-temporal stores (movnti), set at boot when the cpu supports SSE2
+            static bool nonTemporal;
         // ---------------------------------------------------------------------------
         // static functions for memory operations
             static void* memmove(void* dstptr, const void* srcptr, uint32_t size);
@@ -9,12 +9,33 @@ namespace HeisenOs
     {
         #define EDX_SSE2 (1 << 26) // Streaming SIMD Extensions 2
         #define EDX_FXSR (1 << 24) // Can we use the fxsave/fxrstor instructions?
+        #define EDX_PSE (1 << 3) // 4MB pages
+        #define EDX_PAT (1 << 16) // Page Attribute Table
 
         class CPU
         {
         public:
             static void PrintVendor();
             static void EnableFeatures();
+
+            // Read the time stamp counter, used for measuring short intervals in cpu cycles
+            static inline common::uint64_t ReadTimestamp()
+            {
+                common::uint32_t low, high;
+                asm volatile("rdtsc" : "=a"(low), "=d"(high));
+                return ((common::uint64_t)high << 32) | low;
+            }
+
+            static inline common::uint64_t ReadMSR(common::uint32_t msr)
+            {
+                common::uint32_t low, high;
+                asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+                return ((common::uint64_t)high << 32) | low;
+            }
+            static inline void WriteMSR(common::uint32_t msr, common::uint64_t value)
+            {
+                asm volatile("wrmsr" :: "a"((common::uint32_t)value), "d"((common::uint32_t)(value >> 32)), "c"(msr));
+            }
         };        
     }
 }
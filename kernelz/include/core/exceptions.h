@@ -26,6 +26,7 @@ namespace HeisenOs
             static common::uint32_t PageFault(common::uint32_t esp);
             static common::uint32_t TrapException(common::uint32_t esp);
             static common::uint32_t FloatingPointException(common::uint32_t esp);
+            static common::uint32_t DeviceNotAvailable(common::uint32_t esp);
             static common::uint32_t StackSegmentFault(common::uint32_t esp);
             static void ShowStacktrace(common::uint32_t esp);
         public:
@@ -23,10 +23,39 @@ namespace HeisenOs
             common::uint8_t reserved3 : 3;
         } __attribute__((packed));
 
+        // Size of the buffer used by fxsave and fxrstor
+        #define FPU_STATE_SIZE 512
+
+        /**
+         * The fpu state is switched lazily, on a task switch only CR0.TS is set.
+         * The first fpu instruction of the new thread causes a #NM exception, only then the old state is saved and the new one loaded.
+        */
         class FPU
         {
+        private:
+            // State that is currently loaded into the fpu registers
+            static common::uint8_t* loadedState;
+            // State of the running thread
+            static common::uint8_t* runningState;
+
+            static common::uint32_t switches;
+            static common::uint32_t saves;
         public:
+            // Statistics of the last second
+            static common::uint32_t trapsPerSecond;
+            static common::uint32_t savesAvoidedPerSecond;
+            static common::uint32_t traps;
+
             static void Enable();
+
+            // Called on a task switch with the state buffer of the new thread
+            static void SwitchTo(common::uint8_t* state);
+            // Handler for the device not available exception
+            static void HandleUnavailable();
+            // The buffer is about to be freed, so it should not be used anymore
+            static void ReleaseState(common::uint8_t* state);
+            // Should be called every second
+            static void UpdateStatistics();
         };
     }
 }
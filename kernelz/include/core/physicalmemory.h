@@ -12,7 +12,6 @@ namespace HeisenOs
     namespace core
     {
         #define BLOCK_SIZE 4_KB
-        #define BLOCKS_PER_BYTE 8 //Every byte describes 8 blocks
 
         typedef struct multiboot_memory_map {
             unsigned int size;
@@ -23,29 +22,47 @@ namespace HeisenOs
             unsigned int type;
         }  __attribute__((packed)) grub_multiboot_memory_map_t;
 
+        #define BUDDY_MAX_ORDER 10 // Largest buddy block is 2^10 blocks, so 4 MiB
+        #define BUDDY_MAX_LEVELS 5 // Levels of the search tree of one order, enough for 32^5 blocks
+
+        /**
+         * The free blocks of one buddy order.
+         * Free memory is not mapped so we can't link the blocks together through the blocks themself,
+         * instead every order has a bitmap with summary levels on top of it.
+         * Bit n of level i+1 is set when word n of level i is not zero, this way the first free block is found in O(levels).
+        */
+        struct BuddyFreeArea
+        {
+            common::uint32_t numBlocks;
+            common::uint32_t numFree;
+            common::uint32_t numLevels;
+            common::uint32_t* levels[BUDDY_MAX_LEVELS];
+        };
+
         class PhysicalMemoryManager
         {
         private:
             static common::uint32_t memorySize;
             static common::uint32_t usedBlocks;
             static common::uint32_t maximumBlocks;
-            static common::uint32_t* memoryArray;
+            static common::uint32_t metadataSize;
+            static BuddyFreeArea freeAreas[BUDDY_MAX_ORDER + 1];
 
-            static inline void SetBit (common::uint32_t bit)
-            {
-                memoryArray[bit / 32] |= (1 << (bit % 32));
-            }
-            static inline void UnsetBit (common::uint32_t bit)
-            {
-                memoryArray[bit / 32] &= ~ (1 << (bit % 32));
-            }
-            static inline bool TestBit (common::uint32_t bit)
+            static inline bool IsFree (common::uint32_t order, common::uint32_t index)
             {
-                return memoryArray[bit / 32] &  (1 << (bit % 32));
+                return index < freeAreas[order].numBlocks && (freeAreas[order].levels[0][index / 32] & (1 << (index % 32)));
             }
 
-            static common::uint32_t FirstFree ();
-            static common::uint32_t FirstFreeSize (common::uint32_t size);
+            static void MarkFree(common::uint32_t order, common::uint32_t index);
+            static void MarkUsed(common::uint32_t order, common::uint32_t index);
+            static common::uint32_t FindFree(common::uint32_t order);
+
+            static common::uint32_t AllocateFrames(common::uint32_t order);
+            static common::uint32_t AllocateLargeFrames(common::uint32_t size);
+            static void FreeFrames(common::uint32_t frame, common::uint32_t order);
+            static void FreeFrameRange(common::uint32_t frame, common::uint32_t size);
+            static bool IsFrameFree(common::uint32_t frame);
+            static void ReserveFrame(common::uint32_t frame);
         public:
             static void Initialize(common::uint32_t size, common::uint32_t bitmap);
             static void SetRegionFree(common::uint32_t base, common::uint32_t size);
@@ -56,12 +73,20 @@ namespace HeisenOs
             static void FreeBlock(void* ptr);
             static void* AllocateBlocks(common::uint32_t size);
             static void FreeBlocks(void* ptr, common::uint32_t size);
+            // Allocate 2^order contiguous blocks aligned to their own size
+            static void* AllocateOrder(common::uint32_t order);
+            static void FreeOrder(void* ptr, common::uint32_t order);
+            // Smallest order that can hold the requested amount of blocks
+            static common::uint32_t OrderForSize(common::uint32_t size);
 
             static common::uint32_t AmountOfMemory();
             static common::uint32_t UsedBlocks();
             static common::uint32_t FreeBlocks();
             static common::uint32_t TotalBlocks();
             static common::uint32_t GetBitmapSize();
+
+            // Log allocation and free latencies for a couple of request sizes
+            static void Benchmark();
         };
 
         //Helper functions
@@ -27,12 +27,31 @@ namespace HeisenOs
         #define USER_STACK (USER_STACK_TOP - USER_STACK_SIZE)
 
         #define PAGE_SIZE 4_KB
+        #define LARGE_PAGE_SIZE 4_MB
         #define KERNEL_PTNUM 768 //The kernel is in the 768th entry
         #define PAGE_TABLE_ADDRESS 0xFFC00000
         #define PAGE_DIRECTORY_ADDRESS 0xFFFFF000
 
+        // 4MB after the kernel heap that is always mapped with small pages, used to access physical memory temporarily
+        #define KERNEL_WINDOW_START (KERNEL_HEAP_START + KERNEL_HEAP_SIZE)
+        #define WINDOW_PAGE_DIRECTORY   (KERNEL_WINDOW_START)
+        #define WINDOW_PAGE_TABLE       (KERNEL_WINDOW_START + PAGE_SIZE)
+        #define WINDOW_DEBUGGER         (KERNEL_WINDOW_START + 2 * PAGE_SIZE)
+
+        #define MSR_PAT 0x277
+        #define PAT_WRITE_COMBINING 0x01
+
         #define PAGE_OFFSET_BITS 12
 
+        // Flags for MapRange
+        #define VMM_WRITEABLE   (1<<0)  // Pages can be written to
+        #define VMM_USER        (1<<1)  // Pages can be accessed from usermode
+        #define VMM_ALLOCATE    (1<<2)  // Every page gets a newly allocated physical block, the physical address is ignored
+        #define VMM_LARGE_PAGES (1<<3)  // Use 4MB pages for parts of the range that are aligned to 4MB
+        #define VMM_WRITE_COMBINING (1<<4) // Writes are combined before going to memory, for framebuffers
+
+        #define VMM_INVLPG_THRESHOLD 32 // Above this amount of pages the whole TLB is flushed instead of every page
+
         #define PAGEDIR_INDEX(addr) (((uint32_t)addr) >> 22)
         #define PAGETBL_INDEX(addr) ((((uint32_t)addr) >> 12) & 0x3ff)
         #define PAGEFRAME_INDEX(addr) (((uint32_t)addr) & 0xfff)
@@ -85,7 +104,16 @@ namespace HeisenOs
 
         class VirtualMemoryManager
         {
+        private:
+            // Get the page directory of pageDirPhys, through a window when it is not the current one
+            static PageDirectory* GetPageDirectory(common::uint32_t pageDirPhys, bool current);
+            // Get the page table for a directory entry, creating it when needed, returns 0 on failure
+            static PageTable* GetPageTable(PageDirectory* pageDir, common::uint32_t pageDirIndex, bool current, bool shouldCreate, bool userPages);
+            static void FlushRange(common::uint32_t virtAddress, common::uint32_t pages);
         public:      
+            // Set when the PAT has an entry for write combining, selected with the write through bit
+            static bool writeCombining;
+
             static void ReloadCR3();  
             static void Initialize();
             static void AllocatePage(PageTableEntry* page, bool kernel, bool writeable);
@@ -94,12 +122,22 @@ namespace HeisenOs
             static PageTableEntry* GetPageForAddress(common::uint32_t virtualAddress, bool shouldCreate, bool readWrite = true, bool userPages = false);
             
             static void* GetPageTableAddress(common::uint16_t pageTableNumber);
+
+            // Map a physical page at one of the window addresses and return it
+            static void* MapWindow(common::uint32_t window, common::uint32_t physAddress);
             
+            // Returns 0 when the address is not mapped
             static void* virtualToPhysical(void* virtAddress);
             
             static void mapVirtualToPhysical(void* physAddress, void* virtAddress, bool kernel = true, bool writeable = true);
             static void mapVirtualToPhysical(void* physAddress, void* virtAddress, common::uint32_t size, bool kernel = true, bool writeable = true);
             
+            // Map a range of pages in the address space of pageDirPhys, or the current one when it is 0
+            // Page tables are walked once per directory entry, returns false when out of memory and nothing is mapped then
+            static bool MapRange(common::uint32_t virtAddress, common::uint32_t physAddress, common::uint32_t pages, common::uint32_t flags, common::uint32_t pageDirPhys = 0);
+            // Remove a range of pages from the address space of pageDirPhys, or the current one when it is 0
+            static void UnmapRange(common::uint32_t virtAddress, common::uint32_t pages, bool freeBlocks, common::uint32_t pageDirPhys = 0);
+
             static void SwitchPageDirectory(common::uint32_t physAddr);
             static common::uint32_t GetPageDirectoryAddress();
         };
@@ -0,0 +1,35 @@
+#ifndef __CACTUSOS__SYSTEM__BENCHMARK_H
+#define __CACTUSOS__SYSTEM__BENCHMARK_H
+
+#include <common/types.h>
+
+namespace HeisenOs
+{
+    namespace system
+    {
+        #define LATENCY_BUCKETS 16
+        #define LATENCY_FIRST_BUCKET_SHIFT 6 // First bucket holds everything below 64 cycles
+
+        /**
+         * Histogram of measured latencies in cpu cycles.
+         * Bucket n holds samples between 2^(n+5) and 2^(n+6) cycles, the last bucket holds everything larger.
+        */
+        class LatencyHistogram
+        {
+        public:
+            common::uint32_t buckets[LATENCY_BUCKETS];
+            common::uint32_t samples;
+            common::uint32_t minimum;
+            common::uint32_t maximum;
+
+            LatencyHistogram();
+
+            // Add a sample to the histogram
+            void Add(common::uint64_t cycles);
+            // Print the histogram to the log
+            void Print(const char* name);
+        };
+    }
+}
+
+#endif
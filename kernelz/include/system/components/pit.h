@@ -10,17 +10,36 @@ namespace HeisenOs
     namespace system
     {
         #define PIT_FREQUENCY 1000
+        #define PIT_BASE_FREQUENCY 1193180
+        #define PIT_COUNTS_PER_TICK (PIT_BASE_FREQUENCY / PIT_FREQUENCY)
+        // Longest one-shot the 16-bit counter can do
+        #define PIT_ONESHOT_MAX_TICKS (0xFFFF / PIT_COUNTS_PER_TICK)
 
         class PIT : public SystemComponent, public InterruptHandler
         {
         private:
             volatile common::uint64_t timer_ticks;
+
+            // Is the timer programmed to fire once instead of every tick?
+            bool oneShotActive;
+            common::uint32_t oneShotTicks;
+            // Ticks that passed with the last interrupt
+            common::uint32_t interruptTicks;
+
+            void SetPeriodic();
         public:
             PIT();
 
             common::uint32_t HandleInterrupt(common::uint32_t esp);
             void Sleep(common::uint32_t ms);
 
+            // Let the timer fire only once after the given amount of ticks, until then no interrupts are generated
+            void StartOneShot(common::uint32_t ticks);
+            // Go back to an interrupt every tick, returns how many ticks passed when the one-shot did not fire yet
+            common::uint32_t StopOneShot();
+            // Ticks that passed with the last interrupt, more than one when a one-shot has fired
+            common::uint32_t InterruptTicks();
+
             //PCSpeaker
             void PlaySound(common::uint32_t nFrequence);
             void NoSound();
@@ -0,0 +1,96 @@
+#ifndef __CACTUSOS__SYSTEM__DISKS__BLOCKCACHE_H
+#define __CACTUSOS__SYSTEM__DISKS__BLOCKCACHE_H
+
+#include <common/types.h>
+#include <system/tasking/lock.h>
+
+namespace HeisenOs
+{
+    namespace system
+    {
+        #define BLOCKCACHE_ENTRIES 512
+        #define BLOCKCACHE_HASH_SIZE 1024 // Needs to be a power of 2
+        #define BLOCKCACHE_FLUSH_INTERVAL 5000 // Dirty blocks are written back at least this often (ms)
+
+        class Disk;
+
+        // One cached block of a disk
+        struct BlockCacheEntry
+        {
+            Disk* disk;
+            common::uint32_t lba;
+            common::uint8_t* data;
+            common::uint32_t dataSize;
+            bool valid;
+            bool dirty;
+            // The data is being read from the device or written by a caller, others have to wait for it
+            bool filling;
+            // Threads that use the data without holding the lock, the entry can't be reused until they are done
+            common::uint32_t pins;
+
+            // Next entry in the same hash bucket
+            BlockCacheEntry* hashNext;
+            // Neighbours in the LRU list, the head is the most recently used
+            BlockCacheEntry* lruNext;
+            BlockCacheEntry* lruPrev;
+        };
+
+        /**
+         * Cache of disk blocks shared by all disks, keyed by disk and lba.
+         * Writes are kept in the cache until the block is evicted or the disk is flushed.
+         * The lock is only held while the cache itself is changed, never during device transfers or copies to the caller.
+        */
+        class BlockCache
+        {
+        private:
+            static BlockCacheEntry entries[BLOCKCACHE_ENTRIES];
+            static BlockCacheEntry* hashTable[BLOCKCACHE_HASH_SIZE];
+            static BlockCacheEntry* lruHead;
+            static BlockCacheEntry* lruTail;
+            static MutexLock cacheLock;
+
+            static common::uint32_t Hash(Disk* disk, common::uint32_t lba);
+            static BlockCacheEntry* Find(Disk* disk, common::uint32_t lba);
+            // Get a free or least recently used entry, writing it back first when needed
+            // Returns 0 when all entries are in use or when the block was added by another thread during a write back
+            static BlockCacheEntry* Allocate(Disk* disk, common::uint32_t lba);
+            static void RemoveFromHash(BlockCacheEntry* entry);
+            static void MoveToFront(BlockCacheEntry* entry);
+            // Drop the block of this entry, the entry is reused first
+            static void Release(BlockCacheEntry* entry);
+            // Write a dirty block to the device, the lock is released during the transfer
+            static char WriteBack(BlockCacheEntry* entry);
+
+            // Let other threads continue while the lock is released, for entries that are being filled
+            static void Wait();
+            // Copy the data of the entry to buf without holding the lock
+            static void CopyOut(BlockCacheEntry* entry, common::uint8_t* buf);
+            // Replace the data of the entry with buf without holding the lock, the entry must not be in use
+            static void CopyIn(BlockCacheEntry* entry, common::uint8_t* buf);
+        public:
+            static common::uint32_t hits;
+            static common::uint32_t misses;
+            static common::uint32_t dirtyBlocks;
+            static common::uint32_t writeBacks;
+
+            static void Initialize();
+
+            // Read a block of the disk, returns 0 on succes like Disk::ReadSector
+            static char Read(Disk* disk, common::uint32_t lba, common::uint8_t* buf);
+            // Write a block of the disk, it is only written to the device later on
+            static char Write(Disk* disk, common::uint32_t lba, common::uint8_t* buf);
+
+            // Read a range of blocks, blocks that are not cached are read from the device in runs without being added to the cache
+            static char ReadBlocks(Disk* disk, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+            // Write a range of blocks directly to the device, cached copies are updated before the transfer
+            static char WriteBlocks(Disk* disk, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+
+            // Write all dirty blocks of a disk to the device, or of all disks when disk is 0
+            static char Flush(Disk* disk = 0);
+            // Remove all blocks of a disk from the cache without writing them, used when the disk or media is gone
+            static void Invalidate(Disk* disk);
+        };
+    }
+}
+
+#endif
@@ -32,8 +32,19 @@ namespace HeisenOs
 
             Disk(common::uint32_t controllerIndex, DiskController* controller, DiskType type, common::uint64_t size, common::uint32_t blocks, common::uint32_t blocksize);
             
-            virtual char ReadSector(common::uint32_t lba, common::uint8_t* buf);          
-            virtual char WriteSector(common::uint32_t lba, common::uint8_t* buf);
+            // Read or write a sector through the block cache
+            char ReadSector(common::uint32_t lba, common::uint8_t* buf);
+            char WriteSector(common::uint32_t lba, common::uint8_t* buf);
+
+            // Read or write count sequential sectors, uncached sectors are transfered with one request to the device
+            char ReadSectors(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+            char WriteSectors(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+
+            // Read or write a sector on the device itself, only used by the block cache
+            virtual char ReadSectorDirect(common::uint32_t lba, common::uint8_t* buf);
+            virtual char WriteSectorDirect(common::uint32_t lba, common::uint8_t* buf);
+            virtual char ReadSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+            virtual char WriteSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
         };
     }
 }
@@ -20,6 +20,9 @@ namespace HeisenOs
 
             virtual char ReadSector(common::uint16_t drive, common::uint32_t lba, common::uint8_t* buf);
             virtual char WriteSector(common::uint16_t drive, common::uint32_t lba, common::uint8_t* buf);   
+            // Read or write count sequential sectors with as few commands as possible
+            virtual char ReadSectors(common::uint16_t drive, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
+            virtual char WriteSectors(common::uint16_t drive, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf);
             virtual bool EjectDrive(common::uint8_t drive);         
         };
     }
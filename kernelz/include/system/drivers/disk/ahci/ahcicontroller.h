@@ -47,6 +47,8 @@ namespace HeisenOs
                 // DiskController Functions
                 char ReadSector(common::uint16_t drive, common::uint32_t lba, common::uint8_t* buf) override;
                 char WriteSector(common::uint16_t drive, common::uint32_t lba, common::uint8_t* buf) override;
+                char ReadSectors(common::uint16_t drive, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf) override;
+                char WriteSectors(common::uint16_t drive, common::uint32_t lba, common::uint32_t count, common::uint8_t* buf) override;
                 bool EjectDrive(common::uint8_t drive) override;
             };
         }
@@ -8,6 +8,7 @@
 #include <system/drivers/disk/ahci/ahcidefs.h>
 
 #include <system/disks/diskcontroller.h>
+#include <system/tasking/lock.h>
 
 namespace HeisenOs
 {
@@ -15,6 +16,13 @@ namespace HeisenOs
     {
         namespace drivers
         {
+            // Maximum amount of bytes transfered with one command
+            #define AHCI_MAX_TRANSFER_SIZE 64_KB
+            // PRDT entries needed for the worst case, one entry per page the buffer touches
+            #define AHCI_MAX_PRDT_ENTRIES (AHCI_MAX_TRANSFER_SIZE / 4_KB + 1)
+            // Size of one command table in the pool, a power of 2 so that a table never crosses a page
+            #define AHCI_COMMAND_TABLE_SIZE 512
+
             class AHCIController;
             class AHCIPort
             {
@@ -31,6 +39,13 @@ namespace HeisenOs
                 a_fis_t* fis = 0;
                 uint32_t fisPhys = 0;
 
+                // Command table for each slot, allocated once when the port is prepared
+                uint8_t* commandTables = 0;
+
+                // Used instead of the callers buffer when it can not be used for DMA directly
+                uint8_t* bounceBuffer = 0;
+                MutexLock bounceLock;
+
                 int index = -1;
                 bool isATATPI = false;
                 bool useLBA48 = false;
@@ -49,6 +64,13 @@ namespace HeisenOs
 
                 // Find a CMD slot which is ready for commands
                 int FindFreeCMDSlot();
+
+                // Get the command table of a slot with the FIS and command area cleared
+                a_commandTable_t* PrepareCommandTable(int slot);
+
+                // Fill the PRDT with the physical regions of a buffer, returns the number of entries used
+                // Returns 0 when a page is not present, or not writeable while the device writes to it
+                uint32_t BuildPRDT(a_commandTable_t* cmdTable, uint8_t* buffer, uint32_t size, bool deviceWrites);
             public:
                 AHCIPort(AHCIController* parent, uint32_t regBase, int index);
                 ~AHCIPort();
@@ -74,9 +96,12 @@ namespace HeisenOs
                 // Send Identify command to port
                 bool Identify(uint8_t* buffer);
 
-                // Read or write sectors to device
+                // Read or write sectors to device, at most AHCI_MAX_TRANSFER_SIZE bytes at a time
                 bool TransferData(bool dirIn, uint32_t lba, uint8_t* buffer, uint32_t count = 1);
 
+                // Size of one sector of the attached device
+                uint32_t SectorSize();
+
                 // Eject drive if it is a ATAPI device
                 bool Eject();
             };
@@ -101,6 +101,7 @@ namespace HeisenOs
             #define IDE_CHANNEL_SECONDARY   0x01
 
             #define IDE_TIMEOUT 1000
+            #define IDE_DMA_BUFFER_SIZE 32_KB // Also the maximum amount of bytes transfered with one command
             #define IDE_LOG Log(Info, "IDE %s On line %d", __FILE__, __LINE__);
 
             struct IDEPhysRegionDescriptor
@@ -148,10 +149,9 @@ namespace HeisenOs
                     int8_t dmaLevel;      // DMA Type of this drive
                 } specs;
 
-                IDEPhysRegionDescriptor* prdt;              // Physical Region Descriptor Table for this channel
+                IDEPhysRegionDescriptor* prdt;              // Physical Region Descriptor Table for this channel, one entry per page of prdtBuffer
                 uint32_t                 prdtPhys;          // Physical address of PRDT
                 uint8_t*                 prdtBuffer;        // Buffer for reading and writing with DMA commands
-                uint32_t                 prdtBufferPhys;    // Physical address of memory pointed to by prdtBuffer
             };
 
             // Does device support DMA Commands?
@@ -212,6 +212,9 @@ namespace HeisenOs
                 // Wait for IRQ to be fired
                 inline const void WaitForIRQ();
 
+                // Set the byte counts of the PRDT entries of a device for a transfer of this size
+                inline const void SetupPRDT(IDEDevice* dev, uint32_t bytes);
+
                 bool WaitForClear(uint8_t channel, uint8_t reg, uint8_t bits, uint32_t timeout, bool yield = false); // Wait for register to clear specific bit
                 bool WaitForSet(uint8_t channel, uint8_t reg, uint8_t bits, uint32_t timeout, bool yield = false);   // Wait for register to set specific bit
             public:
@@ -227,23 +230,25 @@ namespace HeisenOs
                 // DiskController Functions
                 char ReadSector(uint16_t drive, uint32_t lba, uint8_t* buf) override;
                 char WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf) override;
+                char ReadSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf) override;
+                char WriteSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf) override;
                 bool EjectDrive(uint8_t drive) override;
 
-                // Read/Write functions for ATA/ATAPI using DMA
+                // Read/Write functions for ATA/ATAPI using DMA, at most IDE_DMA_BUFFER_SIZE bytes at a time
 
                 // Transfer sectors via DMA to a ATA device
-                char ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t* buf, bool read);
+                char ATA_DMA_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf, bool read);
                 
                 // Transfer sectors via DMA to a ATAPI device (only read is supported)
-                char ATAPI_DMA_TransferSector(uint16_t drive, uint16_t lba, uint8_t* buf);
+                char ATAPI_DMA_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf);
             
                 // Read/Write functions for ATA/ATAPI using PIO
 
                 // Transfer sectors via PIO to a ATA device
-                char ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t* buf, bool read);
+                char ATA_PIO_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf, bool read);
                 
                 // Transfer sectors via PIO to a ATAPI device (only read is supported)
-                char ATAPI_PIO_TransferSector(uint16_t drive, uint16_t lba, uint8_t* buf);
+                char ATAPI_PIO_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf);
             };
         }
     }
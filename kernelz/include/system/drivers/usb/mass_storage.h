@@ -24,6 +24,8 @@ namespace HeisenOs
             //#define SCSI_READ_12                0xA8
             //#define SCSI_WRITE_12               0xAA
 
+            #define MSD_MAX_TRANSFER_SIZE 64_KB // Maximum amount of bytes transfered with one SCSI command
+
             #define CBW_SIGNATURE 0x43425355
             #define CSW_SIGNATURE 0x53425355
 
@@ -157,9 +159,13 @@ namespace HeisenOs
                 void DeInitialize() override;
 
                 // Read Sector from mass storage device
-                char ReadSector(common::uint32_t lba, common::uint8_t* buf) override;
+                char ReadSectorDirect(common::uint32_t lba, common::uint8_t* buf) override;
                 // Write Sector to mass storage device
-                char WriteSector(common::uint32_t lba, common::uint8_t* buf) override;
+                char WriteSectorDirect(common::uint32_t lba, common::uint8_t* buf) override;
+                // Read multiple sectors from mass storage device
+                char ReadSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf) override;
+                // Write multiple sectors to mass storage device
+                char WriteSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf) override;
             };
         }
     }
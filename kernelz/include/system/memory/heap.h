@@ -3,6 +3,7 @@
 
 #include <core/virtualmemory.h>
 #include <system/tasking/lock.h>
+#include <system/memory/slab.h>
 
 namespace HeisenOs
 {
@@ -10,6 +11,10 @@ namespace HeisenOs
     {
         #define KERNEL_HEAP_START (KERNEL_VIRT_ADDR + 4_MB)
         #define KERNEL_HEAP_SIZE 16_MB
+        #define KERNEL_HEAP_PAGES (KERNEL_HEAP_SIZE / 4_KB)
+
+        // We only run on one cpu for now, but the magazines are already kept per cpu
+        #define HEAP_MAX_CPUS 1
 
         // Only split a memory block when we can use it to store this amount of data in it
         #define MINIMAL_SPLIT_SIZE 4
@@ -34,15 +39,36 @@ namespace HeisenOs
 
         class KernelHeap
         {
+        friend class SlabCache;
         private:
             static common::uint32_t startAddress;
             static common::uint32_t endAddress;
 
             static MemoryHeader* firstHeader;
 
+            // Small allocations are served by these caches, larger ones by the first-fit list
+            static SlabCache slabCaches[SLAB_CACHE_COUNT];
+            // Slab that owns each page of the heap, or 0 when the page belongs to the first-fit list
+            static Slab* slabPages[KERNEL_HEAP_PAGES];
+            // Recently freed small objects, these are handed out again without taking the heapMutex
+            static HeapCPUCache cpuCaches[HEAP_MAX_CPUS];
+
+            static inline int CurrentCPU() { return 0; }
+            static inline int CacheIndexForSize(common::uint32_t size)
+            {
+                return size <= SLAB_MIN_OBJECT_SIZE ? 0 : (32 - __builtin_clz(size - 1)) - 4;
+            }
+
+            static void* SmallAllocate(common::uint32_t size);
+            static void SmallFree(Slab* slab, void* ptr);
+
+            // These expect the heapMutex to be held
             static void* InternalAllocate(common::uint32_t size);
+            static void InternalFree(void* ptr);
             static MemoryHeader* FirstFree(common::uint32_t size);
 
+            static void SetSlabPages(Slab* slab, Slab* owner);
+
             static MutexLock heapMutex;
         public:
             static void Initialize(common::uint32_t start, common::uint32_t end);
@@ -55,6 +81,13 @@ namespace HeisenOs
 
             static bool CheckForErrors();
             static common::uint32_t UsedMemory();
+
+            // Get one of the slab caches, used for the statistics in the systeminfo listing
+            static SlabCache* GetSlabCache(int index);
+            // Allocations of a slab cache that were served by the magazines of all cpu's
+            static common::uint32_t MagazineHits(int index);
+            // How many times a thread had to wait for the heapMutex
+            static common::uint32_t LockContention();
         };
     }
 }
@@ -0,0 +1,61 @@
+#ifndef __CACTUSOS__SYSTEM__MEMORY__PAGECACHE_H
+#define __CACTUSOS__SYSTEM__MEMORY__PAGECACHE_H
+
+#include <common/types.h>
+
+namespace HeisenOs
+{
+    namespace system
+    {
+        #define PAGECACHE_HASH_SIZE 256 // Needs to be a power of 2
+
+        // Bits stored in the unused field of a page table entry
+        #define PAGE_SHARED         (1<<0) // Frame is owned by the page cache
+        #define PAGE_COPY_ON_WRITE  (1<<1) // Page is writeable, a private copy is made on the first write
+
+        class VirtualFileSystem;
+
+        // A page of an excecutable mapped by one or more processes
+        struct CachedPage
+        {
+            VirtualFileSystem* fs;
+            common::uint32_t fileLocation;
+            common::uint32_t virtAddress;
+            common::uint32_t physAddress;
+            int refCount;
+            // Set when the file might have changed, the page is not handed out anymore
+            bool stale;
+
+            // Next page in the same hash bucket
+            CachedPage* hashNext;
+        };
+
+        /**
+         * Cache of the loaded pages of excecutables, keyed by file and virtual address.
+         * Processes running the same file map the same physical pages.
+        */
+        class PageCache
+        {
+        private:
+            static CachedPage* hashTable[PAGECACHE_HASH_SIZE];
+
+            static common::uint32_t Hash(common::uint32_t fileLocation, common::uint32_t virtAddress);
+        public:
+            // Pages present in the cache
+            static common::uint32_t cachedPages;
+            // Mappings that reuse an already loaded page, so physical pages saved
+            static common::uint32_t sharedPages;
+
+            // Get the physical address of a cached page and add a reference to it, returns 0 when not cached
+            static common::uint32_t Acquire(VirtualFileSystem* fs, common::uint32_t fileLocation, common::uint32_t virtAddress);
+            // Add a loaded page to the cache with one reference, the cache owns the physical page from now on
+            static void Insert(VirtualFileSystem* fs, common::uint32_t fileLocation, common::uint32_t virtAddress, common::uint32_t physAddress);
+            // Remove a reference to a cached page, the physical page is freed after the last one
+            static void Release(common::uint32_t fileLocation, common::uint32_t virtAddress, common::uint32_t physAddress);
+            // Stop handing out pages of a filesystem, used when files on it are changed
+            static void Invalidate(VirtualFileSystem* fs);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __CACTUSOS__SYSTEM__MEMORY__PIPE_H
+#define __CACTUSOS__SYSTEM__MEMORY__PIPE_H
+
+#include <common/types.h>
+#include <common/list.h>
+#include <system/memory/stream.h>
+
+namespace HeisenOs
+{
+    namespace system
+    {
+        struct Thread;
+
+        #define PIPE_DEFAULT_CAPACITY 16_KB
+
+        /**
+         * Stream used for the standard input of processes
+         * Readers are blocked while the pipe is empty and writers while it is full
+        */
+        class Pipe : public Stream
+        {
+        private:
+            // Internal ring buffer
+            char* buffer;
+            // Size of the buffer
+            int capacity;
+            // Number of bytes in the buffer
+            int count;
+            // Index where the next byte is read from
+            int readPos;
+            // Index where the next byte is written to
+            int writePos;
+
+            // The writer is removed, the next read of an empty pipe returns 0 instead of blocking
+            bool hangup;
+
+            // Threads waiting for data or space
+            List<Thread*> readers;
+            List<Thread*> writers;
+
+            void WakeAll(List<Thread*>* waiters);
+        public:
+            /**
+             * Create a new pipe
+            */
+            Pipe(int capacity = PIPE_DEFAULT_CAPACITY);
+            /**
+             * Delete the pipe, blocked writers return with the bytes written so far
+            */
+            ~Pipe();
+
+            /**
+             * Read a byte from the pipe, returns 0 when empty
+            */
+            char Read();
+            /**
+             * Write a byte to the pipe, blocks when it is full
+            */
+            void Write(char byte);
+            /**
+             * How many bytes can currently be read?
+            */
+            int Available();
+
+            /**
+             * Read up to length bytes, blocks until at least one byte is available
+             * Returns 0 when the pipe is empty and the writer is gone
+            */
+            int Read(char* buffer, int length);
+            /**
+             * Write length bytes, blocks while the pipe is full until everything is written
+            */
+            int Write(const char* buffer, int length);
+            /**
+             * Remove the blocked readers and writers of a process that is being removed
+            */
+            void RemoveWaiters(Process* proc);
+            /**
+             * Wake up the readers, there will be no more data from the current writer
+            */
+            void Hangup();
+        };
+    }
+}
+
+#endif
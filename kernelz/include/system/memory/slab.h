@@ -0,0 +1,100 @@
+#ifndef __CACTUSOS__SYSTEM__SLAB_H
+#define __CACTUSOS__SYSTEM__SLAB_H
+
+#include <common/types.h>
+
+namespace HeisenOs
+{
+    namespace system
+    {
+        // Size of one slab, every slab is page aligned so we can find it back from an object pointer
+        #define SLAB_SIZE 16_KB
+
+        #define SLAB_MIN_OBJECT_SIZE 16
+        #define SLAB_MAX_OBJECT_SIZE 2_KB
+        #define SLAB_CACHE_COUNT 8 // 16, 32, 64, 128, 256, 512, 1024 and 2048 bytes
+
+        // Magic number used for slab headers
+        #define SLAB_MAGIC 0x51AB51AB
+
+        #define SLAB_BITMAP_WORDS (SLAB_SIZE / SLAB_MIN_OBJECT_SIZE / 32)
+
+        // Amount of objects a magazine can hold, and how many are moved at once between it and the slab cache
+        #define MAGAZINE_SIZE 32
+        #define MAGAZINE_BATCH (MAGAZINE_SIZE / 2)
+
+        class SlabCache;
+
+        // Header placed at the start of every slab
+        struct Slab
+        {
+            common::uint32_t magic;
+            SlabCache* cache;
+
+            Slab* next;
+            Slab* prev;
+
+            // Block allocated from the first-fit heap that holds this slab
+            void* block;
+
+            common::uint32_t firstObject;
+            common::uint16_t numObjects;
+            common::uint16_t usedObjects;
+
+            // Word of the bitmap where we found a free object the last time
+            common::uint32_t freeHint;
+            // A set bit means the object is free
+            common::uint32_t freeMap[SLAB_BITMAP_WORDS];
+        } __attribute__((packed));
+
+        // Objects of one size class that were freed recently on a cpu
+        struct SlabMagazine
+        {
+            common::uint32_t count;
+            void* objects[MAGAZINE_SIZE];
+        };
+
+        // Magazines of one cpu, only used with interrupts disabled so they don't need a lock
+        struct HeapCPUCache
+        {
+            SlabMagazine magazines[SLAB_CACHE_COUNT];
+
+            // Allocations served directly from a magazine
+            common::uint32_t hits[SLAB_CACHE_COUNT];
+        };
+
+        // A cache of objects of one size, used by the kernel heap for small allocations
+        class SlabCache
+        {
+        private:
+            // Slabs with at least one free object
+            Slab* partialSlabs;
+            // Slabs without any free objects
+            Slab* fullSlabs;
+
+            Slab* CreateSlab();
+            void DestroySlab(Slab* slab);
+
+            static void AddToList(Slab** list, Slab* slab);
+            static void RemoveFromList(Slab** list, Slab* slab);
+        public:
+            common::uint32_t objectSize;
+            common::uint32_t objectShift;
+
+            // Statistics
+            common::uint32_t numSlabs;
+            common::uint32_t emptySlabs;
+            common::uint32_t objectsLive;
+            common::uint32_t allocations;
+            common::uint32_t misses; // Allocations that needed a new slab
+
+            void Initialize(common::uint32_t objectShift);
+
+            // Both functions expect the heap mutex to be held
+            void* Allocate();
+            void Free(Slab* slab, void* ptr);
+        };
+    }
+}
+
+#endif
@@ -7,6 +7,8 @@ namespace HeisenOs
 {
     namespace system
     {
+        struct Process;
+
         class Stream
         {
         public:
@@ -31,6 +33,25 @@ namespace HeisenOs
              * How many bytes can currently be read?
             */
             virtual int Available();
+
+            /**
+             * Read up to length bytes into buffer, waits until at least one byte is available
+             * Returns the amount of bytes read
+            */
+            virtual int Read(char* buffer, int length);
+            /**
+             * Write length bytes from buffer to this stream
+             * Returns the amount of bytes written
+            */
+            virtual int Write(const char* buffer, int length);
+            /**
+             * Forget the threads of a process that are waiting on this stream, called when the process is removed
+            */
+            virtual void RemoveWaiters(Process* proc);
+            /**
+             * The process writing to this stream is removed, a reader waiting for data returns with nothing
+            */
+            virtual void Hangup();
         };
     }
 }
@@ -5,6 +5,8 @@
 #define ENABLE_USB 1            // Enable USB-Stack
 #define ENABLE_MEMORY_CHECKS 1  // Enable the checking of memory on a specified interval
 #define ENABLE_ADV_DEBUG 1      // Enable advanced debugging features
+#define ENABLE_BOOT_BENCHMARKS 0 // Run benchmarks of kernel subsystems during boot
+#define ENABLE_TICKLESS_IDLE 1  // Stop the periodic timer while the system is idle
 
 #include <system/bootconsole.h>
 #include <system/components/systemcomponent.h>
@@ -27,6 +29,7 @@
 #include <system/drivers/integrated/ps2-keyboard.h>
 #include <system/drivers/integrated/floppy.h>
 #include <system/disks/diskmanager.h>
+#include <system/disks/blockcache.h>
 #include <system/disks/partitionmanager.h>
 #include <system/vfs/vfsmanager.h>
 #include <system/tasking/scheduler.h>
@@ -74,13 +77,18 @@ namespace HeisenOs
         public:
             StandardOutSteam() : Stream() {}
 
-            // We only overwrite the write function since reading is not supported
+            // We only overwrite the write functions since reading is not supported
             void Write(char byte)
             {
                 char str[1];
                 str[0] = byte;
                 Print(str, 1);
             }
+            int Write(const char* buffer, int length)
+            {
+                Print(buffer, length);
+                return length;
+            }
         };     
 
         class System
@@ -8,16 +8,15 @@ namespace HeisenOs
 {
     namespace system
     {
-        struct IPCReceiveDescriptor
+        // Number of messages send for each process count by the benchmark
+        #define IPC_BENCHMARK_MESSAGES 100000
+
+        // Thread waiting on a word in (shared) memory
+        struct FutexWaiter
         {
-            // Which process is waiting for a message?
-            Process* receivingProcess;
-            // Which thread called receive and is currently blocked.
-            Thread* receivingThread;
-            // Do we need to receive the message from a specific process?
-            int receiveFromPID;
-            // Do we need to receive a specific type of message?
-            int receiveType;
+            // Physical address of the word, the same word can be mapped at different addresses in each process
+            common::uint32_t physAddress;
+            Thread* thread;
         };
 
         class IPCManager
@@ -26,6 +25,16 @@ namespace HeisenOs
             static void Initialize();
             static void HandleSend(core::CPUState* state, Process* proc);
             static void HandleReceive(core::CPUState* state, Process* proc);
+
+            // Block the current thread if the word at address still contains expected
+            static int FutexWait(Process* proc, common::uint32_t address, common::uint32_t expected);
+            // Wake at most count threads waiting on the word at address, returns number of threads woken
+            static int FutexWake(Process* proc, common::uint32_t address, int count);
+            // Remove the threads of a process from the futex waiters
+            static void RemoveWaiters(Process* proc);
+
+            // Measure send and receive time with 1, 16 and 128 processes present
+            static void Benchmark();
         };
     }
 }
@@ -12,6 +12,9 @@ namespace HeisenOs
         private:
             int value = 0;
         public:
+            // Amount of times Lock() had to wait for another thread
+            common::uint32_t contended = 0;
+
             MutexLock();
 
             void Lock();
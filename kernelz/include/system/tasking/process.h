@@ -12,6 +12,7 @@ namespace HeisenOs
     namespace system
     {
         class SymbolDebugger;
+        struct VFSOpenFile;
         
         enum ProcessState
         {
@@ -19,9 +20,22 @@ namespace HeisenOs
         };
 
         #define PROC_USER_HEAP_SIZE 1_MB //1 MB heap space for processes, and of course more if needed.
+        #define PROC_MAX_OPEN_FILES 16
+        #define PROC_TABLE_SIZE 256 // Buckets of the process table, needs to be a power of 2
+        #define PROC_MAX_SEGMENTS 8 // Maximum amount of loadable segments in an excecutable
 
         struct Thread;
 
+        // Loadable part of an excecutable, its pages are read from the file on first access
+        struct ExcecutableSegment
+        {
+            common::uint32_t virtAddress;
+            common::uint32_t memSize;
+            common::uint32_t fileOffset;
+            common::uint32_t fileSize;
+            bool writeable;
+        };
+
         struct Process
         {
             int id;
@@ -35,6 +49,11 @@ namespace HeisenOs
             {
                 common::uint32_t memBase;
                 common::uint32_t memSize;
+
+                // File the segments are loaded from
+                VFSOpenFile* file;
+                ExcecutableSegment segments[PROC_MAX_SEGMENTS];
+                int numSegments;
             } excecutable;
             
             struct Heap
@@ -43,28 +62,60 @@ namespace HeisenOs
                 common::uint32_t heapEnd;
             } heap;
             List<LIBHeisenKernel::IPCMessage> ipcMessages;
+            // Threads blocked until a message arrives
+            List<Thread*> ipcReceivers;
 
             Stream* stdInput;
             Stream* stdOutput;
 
+            // Files opened by this process, the index is used as file descriptor
+            VFSOpenFile* openFiles[PROC_MAX_OPEN_FILES];
+
             // For Debuging
             char fileName[32];
 
             // Debugger assigned to this process
             SymbolDebugger* symDebugger = 0;
+
+            // Next process in the same bucket of the process table
+            Process* hashNext;
+
+            // Time in ms at which the process was created
+            common::uint64_t startTicks;
+            // Amount of pages loaded by page faults
+            common::uint32_t demandPages;
         };
 
         class ProcessHelper
         {
         private:
             ProcessHelper();
+
+            // Processes hashed by their id, for fast lookups by ProcessById
+            static Process* processTable[PROC_TABLE_SIZE];
         public:
             static List<Process*> Processes;
+
+            // Add a process to the list of known processes and the process table
+            static void AddProcess(Process* proc);
+            // Remove a process from the list of known processes and the process table
+            static void ForgetProcess(Process* proc);
             
             static Process* Create(char* fileName, char* arguments = 0, bool isKernel = false);
             static Process* CreateKernelProcess();
             static void RemoveProcess(Process* proc);
-            static void UpdateHeap(Process* proc, common::uint32_t newEndAddr);
+            // Grow or shrink the heap so it ends at newEndAddr, returns false when it can not be expanded
+            static bool UpdateHeap(Process* proc, common::uint32_t newEndAddr);
+            // Load the page of the excecutable containing address, returns false if the address is not part of it
+            // The file is only read when allowIO is set, kernel code could be holding locks that the disk read needs
+            static bool HandlePageFault(Process* proc, common::uint32_t address, bool allowIO);
+            // Give the process a private copy of a shared page it writes to, returns false if the page is not copy-on-write
+            static bool HandleCopyOnWrite(Process* proc, common::uint32_t address);
+            // Load the pages of a user buffer and make private copies of the ones that will be written
+            // Called by system calls before they use the buffer, returns false if it is not valid memory of the process
+            static bool PrepareUserBuffer(Process* proc, common::uint32_t address, common::uint32_t length, bool write);
+            // Same for a zero terminated string that is only read
+            static bool PrepareUserString(Process* proc, const char* string);
             static Process* ProcessById(int id);
         };
     }
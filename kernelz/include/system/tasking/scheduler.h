@@ -4,28 +4,72 @@
 #include <common/types.h>
 #include <system/interruptmanager.h>
 #include <system/tasking/thread.h>
+#include <system/benchmark.h>
 
 namespace HeisenOs
 {
     namespace system
     {
+        // Length of the time slice in ticks for a thread with normal priority
         #define SCHEDULER_FREQUENCY 30
 
+        // Ready threads sorted by priority, with one bit set in the bitmap for each level that is not empty
+        struct RunQueue
+        {
+            ThreadQueue levels[THREAD_PRIORITY_LEVELS];
+            common::uint32_t bitmap;
+        };
+
         class Scheduler : public InterruptHandler
         {
         private:
             common::uint32_t frequency = 0;
             common::uint32_t tickCount = 0;
+            common::uint32_t threadCount = 0;
+            // Timer ticks since boot, forced switches are not counted
+            common::uint32_t timerTicks = 0;
 
-            List<Thread*> threadsList;
+            // Threads are picked from the active queue, and put on the expired queue when their time slice is over.
+            // When the active queue is empty the two are swapped, this way low priority threads still get to run.
+            RunQueue runQueues[2];
+            RunQueue* activeQueue = 0;
+            RunQueue* expiredQueue = 0;
+            ThreadQueue blockedThreads;
+            // Sleeping threads sorted by wake-up time, only the first one needs to be updated each tick
+            ThreadQueue sleepingThreads;
             Thread* currentThread = 0;
 
+            // Cycles spent halted in the current measuring window
+            common::uint64_t idleCycles = 0;
+            // When the cpu was halted, 0 when it is running
+            common::uint64_t idleStart = 0;
+            common::uint64_t idleWindowStart = 0;
+            common::uint32_t idleWindowTick = 0;
+
+            void UpdateIdleStatistics();
+
             Thread* GetNextReadyThread();
-            void ProcessSleepingThreads();
+            // Wake up the threads whose sleep has ended, returns true when the current thread should make room for one of them
+            bool ProcessSleepingThreads(common::uint32_t ticks);
+            void AddSleepingThread(Thread* thread);
+
+            void Enqueue(Thread* thread, bool expired = false, bool front = false);
+            void Dequeue(Thread* thread);
+            void RemoveStoppedThread(Thread* thread);
+            common::uint32_t TimeSlice(Thread* thread);
 
             bool switchForced = false; //Is the current switch forced by a forceSwitch() call?
         public:
             bool Enabled = true;
+
+            // Time between the end of a sleep and the thread running again
+            LatencyHistogram wakeLatency;
+            common::uint32_t wakeups = 0;
+            // Wake-ups that took longer than one tick
+            common::uint32_t lateWakeups = 0;
+            // Percentage of time the cpu was halted during the last second
+            common::uint32_t idlePercentage = 0;
+
             Scheduler();
 
             common::uint32_t HandleInterrupt(common::uint32_t esp);
@@ -41,6 +85,14 @@ namespace HeisenOs
             //Blocking and unblocking
             void Block(Thread* thread, BlockedState reason = BlockedState::Unkown);
             void Unblock(Thread* thread, bool forceSwitch = false);
+
+            void SetPriority(Thread* thread, common::uint32_t priority);
+
+            // Let the current thread sleep without keeping the cpu busy, falls back to the PIT when we can't block
+            void Sleep(common::uint32_t ms);
+            // Called by the idle thread, switches to an other thread or halts the cpu when there is none
+            void Idle();
+            common::uint32_t ThreadCount();
         };
     }   
 }
@@ -17,6 +17,12 @@ namespace HeisenOs
         #define SEG_KERNEL_DATA 0x10
         #define SEG_KERNEL_CODE 8
 
+        // Threads with a higher priority are picked first and get a longer time slice
+        #define THREAD_PRIORITY_LEVELS 8
+        #define THREAD_PRIORITY_IDLE 0
+        #define THREAD_PRIORITY_NORMAL 3
+        #define THREAD_PRIORITY_HIGHEST (THREAD_PRIORITY_LEVELS - 1)
+
         enum ThreadState
         {
             Blocked,
@@ -33,6 +39,15 @@ namespace HeisenOs
         };
 
         struct Process;
+        struct Thread;
+
+        // Intrusive list of threads, used for the queues of the scheduler
+        struct ThreadQueue
+        {
+            Thread* head;
+            Thread* tail;
+            common::uint32_t count;
+        };
 
         struct Thread
         {
@@ -44,8 +59,24 @@ namespace HeisenOs
             BlockedState blockedState;
             core::CPUState* regsPtr;
             
+            // Ticks left to sleep, relative to the thread before it on the sleeping queue
             common::uint32_t timeDelta;
             common::uint8_t* FPUBuffer;
+
+            // When this thread was woken up after sleeping, used to measure the wake-up latency
+            common::uint64_t wakeTimestamp;
+            common::uint32_t wakeTick;
+
+            common::uint32_t priority;
+
+            // Which messages this thread is waiting for when blocked in IPC receive, -1 for any
+            int ipcReceiveFrom;
+            int ipcReceiveType;
+
+            // Scheduler queue this thread is currently on, 0 when it is running or not added yet
+            ThreadQueue* queue;
+            Thread* queueNext;
+            Thread* queuePrev;
         };
 
         class ThreadHelper
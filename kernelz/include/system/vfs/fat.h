@@ -155,6 +155,10 @@ namespace HeisenOs
             // Convert a cluster number to its corresponding start sector
             common::uint32_t ClusterToSector(common::uint32_t cluster);
 
+            // Read length bytes from sequential sectors, starting offset bytes into the first sector
+            // Whole sectors are read directly into the destination with one request
+            int ReadSectorRange(common::uint32_t sector, common::uint32_t offset, common::uint32_t length, common::uint8_t* dest);
+
             // Reads the FAT table and returns the value for the specific cluster
             common::uint32_t ReadTable(common::uint32_t cluster);
 
@@ -241,6 +245,10 @@ namespace HeisenOs
 
             // Read file contents into buffer
             int ReadFile(const char* filename, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
+            // Resolve a path to a node, returns false when it does not exist
+            bool LookupEntry(const char* path, VFSNode* node);
+            // Read file contents of a resolved node into buffer
+            int ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
             // Write buffer to file, file will be created when create equals true
             int WriteFile(const char* filename, uint8_t* buffer, uint32_t len, bool create = true);
 
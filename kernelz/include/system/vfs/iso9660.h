@@ -125,6 +125,10 @@ namespace HeisenOs
 
             // Read file contents into buffer
             int ReadFile(const char* filename, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
+            // Resolve a path to a node, returns false when it does not exist
+            bool LookupEntry(const char* path, VFSNode* node);
+            // Read file contents of a resolved node into buffer
+            int ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
             // Write buffer to file, file will be created when create equals true
             int WriteFile(const char* filename, uint8_t* buffer, uint32_t len, bool create = true);
 
@@ -2,18 +2,74 @@
 #define __CACTUSOS__SYSTEM__VFS__VFSMANAGER_H
 
 #include <system/vfs/virtualfilesystem.h>
+#include <system/tasking/lock.h>
  
 namespace HeisenOs
 {
     namespace system
     {
+        // File read by the read benchmark from the root of every filesystem, for example a 64MB file created with dd
+        #define VFS_BENCHMARK_FILE "bench.bin"
+        #define VFS_BENCHMARK_CHUNK 1_MB
+        // File in a deep directory tree used by the lookup benchmark
+        #define VFS_BENCHMARK_DEEP_FILE "bench\\a\\b\\c\\d\\e\\f\\g\\deep.bin"
+        #define VFS_BENCHMARK_LOOKUPS 10000
+
+        #define VFS_DENTRY_CACHE_SIZE 256   // Number of resolved paths that are remembered
+        #define VFS_DENTRY_HASH_SIZE 512    // Needs to be a power of 2
+
+        // Cached result of a path lookup on a filesystem
+        struct VFSDentry
+        {
+            VirtualFileSystem* fs;
+            common::uint32_t hash;
+            char* path;
+            VFSNode node;
+
+            // Next entry in the same hash bucket
+            VFSDentry* hashNext;
+        };
+
+        // A file opened by a process
+        struct VFSOpenFile
+        {
+            VirtualFileSystem* fs;      // Set to 0 when the filesystem is unmounted
+            char* path;                 // Path on the filesystem, used to refresh the node when the file is written
+            VFSNode node;
+            common::uint32_t position;  // Offset used by reads that do not specify one
+        };
+
         class VFSManager
         {
         public:
             List<VirtualFileSystem*>* Filesystems;
+        private:
+            VFSDentry dentries[VFS_DENTRY_CACHE_SIZE];
+            VFSDentry* dentryHash[VFS_DENTRY_HASH_SIZE];
+            // Entry that is replaced next, entries are reused in a round robin way
+            common::uint32_t nextDentry = 0;
+            MutexLock dentryLock;
+            // Increased on every invalidation, lookups that started before it are not added to the cache
+            common::uint32_t dentryGeneration = 0;
+
+            List<VFSOpenFile*> openFiles;
+            // Files are opened and closed by different processes at the same time
+            MutexLock openFilesLock;
+
+            common::uint32_t HashPath(VirtualFileSystem* fs, const char* path);
+            // Resolve a path on a filesystem, using the dentry cache when possible
+            bool Resolve(VirtualFileSystem* fs, const char* path, VFSNode* node);
+            // Forget all cached lookups of a filesystem
+            void InvalidateDentries(VirtualFileSystem* fs);
+            // Get the filesystem of a path and the part of the path on that filesystem
+            VirtualFileSystem* GetFilesystem(const char* path, const char** fsPath);
         public:
             int bootPartitionID = -1;
 
+            bool dentryCacheEnabled = true;
+            common::uint32_t dentryHits = 0;
+            common::uint32_t dentryMisses = 0;
+
             VFSManager();
             void Mount(VirtualFileSystem* vfs);
             void Unmount(VirtualFileSystem* vfs);
@@ -52,6 +108,21 @@ namespace HeisenOs
 
             // Eject the drive given by a path
             bool EjectDrive(const char* path);
+
+            ///////////////////
+            // Open Files
+            ///////////////////
+
+            // Open a file for reading, returns 0 when it does not exist
+            VFSOpenFile* OpenFile(const char* path);
+            // Read from an open file at offset, or at the current position when offset is -1
+            // Returns the number of bytes read or -1 on error
+            int ReadOpenFile(VFSOpenFile* file, uint8_t* buffer, uint32_t len, uint32_t offset = -1);
+            // Close a file opened by OpenFile
+            void CloseFile(VFSOpenFile* file);
+
+            // Measure read throughput of VFS_BENCHMARK_FILE and lookup speed of VFS_BENCHMARK_DEEP_FILE on all filesystems that have it
+            void Benchmark();
         };
     }
 }
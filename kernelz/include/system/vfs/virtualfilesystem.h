@@ -14,6 +14,14 @@ namespace HeisenOs
         #define PATH_SEPERATOR_C '\\' //Path Seperator as char
         #define PATH_SEPERATOR_S "\\" //Path Seperator as string
 
+        // Resolved location of a file or directory, so that it can be read again without walking the path
+        struct VFSNode
+        {
+            common::uint32_t location;  // Filesystem specific, the first cluster for FAT and the extent for ISO9660
+            common::uint32_t size;      // Size in bytes, 0 for directories
+            bool isDirectory;
+        };
+
         class VirtualFileSystem
         {
         friend class VFSManager;
@@ -36,6 +44,10 @@ namespace HeisenOs
                
             // Read file contents into buffer
             virtual int ReadFile(const char* filename, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
+            // Resolve a path to a node, returns false when it does not exist
+            virtual bool LookupEntry(const char* path, VFSNode* node);
+            // Read file contents of a resolved node into buffer
+            virtual int ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset = 0, uint32_t len = -1);
             // Write buffer to file, file will be created when create equals true
             virtual int WriteFile(const char* filename, uint8_t* buffer, uint32_t len, bool create = true);
 
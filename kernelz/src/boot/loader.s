@@ -65,9 +65,9 @@ _entrypoint:
     or $0x00000010, %ecx
     mov %ecx, %cr4
 
-    # enable paging
+    # enable paging, with write protection so that the kernel also faults on copy-on-write pages
     mov %cr0, %ecx
-    or $0x80000001, %ecx
+    or $0x80010001, %ecx
     mov %ecx, %cr0
 
     # jump to higher half code
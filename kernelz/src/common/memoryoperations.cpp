@@ -2,18 +2,139 @@
 
 using namespace HeisenOs::common;
 
+bool MemoryOperations::nonTemporal = false;
+
+// Copy forwards with rep movsd, and rep movsb for the remaining bytes
+static inline void CopyForward(void* dst, const void* src, uint32_t size)
+{
+    uint32_t dwords = size / 4;
+    uint32_t bytes = size % 4;
+    asm volatile("rep movsl\n\t"
+                 "movl %3, %%ecx\n\t"
+                 "rep movsb"
+                 : "+D"(dst), "+S"(src), "+c"(dwords)
+                 : "r"(bytes)
+                 : "memory");
+}
+
+// Fill with rep stosd, and rep stosb for the remaining bytes
+static inline void FillForward(void* dst, uint32_t pattern, uint32_t size)
+{
+    uint32_t dwords = size / 4;
+    uint32_t bytes = size % 4;
+    asm volatile("rep stosl\n\t"
+                 "movl %3, %%ecx\n\t"
+                 "rep stosb"
+                 : "+D"(dst), "+c"(dwords)
+                 : "a"(pattern), "r"(bytes)
+                 : "memory");
+}
+
+// Copy using movnti, which writes around the cache
+static void CopyNonTemporal(void* dstptr, const void* srcptr, uint32_t size)
+{
+    uint8_t* dst = (uint8_t*)dstptr;
+    const uint8_t* src = (const uint8_t*)srcptr;
+
+    // Align the destination, so the stores can be combined into full cache lines
+    uint32_t head = (16 - ((uint32_t)dst & 15)) & 15;
+    CopyForward(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    uint32_t blocks = size / 32;
+    if(blocks) {
+        asm volatile("1:\n\t"
+                     "prefetchnta 512(%%esi)\n\t"
+                     "movl 0(%%esi), %%eax\n\t"
+                     "movl 4(%%esi), %%edx\n\t"
+                     "movnti %%eax, 0(%%edi)\n\t"
+                     "movnti %%edx, 4(%%edi)\n\t"
+                     "movl 8(%%esi), %%eax\n\t"
+                     "movl 12(%%esi), %%edx\n\t"
+                     "movnti %%eax, 8(%%edi)\n\t"
+                     "movnti %%edx, 12(%%edi)\n\t"
+                     "movl 16(%%esi), %%eax\n\t"
+                     "movl 20(%%esi), %%edx\n\t"
+                     "movnti %%eax, 16(%%edi)\n\t"
+                     "movnti %%edx, 20(%%edi)\n\t"
+                     "movl 24(%%esi), %%eax\n\t"
+                     "movl 28(%%esi), %%edx\n\t"
+                     "movnti %%eax, 24(%%edi)\n\t"
+                     "movnti %%edx, 28(%%edi)\n\t"
+                     "addl $32, %%esi\n\t"
+                     "addl $32, %%edi\n\t"
+                     "decl %%ecx\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"
+                     : "+D"(dst), "+S"(src), "+c"(blocks)
+                     :
+                     : "eax", "edx", "memory");
+    }
+
+    CopyForward(dst, src, size % 32);
+}
+
+// Fill using movnti, see CopyNonTemporal
+static void FillNonTemporal(void* dstptr, uint32_t pattern, uint32_t size)
+{
+    uint8_t* dst = (uint8_t*)dstptr;
+
+    uint32_t head = (16 - ((uint32_t)dst & 15)) & 15;
+    FillForward(dst, pattern, head);
+    dst += head;
+    size -= head;
+
+    uint32_t blocks = size / 32;
+    if(blocks) {
+        asm volatile("1:\n\t"
+                     "movnti %%eax, 0(%%edi)\n\t"
+                     "movnti %%eax, 4(%%edi)\n\t"
+                     "movnti %%eax, 8(%%edi)\n\t"
+                     "movnti %%eax, 12(%%edi)\n\t"
+                     "movnti %%eax, 16(%%edi)\n\t"
+                     "movnti %%eax, 20(%%edi)\n\t"
+                     "movnti %%eax, 24(%%edi)\n\t"
+                     "movnti %%eax, 28(%%edi)\n\t"
+                     "addl $32, %%edi\n\t"
+                     "decl %%ecx\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"
+                     : "+D"(dst), "+c"(blocks)
+                     : "a"(pattern)
+                     : "memory");
+    }
+
+    FillForward(dst, pattern, size % 32);
+}
+
 void* MemoryOperations::memmove(void* dstptr, const void* srcptr, uint32_t size)
 {
-    unsigned char* dst = (unsigned char*) dstptr;
-	const unsigned char* src = (const unsigned char*) srcptr;
-	if (dst < src) {
-		for (uint32_t i = 0; i < size; i++)
-			dst[i] = src[i];
-	} else {
-		for (uint32_t i = size; i != 0; i--)
-			dst[i-1] = src[i-1];
-	}
-	return dstptr;
+    uint8_t* dst = (uint8_t*) dstptr;
+    const uint8_t* src = (const uint8_t*) srcptr;
+    if (dst <= src || dst >= src + size) {
+        // A forward copy is safe, even when the regions overlap
+        CopyForward(dst, src, size);
+    } else {
+        // Destination starts inside the source, copy backwards from the end
+        // First the bytes that do not fit in a dword, then the dwords
+        uint32_t dwords = size / 4;
+        uint32_t bytes = size % 4;
+        dst += size - 1;
+        src += size - 1;
+        asm volatile("std\n\t"
+                     "rep movsb\n\t"
+                     "subl $3, %%esi\n\t"
+                     "subl $3, %%edi\n\t"
+                     "movl %3, %%ecx\n\t"
+                     "rep movsl\n\t"
+                     "cld"
+                     : "+D"(dst), "+S"(src), "+c"(bytes)
+                     : "r"(dwords)
+                     : "memory");
+    }
+    return dstptr;
 }
 int MemoryOperations::memcmp(const void* aptr, const void* bptr, uint32_t size)
 {
@@ -30,16 +151,18 @@ int MemoryOperations::memcmp(const void* aptr, const void* bptr, uint32_t size)
 
 void* MemoryOperations::memset(void* bufptr, char value, uint32_t size)
 {
-    unsigned char* buf = (unsigned char*) bufptr;
-	for (uint32_t i = 0; i < size; i++)
-		buf[i] = (unsigned char) value;
-	return bufptr;
+    uint32_t pattern = (uint8_t)value * 0x01010101;
+    if(nonTemporal && size >= MEMOPS_NONTEMPORAL_THRESHOLD)
+        FillNonTemporal(bufptr, pattern, size);
+    else
+        FillForward(bufptr, pattern, size);
+    return bufptr;
 }
 void* MemoryOperations::memcpy(void* dstptr, const void* srcptr, uint32_t size)
 {
-    unsigned char* dst = (unsigned char*) dstptr;
-	const unsigned char* src = (const unsigned char*) srcptr;
-	for (uint32_t i = 0; i < size; i++)
-		dst[i] = src[i];
-	return dstptr;
-}
\ No newline at end of file
+    if(nonTemporal && size >= MEMOPS_NONTEMPORAL_THRESHOLD)
+        CopyNonTemporal(dstptr, srcptr, size);
+    else
+        CopyForward(dstptr, srcptr, size);
+    return dstptr;
+}
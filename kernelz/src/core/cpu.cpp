@@ -1,5 +1,7 @@
 #include <core/cpu.h>
 #include <system/bootconsole.h>
+#include <common/memoryoperations.h>
+#include <core/virtualmemory.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::core;
@@ -35,6 +37,7 @@ void CPU::EnableFeatures()
         BootConsole::WriteLine("CPU Has SSE2");
 
         EnableSSE();
+        MemoryOperations::nonTemporal = true;
     }
     else
     {
@@ -52,4 +55,21 @@ void CPU::EnableFeatures()
 
         while(1);
     } 
+
+    if(!(edx & EDX_PSE)) {
+        BootConsole::WriteLine("Error: CPU has no PSE. This is needed");
+
+        while(1);
+    }
+
+    if(edx & EDX_PAT) {
+        BootConsole::WriteLine("CPU Has PAT");
+
+        // Change entry 1 (write through bit set) from write through to write combining
+        uint64_t pat = ReadMSR(MSR_PAT);
+        pat = (pat & ~(0xFFULL << 8)) | ((uint64_t)PAT_WRITE_COMBINING << 8);
+        asm volatile("wbinvd");
+        WriteMSR(MSR_PAT, pat);
+        VirtualMemoryManager::writeCombining = true;
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <core/exceptions.h>
 #include <system/system.h>
 #include <common/print.h>
+#include <core/fpu.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -51,8 +52,6 @@ uint32_t Exceptions::GeneralProtectionFault(uint32_t esp)
 }
 uint32_t Exceptions::PageFault(uint32_t esp)
 {
-    BootConsole::ForegroundColor = VGA_COLOR_BROWN;
-
     InterruptDescriptorTable::DisableInterrupts();
 
     uint32_t errorAddress;
@@ -60,6 +59,19 @@ uint32_t Exceptions::PageFault(uint32_t esp)
 
     CPUState* regs = (CPUState*)esp;
 
+    // Pages of excecutables are loaded when they are first accessed, and copied when written to while shared
+    if(errorAddress < KERNEL_VIRT_ADDR && System::scheduler != 0 && System::scheduler->CurrentProcess() != 0)
+    {
+        // Only faults from user code can read the file, kernel code might hold locks that the read needs
+        bool fromUser = regs->ErrorCode & 0x4;
+        if(!(regs->ErrorCode & 0x1) && ProcessHelper::HandlePageFault(System::scheduler->CurrentProcess(), errorAddress, fromUser))
+            return esp;
+        if((regs->ErrorCode & 0x1) && (regs->ErrorCode & 0x2) && ProcessHelper::HandleCopyOnWrite(System::scheduler->CurrentProcess(), errorAddress))
+            return esp;
+    }
+
+    BootConsole::ForegroundColor = VGA_COLOR_BROWN;
+
     // The error code gives us details of what happened.
     int present   = !(regs->ErrorCode & 0x1); // Page not present
     int rw = regs->ErrorCode & 0x2;           // Write operation?
@@ -135,6 +147,12 @@ uint32_t Exceptions::FloatingPointException(uint32_t esp)
     System::Panic();
     return esp; // We don't get here
 }
+uint32_t Exceptions::DeviceNotAvailable(uint32_t esp)
+{
+    // Thread tries to use the fpu while its state is not loaded yet
+    FPU::HandleUnavailable();
+    return esp;
+}
 uint32_t Exceptions::StackSegmentFault(uint32_t esp)
 {
     BootConsole::ForegroundColor = VGA_COLOR_RED;
@@ -175,6 +193,8 @@ uint32_t Exceptions::HandleException(uint32_t number, uint32_t esp)
             return StackSegmentFault(esp);
         case 0x13:
             return FloatingPointException(esp);
+        case 0x7:
+            return DeviceNotAvailable(esp);
         default:
             {
                 BootConsole::ForegroundColor = VGA_COLOR_RED;
@@ -5,6 +5,22 @@ using namespace HeisenOs;
 using namespace HeisenOs::common;
 using namespace HeisenOs::core;
 
+uint8_t* FPU::loadedState = 0;
+uint8_t* FPU::runningState = 0;
+uint32_t FPU::switches = 0;
+uint32_t FPU::saves = 0;
+uint32_t FPU::trapsPerSecond = 0;
+uint32_t FPU::savesAvoidedPerSecond = 0;
+uint32_t FPU::traps = 0;
+
+static inline void SetTaskSwitched()
+{
+	uint32_t cr0;
+	asm volatile ("mov %%cr0, %0" : "=r"(cr0));
+	cr0 |= (1<<3);
+	asm volatile ("mov %0, %%cr0" :: "r"(cr0));
+}
+
 void FPU::Enable()
 {
 	uint32_t cr4;
@@ -30,4 +46,53 @@ void FPU::Enable()
 	cw.InfinityControl = 0;
 
 	asm volatile("fldcw %0" :: "m"(cw));
+}
+
+void FPU::SwitchTo(uint8_t* state)
+{
+	switches++;
+	runningState = state;
+
+	// Registers already hold the state of this thread
+	if(state == loadedState)
+		asm volatile ("clts");
+	else
+		SetTaskSwitched();
+}
+
+void FPU::HandleUnavailable()
+{
+	traps++;
+	asm volatile ("clts");
+
+	if(runningState == 0 || runningState == loadedState)
+		return;
+
+	// Save the state of the thread that used the fpu last
+	if(loadedState != 0) {
+		asm volatile ("fxsave (%%eax)" : : "a" (loadedState));
+		saves++;
+	}
+
+	asm volatile ("fxrstor (%%eax)" : : "a" (runningState));
+	loadedState = runningState;
+}
+
+void FPU::ReleaseState(uint8_t* state)
+{
+	if(loadedState == state)
+		loadedState = 0;
+	if(runningState == state)
+		runningState = 0;
+}
+
+void FPU::UpdateStatistics()
+{
+	// Without lazy switching every switch would have saved the state
+	trapsPerSecond = traps;
+	savesAvoidedPerSecond = switches > saves ? switches - saves : 0;
+
+	traps = 0;
+	switches = 0;
+	saves = 0;
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include <core/physicalmemory.h>
 #include <common/print.h>
+#include <core/cpu.h>
+#include <system/log.h>
+#include <system/benchmark.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -9,57 +12,173 @@ using namespace HeisenOs::system;
 uint32_t PhysicalMemoryManager::memorySize = 0;
 uint32_t PhysicalMemoryManager::usedBlocks = 0;
 uint32_t PhysicalMemoryManager::maximumBlocks = 0;
-uint32_t *PhysicalMemoryManager::memoryArray = 0;
+uint32_t PhysicalMemoryManager::metadataSize = 0;
+BuddyFreeArea PhysicalMemoryManager::freeAreas[BUDDY_MAX_ORDER + 1];
 
-uint32_t PhysicalMemoryManager::FirstFree()
+void PhysicalMemoryManager::MarkFree(uint32_t order, uint32_t index)
 {
-    for (uint32_t i = 0; i < TotalBlocks(); i++)
-        if (memoryArray[i] != 0xffffffff)
-            for (int j = 0; j < 32; j++)
-            { //! test each bit in the dword
+    BuddyFreeArea* area = &freeAreas[order];
+    area->numFree++;
 
-                int bit = 1 << j;
-                if (!(memoryArray[i] & bit))
-                    return i * 4 * 8 + j;
-            }
+    // Set the bit in every level until we reach a word that already had bits set
+    for(uint32_t level = 0; level < area->numLevels; level++)
+    {
+        uint32_t* word = &area->levels[level][index / 32];
+        bool wasEmpty = (*word == 0);
+        *word |= (1 << (index % 32));
+        if(!wasEmpty)
+            break;
+        
+        index /= 32;
+    }
+}
+void PhysicalMemoryManager::MarkUsed(uint32_t order, uint32_t index)
+{
+    BuddyFreeArea* area = &freeAreas[order];
+    area->numFree--;
 
-    return -1;
+    // Clear the bit in every level until we reach a word that still has bits set
+    for(uint32_t level = 0; level < area->numLevels; level++)
+    {
+        uint32_t* word = &area->levels[level][index / 32];
+        *word &= ~(1 << (index % 32));
+        if(*word != 0)
+            break;
+        
+        index /= 32;
+    }
 }
-uint32_t PhysicalMemoryManager::FirstFreeSize(uint32_t size)
+uint32_t PhysicalMemoryManager::FindFree(uint32_t order)
 {
-    if (size == 0)
+    BuddyFreeArea* area = &freeAreas[order];
+    if(area->numFree == 0)
         return -1;
 
-    if (size == 1)
-        return FirstFree();
+    // Walk from the root down, every level tells us which word of the level below has a free block
+    uint32_t index = 0;
+    for(int level = area->numLevels - 1; level >= 0; level--)
+        index = index * 32 + __builtin_ctz(area->levels[level][index]);
 
-    for (uint32_t i = 0; i < TotalBlocks(); i++)
-        if (memoryArray[i] != 0xffffffff)
-            for (int j = 0; j < 32; j++)
-            { //! test each bit in the dword
+    return index;
+}
 
-                int bit = 1 << j;
-                if (!(memoryArray[i] & bit))
-                {
+uint32_t PhysicalMemoryManager::AllocateFrames(uint32_t order)
+{
+    uint32_t current = order;
+    while(current <= BUDDY_MAX_ORDER && freeAreas[current].numFree == 0)
+        current++;
+    
+    if(current > BUDDY_MAX_ORDER)
+        return -1;
 
-                    uint32_t startingBit = i * 32;
-                    startingBit += j; //get the free bit in the dword at index i
+    uint32_t index = FindFree(current);
+    MarkUsed(current, index);
 
-                    uint32_t free = 0; //loop through each bit to see if its enough space
-                    for (uint32_t count = 0; count <= size; count++)
-                    {
+    // Split the block until it has the requested size, the upper halves go back to the lower orders
+    while(current > order)
+    {
+        current--;
+        index *= 2;
+        MarkFree(current, index + 1);
+    }
 
-                        if (!TestBit(startingBit + count))
-                            free++; // this bit is clear (free frame)
+    usedBlocks += (1 << order);
+    return index << order;
+}
+uint32_t PhysicalMemoryManager::AllocateLargeFrames(uint32_t size)
+{
+    // Requests above the largest order need a run of free blocks of the largest order
+    // These are rare (large framebuffers and shared regions) so a linear search is fine here
+    uint32_t runBlocks = (size + (1 << BUDDY_MAX_ORDER) - 1) >> BUDDY_MAX_ORDER;
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
 
-                        if (free == size)
-                            return i * 4 * 8 + j; //free count==size needed; return index
-                    }
-                }
-            }
+    for(uint32_t i = 0; i < freeAreas[BUDDY_MAX_ORDER].numBlocks; i++)
+    {
+        if(!IsFree(BUDDY_MAX_ORDER, i)) {
+            runLength = 0;
+            continue;
+        }
+
+        if(runLength++ == 0)
+            runStart = i;
+        
+        if(runLength == runBlocks)
+        {
+            for(uint32_t x = runStart; x < runStart + runBlocks; x++)
+                MarkUsed(BUDDY_MAX_ORDER, x);
+            usedBlocks += runBlocks << BUDDY_MAX_ORDER;
+
+            uint32_t frame = runStart << BUDDY_MAX_ORDER;
+            FreeFrameRange(frame + size, (runBlocks << BUDDY_MAX_ORDER) - size);
+            return frame;
+        }
+    }
 
     return -1;
 }
+void PhysicalMemoryManager::FreeFrames(uint32_t frame, uint32_t order)
+{
+    uint32_t index = frame >> order;
+    usedBlocks -= (1 << order);
+
+    // Merge with our buddy for as long as it is free as well
+    while(order < BUDDY_MAX_ORDER)
+    {
+        uint32_t buddy = index ^ 1;
+        if(!IsFree(order, buddy))
+            break;
+        
+        MarkUsed(order, buddy);
+        index >>= 1;
+        order++;
+    }
+
+    MarkFree(order, index);
+}
+void PhysicalMemoryManager::FreeFrameRange(uint32_t frame, uint32_t size)
+{
+    while(size > 0)
+    {
+        // Find the largest block that starts at this frame and fits in the remaining range
+        uint32_t order = 0;
+        while(order < BUDDY_MAX_ORDER && (frame & ((2 << order) - 1)) == 0 && (2U << order) <= size)
+            order++;
+        
+        FreeFrames(frame, order);
+        frame += (1 << order);
+        size -= (1 << order);
+    }
+}
+bool PhysicalMemoryManager::IsFrameFree(uint32_t frame)
+{
+    for(uint32_t order = 0; order <= BUDDY_MAX_ORDER; order++)
+        if(IsFree(order, frame >> order))
+            return true;
+    
+    return false;
+}
+void PhysicalMemoryManager::ReserveFrame(uint32_t frame)
+{
+    // Find the free block that contains this frame
+    uint32_t order = 0;
+    while(order <= BUDDY_MAX_ORDER && !IsFree(order, frame >> order))
+        order++;
+    
+    if(order > BUDDY_MAX_ORDER)
+        return; // Already in use
+
+    MarkUsed(order, frame >> order);
+
+    // Split it until only the frame itself is used, the halves we don't need are free again
+    while(order > 0)
+    {
+        order--;
+        MarkFree(order, (frame >> order) ^ 1);
+    }
+
+    usedBlocks++;
+}
 
 void PhysicalMemoryManager::Initialize(uint32_t size, uint32_t bitmap)
 {
@@ -69,11 +188,29 @@ void PhysicalMemoryManager::Initialize(uint32_t size, uint32_t bitmap)
     BootConsole::Write("Bitmap: 0x"); Print::printfHex32(bitmap); BootConsole::WriteLine();
 
     memorySize = size;
-    memoryArray = (uint32_t *)bitmap;
     maximumBlocks = size / BLOCK_SIZE;
     usedBlocks = maximumBlocks; //We use all at startup
 
-    MemoryOperations::memset(memoryArray, 0xFF, usedBlocks / BLOCKS_PER_BYTE);
+    // Place the search trees of all the orders directly after each other
+    uint32_t* nextWord = (uint32_t*)bitmap;
+    for(uint32_t order = 0; order <= BUDDY_MAX_ORDER; order++)
+    {
+        BuddyFreeArea* area = &freeAreas[order];
+        area->numBlocks = maximumBlocks >> order;
+        area->numFree = 0;
+        area->numLevels = 0;
+
+        uint32_t words = area->numBlocks;
+        do {
+            words = (words + 31) / 32;
+            area->levels[area->numLevels++] = nextWord;
+            nextWord += words;
+        } while(words > 1 && area->numLevels < BUDDY_MAX_LEVELS);
+    }
+    metadataSize = (uint32_t)nextWord - bitmap;
+
+    // Nothing is free until the memory map is parsed
+    MemoryOperations::memset((void*)bitmap, 0, metadataSize);
 
     BootConsole::Write("Bitmap size: ");
     BootConsole::Write(Convert::IntToString(GetBitmapSize() / 1_KB));
@@ -82,27 +219,28 @@ void PhysicalMemoryManager::Initialize(uint32_t size, uint32_t bitmap)
 }
 void PhysicalMemoryManager::SetRegionFree(uint32_t base, uint32_t size)
 {
-    uint32_t align = base / BLOCK_SIZE;
-
-    for (uint32_t blocks = size / BLOCK_SIZE; blocks > 0; blocks--)
-    {
-        UnsetBit(align++);
-        usedBlocks--;
-    }
-
-    SetBit(0);
+    uint32_t frame = pageRoundUp(base) / BLOCK_SIZE;
+    uint32_t end = base / BLOCK_SIZE + size / BLOCK_SIZE;
+    if(end > maximumBlocks)
+        end = maximumBlocks;
+
+    // The first block is never handed out
+    if(frame == 0)
+        frame = 1;
+
+    for(; frame < end; frame++)
+        if(!IsFrameFree(frame))
+            FreeFrames(frame, 0);
 }
 void PhysicalMemoryManager::SetRegionUsed(uint32_t base, uint32_t size)
 {
-    uint32_t align = base / BLOCK_SIZE;
+    uint32_t frame = base / BLOCK_SIZE;
+    uint32_t end = frame + (base % BLOCK_SIZE + size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if(end > maximumBlocks)
+        end = maximumBlocks;
 
-    for (uint32_t blocks = size / BLOCK_SIZE; blocks > 0; blocks--)
-    {
-        SetBit(align++);
-        usedBlocks++;
-    }
-
-    SetBit(0);
+    for(; frame < end; frame++)
+        ReserveFrame(frame);
 }
 void PhysicalMemoryManager::ParseMemoryMap(const multiboot_info_t* mbi)
 {
@@ -132,57 +270,78 @@ void PhysicalMemoryManager::ParseMemoryMap(const multiboot_info_t* mbi)
 
 void* PhysicalMemoryManager::AllocateBlock()
 {
-    if (FreeBlocks() <= 0)
-        return 0;
-
-    uint32_t frame = FirstFree();
+    uint32_t frame = AllocateFrames(0);
 
     if (frame == (uint32_t)-1)
         return 0;
 
-    SetBit(frame);
-
-    uint32_t addr = frame * BLOCK_SIZE;
-    usedBlocks++;
-
-    return (void *)addr;
+    return (void *)(frame * BLOCK_SIZE);
 }
 void PhysicalMemoryManager::FreeBlock(void* ptr)
 {
     uint32_t addr = (uint32_t)ptr;
     uint32_t frame = addr / BLOCK_SIZE;
 
-    UnsetBit(frame);
+    if(frame == 0 || frame >= maximumBlocks || IsFrameFree(frame))
+        return; // Not something we handed out
 
-    usedBlocks--;
+    FreeFrames(frame, 0);
 }
 void* PhysicalMemoryManager::AllocateBlocks(uint32_t size)
 {
-    if (FreeBlocks() <= size)
+    if (size == 0 || FreeBlocks() < size)
         return 0; //not enough space
 
-    uint32_t frame = FirstFreeSize(size);
+    uint32_t order = OrderForSize(size);
+    uint32_t frame = -1;
+    if(order > BUDDY_MAX_ORDER)
+        frame = AllocateLargeFrames(size);
+    else if((frame = AllocateFrames(order)) != (uint32_t)-1)
+        FreeFrameRange(frame + size, (1 << order) - size); // Give back the part we don't need
 
     if (frame == (uint32_t)-1)
         return 0; //not enough space
 
-    for (uint32_t i = 0; i < size; i++)
-        SetBit(frame + i);
+    return (void *)(frame * BLOCK_SIZE);
+}
+void PhysicalMemoryManager::FreeBlocks(void *ptr, uint32_t size)
+{
+    uint32_t addr = (uint32_t)ptr;
+    uint32_t frame = addr / BLOCK_SIZE;
 
-    uint32_t addr = frame * BLOCK_SIZE;
-    usedBlocks += size;
+    if(frame == 0 || frame + size > maximumBlocks)
+        return;
 
-    return (void *)addr;
+    FreeFrameRange(frame, size);
 }
-void PhysicalMemoryManager::FreeBlocks(void *ptr, uint32_t size)
+void* PhysicalMemoryManager::AllocateOrder(uint32_t order)
+{
+    if(order > BUDDY_MAX_ORDER)
+        return 0;
+
+    uint32_t frame = AllocateFrames(order);
+    if (frame == (uint32_t)-1)
+        return 0;
+
+    return (void *)(frame * BLOCK_SIZE);
+}
+void PhysicalMemoryManager::FreeOrder(void* ptr, uint32_t order)
 {
     uint32_t addr = (uint32_t)ptr;
     uint32_t frame = addr / BLOCK_SIZE;
 
-    for (uint32_t i = 0; i < size; i++)
-        UnsetBit(frame + i);
+    if(frame == 0 || order > BUDDY_MAX_ORDER || frame + (1 << order) > maximumBlocks)
+        return;
 
-    usedBlocks -= size;
+    FreeFrames(frame, order);
+}
+uint32_t PhysicalMemoryManager::OrderForSize(uint32_t size)
+{
+    uint32_t order = 0;
+    while((1U << order) < size && order < 31)
+        order++;
+    
+    return order;
 }
 
 uint32_t PhysicalMemoryManager::AmountOfMemory()
@@ -203,7 +362,46 @@ uint32_t PhysicalMemoryManager::TotalBlocks()
 }
 uint32_t PhysicalMemoryManager::GetBitmapSize()
 {
-    return memorySize / BLOCK_SIZE / BLOCKS_PER_BYTE;
+    return metadataSize;
+}
+
+void PhysicalMemoryManager::Benchmark()
+{
+    const uint32_t sizes[] = { 1, 16, 1 << BUDDY_MAX_ORDER };
+    const uint32_t batchSize = 16;
+    const uint32_t rounds = 16;
+    void* blocks[batchSize];
+
+    for(uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        LatencyHistogram allocations;
+        LatencyHistogram frees;
+
+        // Allocate a batch and free it again, so that the free path has to merge buddies as well
+        for(uint32_t round = 0; round < rounds; round++)
+        {
+            uint32_t count = 0;
+            for(; count < batchSize; count++) {
+                uint64_t start = CPU::ReadTimestamp();
+                blocks[count] = AllocateBlocks(sizes[s]);
+                uint64_t end = CPU::ReadTimestamp();
+                
+                if(blocks[count] == 0)
+                    break;
+                allocations.Add(end - start);
+            }
+
+            for(uint32_t i = 0; i < count; i++) {
+                uint64_t start = CPU::ReadTimestamp();
+                FreeBlocks(blocks[i], sizes[s]);
+                frees.Add(CPU::ReadTimestamp() - start);
+            }
+        }
+
+        Log(Info, "PMM Benchmark for %d block(s)", sizes[s]);
+        allocations.Print("Allocate");
+        frees.Print("Free");
+    }
 }
 
 
@@ -289,6 +289,9 @@ void Power::Initialize()
 
 void Power::Poweroff()
 {
+    // Make sure all changes are on disk
+    BlockCache::Flush();
+
     if(System::apm->Enabled) {
         Log(Info, "Shutdown via APM");
         System::apm->SetPowerState(APM_ALL_DEVICE, APM_POWER_OFF);
@@ -323,6 +326,9 @@ void Power::Poweroff()
 
 void Power::Reboot()
 {
+    // Make sure all changes are on disk
+    BlockCache::Flush();
+
     InterruptDescriptorTable::DisableInterrupts();
 
     /* flush the keyboard controller */
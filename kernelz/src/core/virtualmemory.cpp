@@ -1,12 +1,15 @@
 #include <core/virtualmemory.h>
 #include <system/log.h>
 #include <system/debugger.h>
+#include <core/idt.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
 using namespace HeisenOs::core;
 using namespace HeisenOs::system;
 
+bool VirtualMemoryManager::writeCombining = false;
+
 void VirtualMemoryManager::ReloadCR3()
 {
     asm volatile("movl	%cr3,%eax");
@@ -59,9 +62,11 @@ void VirtualMemoryManager::Initialize()
         kernelPageTable->entries[i].present = 1;
     }
 #endif
-    // Here we map some pages for the initial kernel heap
-    for(uint32_t i = KERNEL_HEAP_START; i < KERNEL_HEAP_START + KERNEL_HEAP_SIZE; i += PAGE_SIZE)
-        AllocatePage(GetPageForAddress(i, true), true, true);
+    // Here we map the memory for the kernel heap, with 4MB pages when possible to save TLB entries
+    MapRange(KERNEL_HEAP_START, 0, KERNEL_HEAP_SIZE / PAGE_SIZE, VMM_ALLOCATE | VMM_WRITEABLE | VMM_LARGE_PAGES);
+
+    // Create the page table for the windows, it is shared with all processes
+    GetPageForAddress(KERNEL_WINDOW_START, true);
         
     // The first 4mb are identity mapped, this is needed for the smbios and the vm86 code
     MemoryOperations::memset(&pageDirectory->entries[0], 0, sizeof(PageDirectoryEntry));
@@ -124,6 +129,9 @@ PageTableEntry* VirtualMemoryManager::GetPageForAddress(uint32_t virtualAddress,
         return &(pageTableVirt->entries[pageTableIndex]);
     }
 
+    else if(pageDir->entries[pageDirIndex].present == 0 || pageDir->entries[pageDirIndex].pageSize == FOUR_MB)
+        return 0; // No page table for this address
+
     PageTable* pageTable = (PageTable*)GetPageTableAddress(pageDirIndex);
     return &pageTable->entries[pageTableIndex];
 }
@@ -163,8 +171,17 @@ void* VirtualMemoryManager::virtualToPhysical(void* virtAddress)
     uint32_t pt_offset = PAGETBL_INDEX(virtAddress);
     uint32_t p_offset = PAGEFRAME_INDEX(virtAddress);
 
+    PageDirectoryEntry pageDirEntry = ((PageDirectory*)PAGE_DIRECTORY_ADDRESS)->entries[pd_offset];
+    if(!pageDirEntry.present)
+        return 0;
+    if(pageDirEntry.pageSize == FOUR_MB)
+        return (void*)(((pageDirEntry.frame * PAGE_SIZE) & ~(LARGE_PAGE_SIZE - 1)) | ((uint32_t)virtAddress & (LARGE_PAGE_SIZE - 1)));
+
+    // The page table is only mapped through the recursive entry when the directory entry is present
     PageTable* pageTable = (PageTable*)(PAGE_TABLE_ADDRESS + (PAGE_SIZE * pd_offset));
     PageTableEntry pageTableEntry = pageTable->entries[pt_offset];
+    if(!pageTableEntry.present)
+        return 0;
 
     uint32_t physAddress = (pageTableEntry.frame * PAGE_SIZE) | p_offset;
 
@@ -206,4 +223,213 @@ uint32_t VirtualMemoryManager::GetPageDirectoryAddress()
     uint32_t cr3;
     asm volatile("mov %%cr3, %0" : "=r"(cr3));
     return cr3;
-}
\ No newline at end of file
+}
+
+void* VirtualMemoryManager::MapWindow(uint32_t window, uint32_t physAddress)
+{
+    // The page table of the windows is shared by all address spaces, so the window is always reachable
+    PageTableEntry* page = GetPageForAddress(window, false);
+    page->frame = physAddress / PAGE_SIZE;
+    page->readWrite = 1;
+    page->isUser = 0;
+    page->present = 1;
+
+    invlpg((void*)window);
+    return (void*)window;
+}
+
+PageDirectory* VirtualMemoryManager::GetPageDirectory(uint32_t pageDirPhys, bool current)
+{
+    if(current)
+        return (PageDirectory*)PAGE_DIRECTORY_ADDRESS;
+    
+    return (PageDirectory*)MapWindow(WINDOW_PAGE_DIRECTORY, pageDirPhys);
+}
+
+PageTable* VirtualMemoryManager::GetPageTable(PageDirectory* pageDir, uint32_t pageDirIndex, bool current, bool shouldCreate, bool userPages)
+{
+    PageDirectoryEntry* entry = &pageDir->entries[pageDirIndex];
+    if(entry->present && entry->pageSize == FOUR_MB) {
+        Log(Error, "Can not map pages inside 4MB page %d", pageDirIndex);
+        return 0;
+    }
+
+    if(entry->present)
+        return (PageTable*)(current ? GetPageTableAddress(pageDirIndex) : MapWindow(WINDOW_PAGE_TABLE, entry->frame * PAGE_SIZE));
+    else if(!shouldCreate)
+        return 0;
+
+    uint32_t pageTablePhys = (uint32_t)PhysicalMemoryManager::AllocateBlock();
+    if(pageTablePhys == 0)
+        return 0;
+
+    MemoryOperations::memset(entry, 0, sizeof(PageDirectoryEntry));
+    entry->frame = pageTablePhys / PAGE_SIZE;
+    entry->readWrite = 1;
+    entry->isUser = userPages;
+    entry->pageSize = FOUR_KB;
+    entry->present = 1;
+
+    PageTable* pageTable = (PageTable*)(current ? GetPageTableAddress(pageDirIndex) : MapWindow(WINDOW_PAGE_TABLE, pageTablePhys));
+    MemoryOperations::memset(pageTable, 0, sizeof(PageTable));
+    return pageTable;
+}
+
+void VirtualMemoryManager::FlushRange(uint32_t virtAddress, uint32_t pages)
+{
+    if(pages > VMM_INVLPG_THRESHOLD)
+        ReloadCR3();
+    else
+        for(uint32_t i = 0; i < pages; i++)
+            invlpg((void*)(virtAddress + i * PAGE_SIZE));
+}
+
+bool VirtualMemoryManager::MapRange(uint32_t virtAddress, uint32_t physAddress, uint32_t pages, uint32_t flags, uint32_t pageDirPhys)
+{
+    bool current = (pageDirPhys == 0 || pageDirPhys == GetPageDirectoryAddress());
+
+    // The windows are shared, so we can not be interrupted while using them
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    PageDirectory* pageDir = GetPageDirectory(pageDirPhys, current);
+
+    // All entries are the same except for the frame
+    PageTableEntry entry;
+    MemoryOperations::memset(&entry, 0, sizeof(PageTableEntry));
+    entry.present = 1;
+    entry.readWrite = (flags & VMM_WRITEABLE) ? 1 : 0;
+    entry.isUser = (flags & VMM_USER) ? 1 : 0;
+    entry.writeThrough = ((flags & VMM_WRITE_COMBINING) && writeCombining) ? 1 : 0;
+
+    bool result = true;
+    uint32_t virt = pageRoundDown(virtAddress);
+    uint32_t phys = pageRoundDown(physAddress);
+    uint32_t mapped = 0;
+    while(mapped < pages && result)
+    {
+        PageDirectoryEntry* pageDirEntry = &pageDir->entries[PAGEDIR_INDEX(virt)];
+
+        // Map a whole directory entry at once when everything lines up
+        if((flags & VMM_LARGE_PAGES) && !pageDirEntry->present && (virt % LARGE_PAGE_SIZE) == 0 && pages - mapped >= LARGE_PAGE_SIZE / PAGE_SIZE)
+        {
+            uint32_t largePhys = (flags & VMM_ALLOCATE) ? (uint32_t)PhysicalMemoryManager::AllocateOrder(BUDDY_MAX_ORDER) : phys;
+            if(largePhys != 0 && (largePhys % LARGE_PAGE_SIZE) == 0)
+            {
+                MemoryOperations::memset(pageDirEntry, 0, sizeof(PageDirectoryEntry));
+                pageDirEntry->frame = largePhys / PAGE_SIZE;
+                pageDirEntry->readWrite = entry.readWrite;
+                pageDirEntry->isUser = entry.isUser;
+                pageDirEntry->writeThrough = entry.writeThrough;
+                pageDirEntry->pageSize = FOUR_MB;
+                pageDirEntry->present = 1;
+
+                virt += LARGE_PAGE_SIZE;
+                phys += LARGE_PAGE_SIZE;
+                mapped += LARGE_PAGE_SIZE / PAGE_SIZE;
+                continue;
+            }
+
+            // Fall back to small pages
+            if(largePhys != 0 && (flags & VMM_ALLOCATE))
+                PhysicalMemoryManager::FreeOrder((void*)largePhys, BUDDY_MAX_ORDER);
+        }
+
+        uint32_t pageTableIndex = PAGETBL_INDEX(virt);
+        uint32_t count = 1024 - pageTableIndex;
+        if(count > pages - mapped)
+            count = pages - mapped;
+
+        PageTable* pageTable = GetPageTable(pageDir, PAGEDIR_INDEX(virt), current, true, flags & VMM_USER);
+        if(pageTable == 0) {
+            result = false;
+            break;
+        }
+
+        for(uint32_t i = 0; i < count; i++, phys += PAGE_SIZE)
+        {
+            if(flags & VMM_ALLOCATE) {
+                phys = (uint32_t)PhysicalMemoryManager::AllocateBlock();
+                if(phys == 0) {
+                    result = false;
+                    count = i;
+                    break;
+                }
+            }
+
+            entry.frame = phys / PAGE_SIZE;
+            pageTable->entries[pageTableIndex + i] = entry;
+        }
+
+        virt += count * PAGE_SIZE;
+        mapped += count;
+    }
+
+    // Other address spaces get their TLB flushed when they are switched to
+    if(current)
+        FlushRange(pageRoundDown(virtAddress), mapped);
+
+    // Don't leave a partial range behind, the pages we allocated are freed again
+    if(!result && mapped > 0)
+        UnmapRange(pageRoundDown(virtAddress), mapped, flags & VMM_ALLOCATE, pageDirPhys);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    return result;
+}
+
+void VirtualMemoryManager::UnmapRange(uint32_t virtAddress, uint32_t pages, bool freeBlocks, uint32_t pageDirPhys)
+{
+    bool current = (pageDirPhys == 0 || pageDirPhys == GetPageDirectoryAddress());
+
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    PageDirectory* pageDir = GetPageDirectory(pageDirPhys, current);
+
+    uint32_t virt = pageRoundDown(virtAddress);
+    uint32_t done = 0;
+    while(done < pages)
+    {
+        uint32_t pageTableIndex = PAGETBL_INDEX(virt);
+        uint32_t count = 1024 - pageTableIndex;
+        if(count > pages - done)
+            count = pages - done;
+
+        PageDirectoryEntry* pageDirEntry = &pageDir->entries[PAGEDIR_INDEX(virt)];
+        if(pageDirEntry->present && pageDirEntry->pageSize == FOUR_MB)
+        {
+            // Large pages can only be removed as a whole
+            if(count == LARGE_PAGE_SIZE / PAGE_SIZE) {
+                if(freeBlocks)
+                    PhysicalMemoryManager::FreeOrder((void*)(pageDirEntry->frame * PAGE_SIZE), BUDDY_MAX_ORDER);
+                MemoryOperations::memset(pageDirEntry, 0, sizeof(PageDirectoryEntry));
+            }
+            else
+                Log(Warning, "UnmapRange(): Can not remove part of 4MB page at %x", virt);
+        }
+        else
+        {
+            // Nothing is mapped when there is no page table
+            PageTable* pageTable = GetPageTable(pageDir, PAGEDIR_INDEX(virt), current, false, false);
+            if(pageTable != 0)
+                for(uint32_t i = 0; i < count; i++)
+                {
+                    PageTableEntry* page = &pageTable->entries[pageTableIndex + i];
+                    if(freeBlocks && page->present && page->frame != 0)
+                        PhysicalMemoryManager::FreeBlock((void*)(page->frame * PAGE_SIZE));
+                    
+                    MemoryOperations::memset(page, 0, sizeof(PageTableEntry));
+                }
+        }
+
+        virt += count * PAGE_SIZE;
+        done += count;
+    }
+
+    if(current)
+        FlushRange(pageRoundDown(virtAddress), pages);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
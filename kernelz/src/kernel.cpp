@@ -42,6 +42,7 @@ void IdleThread()
 {
     powerRequestState = None;
     uint64_t prevTicks = System::pit->Ticks();
+    uint64_t prevFlushTicks = prevTicks;
     while(1) {
         uint64_t ticks = System::pit->Ticks();
         if(System::usbManager)
@@ -61,6 +62,12 @@ void IdleThread()
             prevTicks = ticks;
         }
 
+        // Write dirty blocks of the block cache back to disk once in a while
+        if(ticks - prevFlushTicks > BLOCKCACHE_FLUSH_INTERVAL) {
+            BlockCache::Flush();
+            prevFlushTicks = ticks;
+        }
+
         // Handle power state requests from userspace
         // Processes can not do this themself because the first mb of memory is not mapped for them
         // And that should not be the case due to security issues :)
@@ -86,7 +93,8 @@ void IdleThread()
         }
 #endif
         // Move onto other threads since there is nothing else to do here
-        System::scheduler->ForceSwitch();
+        // When there are none the cpu is halted until the next interrupt
+        System::scheduler->Idle();
     }
 }
 
@@ -182,6 +190,10 @@ extern "C" void kernelMain(const multiboot_info_t* mbi, unsigned int multiboot_m
     KernelHeap::Initialize(KERNEL_HEAP_START, KERNEL_HEAP_START + KERNEL_HEAP_SIZE);
     Log(Info, "Kernel Heap Initialized");
 
+#if ENABLE_BOOT_BENCHMARKS
+    PhysicalMemoryManager::Benchmark();
+#endif
+
     // From here we (should) only use the Log function for logging
     Log(Info, "Switching to log function based output");
 
@@ -202,6 +214,7 @@ extern "C" void kernelMain(const multiboot_info_t* mbi, unsigned int multiboot_m
     Process* kernelProcess = ProcessHelper::CreateKernelProcess();
     kernelProcess->Threads.push_back(ThreadHelper::CreateFromFunction(IdleThread, true));
     kernelProcess->Threads[0]->parent = kernelProcess;
+    kernelProcess->Threads[0]->priority = THREAD_PRIORITY_IDLE;
     System::scheduler->AddThread(kernelProcess->Threads[0], false);
 
     // Check if we have found the directory with all the required stuff
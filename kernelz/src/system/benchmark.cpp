@@ -0,0 +1,53 @@
+#include <system/benchmark.h>
+#include <system/log.h>
+#include <common/memoryoperations.h>
+
+using namespace HeisenOs;
+using namespace HeisenOs::common;
+using namespace HeisenOs::system;
+
+LatencyHistogram::LatencyHistogram()
+{
+    MemoryOperations::memset(this->buckets, 0, sizeof(this->buckets));
+    this->samples = 0;
+    this->minimum = 0xFFFFFFFF;
+    this->maximum = 0;
+}
+
+void LatencyHistogram::Add(uint64_t cycles)
+{
+    // Samples that do not fit in 32 bits are not interesting for a latency histogram anyway
+    uint32_t value = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles;
+
+    int bucket = 0;
+    if(value >> LATENCY_FIRST_BUCKET_SHIFT)
+        bucket = (31 - __builtin_clz(value)) - LATENCY_FIRST_BUCKET_SHIFT + 1;
+    if(bucket >= LATENCY_BUCKETS)
+        bucket = LATENCY_BUCKETS - 1;
+
+    this->buckets[bucket]++;
+    this->samples++;
+    if(value < this->minimum)
+        this->minimum = value;
+    if(value > this->maximum)
+        this->maximum = value;
+}
+
+void LatencyHistogram::Print(const char* name)
+{
+    if(this->samples == 0) {
+        Log(Info, "%s: no samples", name);
+        return;
+    }
+
+    Log(Info, "%s: %d samples, min %d max %d cycles", name, this->samples, this->minimum, this->maximum);
+    for(int i = 0; i < LATENCY_BUCKETS; i++) {
+        if(this->buckets[i] == 0)
+            continue;
+        
+        if(i == LATENCY_BUCKETS - 1)
+            Log(Info, "    >= %d cycles: %d", 1 << (i + LATENCY_FIRST_BUCKET_SHIFT - 1), this->buckets[i]);
+        else
+            Log(Info, "    <  %d cycles: %d", 1 << (i + LATENCY_FIRST_BUCKET_SHIFT), this->buckets[i]);
+    }
+}
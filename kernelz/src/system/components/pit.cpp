@@ -11,20 +11,84 @@ PIT::PIT()
 InterruptHandler(IDT_INTERRUPT_OFFSET + 0)
 {
     timer_ticks = 0;
+    oneShotActive = false;
+    oneShotTicks = 0;
+    interruptTicks = 1;
 
-    uint64_t divisor = 1193180 / PIT_FREQUENCY; //Default is 1000 Hz
+    SetPeriodic();
+}
+
+void PIT::SetPeriodic()
+{
+    uint32_t divisor = PIT_COUNTS_PER_TICK; //Default is 1000 Hz
 
-    outportb(0x43, 0x34);
+    outportb(0x43, 0x34); //Channel 0, rate generator
     outportb(0x40, (uint8_t)divisor);
     outportb(0x40, (uint8_t)(divisor >> 8));
 }
 
 uint32_t PIT::HandleInterrupt(uint32_t esp)
 {
-    timer_ticks++;
+    interruptTicks = 1;
+
+    if(oneShotActive)
+    {
+        //Read the status of channel 0, the output goes high once the one-shot has fired
+        //When it is still low this interrupt was caused by a software int instead
+        outportb(0x43, 0xE2);
+        if(inportb(0x40) & (1<<7)) {
+            oneShotActive = false;
+            interruptTicks = oneShotTicks;
+            SetPeriodic();
+        }
+    }
+
+    timer_ticks += interruptTicks;
 
     return esp;
 }
+
+void PIT::StartOneShot(uint32_t ticks)
+{
+    if(ticks == 0)
+        ticks = 1;
+    if(ticks > PIT_ONESHOT_MAX_TICKS)
+        ticks = PIT_ONESHOT_MAX_TICKS;
+    
+    uint32_t count = ticks * PIT_COUNTS_PER_TICK;
+    oneShotTicks = ticks;
+    oneShotActive = true;
+
+    outportb(0x43, 0x30); //Channel 0, interrupt on terminal count
+    outportb(0x40, (uint8_t)count);
+    outportb(0x40, (uint8_t)(count >> 8));
+}
+
+uint32_t PIT::StopOneShot()
+{
+    if(!oneShotActive)
+        return 0;
+
+    //Latch the current count of channel 0
+    outportb(0x43, 0x00);
+    uint32_t count = inportb(0x40);
+    count |= inportb(0x40) << 8;
+
+    //The counter wraps around after it reached 0, in that case the whole period has passed
+    uint32_t start = oneShotTicks * PIT_COUNTS_PER_TICK;
+    uint32_t passed = count > start ? oneShotTicks : (start - count) / PIT_COUNTS_PER_TICK;
+
+    oneShotActive = false;
+    timer_ticks += passed;
+    SetPeriodic();
+
+    return passed;
+}
+
+uint32_t PIT::InterruptTicks()
+{
+    return interruptTicks;
+}
 void PIT::Sleep(uint32_t ms)
 {
     uint64_t targetTicks = timer_ticks + ms;
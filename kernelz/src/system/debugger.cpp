@@ -65,8 +65,8 @@ SymbolDebugger::SymbolDebugger(char* symFile, bool kernel)
     Log(Info, "Debugger initialized with %d symbols for %s", this->symbolTable.size(), symFile);
 
 #if ENABLE_ADV_DEBUG
-    // allocate free page to use for debugging
-    this->pageAccessAddress = (uint32_t)KernelHeap::alignedMalloc(PAGE_SIZE, PAGE_SIZE);
+    // page used to access physical memory, the kernel heap can not be used for this since it is mapped with large pages
+    this->pageAccessAddress = WINDOW_DEBUGGER;
     if(this->isKernel) {
         // Send message to external debugger that we are initalized and ready to receive commands
         if(Serialport::Initialized && !System::gdbEnabled) {
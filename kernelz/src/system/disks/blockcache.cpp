@@ -0,0 +1,460 @@
+#include <system/disks/blockcache.h>
+#include <system/disks/disk.h>
+#include <system/log.h>
+#include <system/system.h>
+#include <common/memoryoperations.h>
+
+using namespace HeisenOs;
+using namespace HeisenOs::common;
+using namespace HeisenOs::system;
+
+BlockCacheEntry BlockCache::entries[BLOCKCACHE_ENTRIES];
+BlockCacheEntry* BlockCache::hashTable[BLOCKCACHE_HASH_SIZE];
+BlockCacheEntry* BlockCache::lruHead = 0;
+BlockCacheEntry* BlockCache::lruTail = 0;
+MutexLock BlockCache::cacheLock = MutexLock();
+
+uint32_t BlockCache::hits = 0;
+uint32_t BlockCache::misses = 0;
+uint32_t BlockCache::dirtyBlocks = 0;
+uint32_t BlockCache::writeBacks = 0;
+
+void BlockCache::Initialize()
+{
+    MemoryOperations::memset(entries, 0, sizeof(entries));
+    MemoryOperations::memset(hashTable, 0, sizeof(hashTable));
+
+    // Put all entries on the LRU list, the unused ones will be taken from the tail first
+    lruHead = &entries[0];
+    lruTail = &entries[BLOCKCACHE_ENTRIES - 1];
+    for(int i = 0; i < BLOCKCACHE_ENTRIES; i++) {
+        entries[i].lruPrev = i > 0 ? &entries[i - 1] : 0;
+        entries[i].lruNext = i < BLOCKCACHE_ENTRIES - 1 ? &entries[i + 1] : 0;
+    }
+
+    Log(Info, "BlockCache: %d entries", BLOCKCACHE_ENTRIES);
+}
+
+uint32_t BlockCache::Hash(Disk* disk, uint32_t lba)
+{
+    return ((uint32_t)disk / sizeof(Disk) + lba * 2654435761U) & (BLOCKCACHE_HASH_SIZE - 1);
+}
+
+BlockCacheEntry* BlockCache::Find(Disk* disk, uint32_t lba)
+{
+    BlockCacheEntry* entry = hashTable[Hash(disk, lba)];
+    while(entry != 0) {
+        if(entry->disk == disk && entry->lba == lba)
+            return entry;
+        entry = entry->hashNext;
+    }
+    return 0;
+}
+
+void BlockCache::RemoveFromHash(BlockCacheEntry* entry)
+{
+    BlockCacheEntry** link = &hashTable[Hash(entry->disk, entry->lba)];
+    while(*link != 0) {
+        if(*link == entry) {
+            *link = entry->hashNext;
+            break;
+        }
+        link = &(*link)->hashNext;
+    }
+    entry->hashNext = 0;
+}
+
+void BlockCache::MoveToFront(BlockCacheEntry* entry)
+{
+    if(entry == lruHead)
+        return;
+    
+    // Unlink
+    entry->lruPrev->lruNext = entry->lruNext;
+    if(entry->lruNext)
+        entry->lruNext->lruPrev = entry->lruPrev;
+    else
+        lruTail = entry->lruPrev;
+    
+    // And insert at the head
+    entry->lruPrev = 0;
+    entry->lruNext = lruHead;
+    lruHead->lruPrev = entry;
+    lruHead = entry;
+}
+
+void BlockCache::Release(BlockCacheEntry* entry)
+{
+    if(entry->dirty)
+        dirtyBlocks--;
+    
+    RemoveFromHash(entry);
+    entry->valid = false;
+    entry->dirty = false;
+    entry->disk = 0;
+
+    if(entry == lruTail)
+        return;
+    
+    // Move it to the tail of the LRU list
+    if(entry->lruPrev)
+        entry->lruPrev->lruNext = entry->lruNext;
+    else
+        lruHead = entry->lruNext;
+    entry->lruNext->lruPrev = entry->lruPrev;
+
+    entry->lruNext = 0;
+    entry->lruPrev = lruTail;
+    lruTail->lruNext = entry;
+    lruTail = entry;
+}
+
+void BlockCache::Wait()
+{
+    cacheLock.Unlock();
+    if(System::scheduler && System::scheduler->Enabled)
+        System::scheduler->ForceSwitch();
+    else
+        asm ("pause");
+    cacheLock.Lock();
+}
+
+void BlockCache::CopyOut(BlockCacheEntry* entry, uint8_t* buf)
+{
+    // The caller's buffer can page fault, which should not happen with the lock held
+    entry->pins++;
+    cacheLock.Unlock();
+    MemoryOperations::memcpy(buf, entry->data, entry->dataSize);
+    cacheLock.Lock();
+    entry->pins--;
+}
+
+void BlockCache::CopyIn(BlockCacheEntry* entry, uint8_t* buf)
+{
+    entry->filling = true;
+    cacheLock.Unlock();
+    MemoryOperations::memcpy(entry->data, buf, entry->dataSize);
+    cacheLock.Lock();
+    entry->filling = false;
+}
+
+char BlockCache::WriteBack(BlockCacheEntry* entry)
+{
+    if(!entry->valid || !entry->dirty)
+        return 0;
+    
+    // Mark it clean before the transfer, a write during it makes the block dirty again
+    entry->dirty = false;
+    dirtyBlocks--;
+    entry->pins++;
+
+    Disk* disk = entry->disk;
+    uint32_t lba = entry->lba;
+    cacheLock.Unlock();
+    char ret = disk->WriteSectorDirect(lba, entry->data);
+    cacheLock.Lock();
+    entry->pins--;
+
+    if(ret != 0) {
+        Log(Error, "BlockCache: Error writing back block %d", lba);
+        if(entry->valid && !entry->dirty) {
+            entry->dirty = true;
+            dirtyBlocks++;
+        }
+        return ret;
+    }
+
+    writeBacks++;
+    return 0;
+}
+
+BlockCacheEntry* BlockCache::Allocate(Disk* disk, uint32_t lba)
+{
+    while(true) {
+        // Take the least recently used entry that is not in use and not dirty
+        BlockCacheEntry* entry = lruTail;
+        while(entry != 0 && (entry->pins > 0 || entry->filling || (entry->valid && entry->dirty)))
+            entry = entry->lruPrev;
+        
+        if(entry != 0) {
+            if(entry->valid)
+                RemoveFromHash(entry);
+            
+            // Blocks of different disks can have a different size
+            if(entry->dataSize != disk->blockSize) {
+                if(entry->data)
+                    delete entry->data;
+                entry->data = new uint8_t[disk->blockSize];
+                entry->dataSize = disk->blockSize;
+            }
+
+            entry->disk = disk;
+            entry->lba = lba;
+            entry->valid = true;
+            entry->dirty = false;
+
+            uint32_t hash = Hash(disk, lba);
+            entry->hashNext = hashTable[hash];
+            hashTable[hash] = entry;
+
+            MoveToFront(entry);
+            return entry;
+        }
+
+        // They are all dirty, so write one back first
+        entry = lruTail;
+        while(entry != 0 && (entry->pins > 0 || entry->filling))
+            entry = entry->lruPrev;
+        if(entry == 0)
+            return 0;
+        
+        if(WriteBack(entry) != 0 && entry->valid && entry->dirty && entry->pins == 0) {
+            // Data is lost, but we can't keep it forever either
+            Log(Warning, "BlockCache: Dropping dirty block %d", entry->lba);
+            entry->dirty = false;
+            dirtyBlocks--;
+        }
+
+        // Another thread could have cached this block while the lock was released
+        if(Find(disk, lba) != 0)
+            return 0;
+    }
+}
+
+char BlockCache::Read(Disk* disk, uint32_t lba, uint8_t* buf)
+{
+    cacheLock.Lock();
+
+    BlockCacheEntry* entry = 0;
+    while(true) {
+        entry = Find(disk, lba);
+        if(entry != 0 && entry->filling) {
+            Wait();
+            continue;
+        }
+
+        if(entry != 0) {
+            hits++;
+            MoveToFront(entry);
+            CopyOut(entry, buf);
+
+            cacheLock.Unlock();
+            return 0;
+        }
+
+        entry = Allocate(disk, lba);
+        if(entry != 0)
+            break;
+        Wait();
+    }
+
+    // Other readers of this block wait until it is loaded
+    misses++;
+    entry->filling = true;
+    entry->pins++;
+    cacheLock.Unlock();
+    char ret = disk->ReadSectorDirect(lba, entry->data);
+    cacheLock.Lock();
+    entry->filling = false;
+    entry->pins--;
+
+    if(ret != 0) {
+        // Don't keep the failed block around
+        if(entry->valid && entry->disk == disk && entry->lba == lba)
+            Release(entry);
+
+        cacheLock.Unlock();
+        return ret;
+    }
+
+    CopyOut(entry, buf);
+    cacheLock.Unlock();
+    return 0;
+}
+
+char BlockCache::Write(Disk* disk, uint32_t lba, uint8_t* buf)
+{
+    cacheLock.Lock();
+
+    // The whole block is overwritten, so there is no need to read it first
+    BlockCacheEntry* entry = 0;
+    while(true) {
+        entry = Find(disk, lba);
+        if(entry != 0 && (entry->filling || entry->pins > 0)) {
+            Wait();
+            continue;
+        }
+
+        if(entry != 0) {
+            hits++;
+            MoveToFront(entry);
+            break;
+        }
+
+        entry = Allocate(disk, lba);
+        if(entry != 0) {
+            misses++;
+            break;
+        }
+        Wait();
+    }
+
+    CopyIn(entry, buf);
+    if(entry->valid && !entry->dirty) {
+        entry->dirty = true;
+        dirtyBlocks++;
+    }
+
+    cacheLock.Unlock();
+    return 0;
+}
+
+char BlockCache::ReadBlocks(Disk* disk, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    cacheLock.Lock();
+
+    uint32_t i = 0;
+    while(i < count) {
+        BlockCacheEntry* entry = Find(disk, lba + i);
+        if(entry != 0 && entry->filling) {
+            Wait();
+            continue;
+        }
+
+        if(entry != 0) {
+            hits++;
+            MoveToFront(entry);
+            CopyOut(entry, buf + i * disk->blockSize);
+            i++;
+            continue;
+        }
+
+        // Read all following blocks that are not cached with one request
+        // Streaming reads are not added to the cache, they would only push out the blocks that are used again
+        uint32_t run = 1;
+        while(i + run < count && Find(disk, lba + i + run) == 0)
+            run++;
+        
+        misses += run;
+        cacheLock.Unlock();
+        char ret = disk->ReadSectorsDirect(lba + i, run, buf + i * disk->blockSize);
+        cacheLock.Lock();
+        if(ret != 0) {
+            cacheLock.Unlock();
+            return ret;
+        }
+
+        // Blocks that were written to the cache during the transfer are newer than what the device returned
+        for(uint32_t n = 0; n < run; ) {
+            entry = Find(disk, lba + i + n);
+            if(entry != 0 && entry->filling) {
+                Wait();
+                continue;
+            }
+
+            if(entry != 0 && entry->dirty)
+                CopyOut(entry, buf + (i + n) * disk->blockSize);
+            n++;
+        }
+        i += run;
+    }
+
+    cacheLock.Unlock();
+    return 0;
+}
+
+char BlockCache::WriteBlocks(Disk* disk, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    // Cached copies in the range, they are pinned during the transfer
+    BlockCacheEntry** cached = new BlockCacheEntry*[count];
+    MemoryOperations::memset(cached, 0, sizeof(BlockCacheEntry*) * count);
+
+    cacheLock.Lock();
+
+    // Give the cached copies the new data before the transfer and mark them clean
+    // That way a write back during the transfer can't put the old data on the device after the new data
+    for(uint32_t i = 0; i < count; ) {
+        BlockCacheEntry* entry = Find(disk, lba + i);
+        if(entry != 0 && (entry->filling || entry->pins > 0)) {
+            Wait();
+            continue;
+        }
+
+        if(entry != 0) {
+            CopyIn(entry, buf + i * disk->blockSize);
+            if(entry->dirty) {
+                entry->dirty = false;
+                dirtyBlocks--;
+            }
+            entry->pins++;
+            cached[i] = entry;
+        }
+        i++;
+    }
+
+    cacheLock.Unlock();
+    char ret = disk->WriteSectorsDirect(lba, count, buf);
+    cacheLock.Lock();
+
+    for(uint32_t i = 0; i < count; ) {
+        if(cached[i] != 0) {
+            cached[i]->pins--;
+
+            // The device still has the old data, so it needs to be written again later
+            if(ret != 0 && cached[i]->valid && !cached[i]->dirty) {
+                cached[i]->dirty = true;
+                dirtyBlocks++;
+            }
+            i++;
+            continue;
+        }
+
+        // Blocks that were read into the cache during the transfer can have the old data
+        BlockCacheEntry* entry = Find(disk, lba + i);
+        if(ret == 0 && entry != 0 && (entry->filling || entry->pins > 0)) {
+            Wait();
+            continue;
+        }
+        if(ret == 0 && entry != 0 && !entry->dirty)
+            CopyIn(entry, buf + i * disk->blockSize);
+        i++;
+    }
+
+    cacheLock.Unlock();
+    delete[] cached;
+    return ret;
+}
+
+char BlockCache::Flush(Disk* disk)
+{
+    if(dirtyBlocks == 0)
+        return 0;
+
+    cacheLock.Lock();
+
+    char result = 0;
+    for(int i = 0; i < BLOCKCACHE_ENTRIES; i++) {
+        BlockCacheEntry* entry = &entries[i];
+        if(entry->valid && entry->dirty && !entry->filling && (disk == 0 || entry->disk == disk)) {
+            char ret = WriteBack(entry);
+            if(ret != 0)
+                result = ret;
+        }
+    }
+
+    cacheLock.Unlock();
+    return result;
+}
+
+void BlockCache::Invalidate(Disk* disk)
+{
+    cacheLock.Lock();
+
+    for(int i = 0; i < BLOCKCACHE_ENTRIES; i++) {
+        BlockCacheEntry* entry = &entries[i];
+        if(entry->valid && entry->disk == disk)
+            Release(entry);
+    }
+
+    cacheLock.Unlock();
+}
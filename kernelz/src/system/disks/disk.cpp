@@ -15,6 +15,26 @@ Disk::Disk(uint32_t controllerIndex, DiskController* controller, DiskType type,
     this->numBlocks = blocks;
 }
 char Disk::ReadSector(uint32_t lba, uint8_t* buf)
+{
+    return BlockCache::Read(this, lba, buf);
+}
+char Disk::WriteSector(uint32_t lba, uint8_t* buf)
+{
+    return BlockCache::Write(this, lba, buf);
+}
+char Disk::ReadSectors(uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    if(count == 1)
+        return BlockCache::Read(this, lba, buf);
+    return BlockCache::ReadBlocks(this, lba, count, buf);
+}
+char Disk::WriteSectors(uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    if(count == 1)
+        return BlockCache::Write(this, lba, buf);
+    return BlockCache::WriteBlocks(this, lba, count, buf);
+}
+char Disk::ReadSectorDirect(uint32_t lba, uint8_t* buf)
 {
     #if ENABLE_ADV_DEBUG
     System::statistics.diskReadOp += 1;
@@ -24,7 +44,7 @@ char Disk::ReadSector(uint32_t lba, uint8_t* buf)
         return this->controller->ReadSector(this->controllerIndex, lba, buf);
     return 1;
 }
-char Disk::WriteSector(uint32_t lba, uint8_t* buf)
+char Disk::WriteSectorDirect(uint32_t lba, uint8_t* buf)
 {
     #if ENABLE_ADV_DEBUG
     System::statistics.diskWriteOp += 1;
@@ -33,4 +53,24 @@ char Disk::WriteSector(uint32_t lba, uint8_t* buf)
     if(this->controller != 0)
         return this->controller->WriteSector(this->controllerIndex, lba, buf);
     return 1;
+}
+char Disk::ReadSectorsDirect(uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    #if ENABLE_ADV_DEBUG
+    System::statistics.diskReadOp += 1;
+    #endif
+
+    if(this->controller != 0)
+        return this->controller->ReadSectors(this->controllerIndex, lba, count, buf);
+    return 1;
+}
+char Disk::WriteSectorsDirect(uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    #if ENABLE_ADV_DEBUG
+    System::statistics.diskWriteOp += 1;
+    #endif
+
+    if(this->controller != 0)
+        return this->controller->WriteSectors(this->controllerIndex, lba, count, buf);
+    return 1;
 }
\ No newline at end of file
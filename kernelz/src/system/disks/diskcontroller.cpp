@@ -10,5 +10,9 @@ char DiskController::ReadSector(uint16_t drive, uint32_t lba, uint8_t* buf)
 { return 1; } //Needs to be implemented by driver
 char DiskController::WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf)
 { return 1; } //Needs to be implemented by driver
+char DiskController::ReadSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{ return 1; } //Needs to be implemented by driver
+char DiskController::WriteSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{ return 1; } //Needs to be implemented by driver
 bool DiskController::EjectDrive(uint8_t drive)
 { return false; } //Needs to be implemented by driver
\ No newline at end of file
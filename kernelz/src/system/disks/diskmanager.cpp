@@ -42,6 +42,7 @@ void DiskManager::RemoveDisk(Disk* disk)
 {
     allDisks.Remove(disk); //Remove from list
     System::vfs->UnmountByDisk(disk); //And unmount all filesystems using that disk
+    BlockCache::Invalidate(disk); //The device is gone so cached blocks can't be written anymore
 }
 
 BiosDriveParameters* DiskManager::GetDriveInfoBios(uint8_t drive)
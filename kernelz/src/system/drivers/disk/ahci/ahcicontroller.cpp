@@ -168,6 +168,36 @@ char AHCIController::WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf)
 {
     return this->ports[drive]->TransferData(false, lba, buf, 1) ? 0 : 1;
 }
+char AHCIController::ReadSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    uint32_t sectorSize = this->ports[drive]->SectorSize();
+    uint32_t maxCount = AHCI_MAX_TRANSFER_SIZE / sectorSize;
+    while(count > 0) {
+        uint32_t n = count > maxCount ? maxCount : count;
+        if(!this->ports[drive]->TransferData(true, lba, buf, n))
+            return 1;
+        
+        lba += n;
+        buf += n * sectorSize;
+        count -= n;
+    }
+    return 0;
+}
+char AHCIController::WriteSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    uint32_t sectorSize = this->ports[drive]->SectorSize();
+    uint32_t maxCount = AHCI_MAX_TRANSFER_SIZE / sectorSize;
+    while(count > 0) {
+        uint32_t n = count > maxCount ? maxCount : count;
+        if(!this->ports[drive]->TransferData(false, lba, buf, n))
+            return 1;
+        
+        lba += n;
+        buf += n * sectorSize;
+        count -= n;
+    }
+    return 0;
+}
 bool AHCIController::EjectDrive(uint8_t drive)
 {
     return this->ports[drive]->Eject() ? 0 : 1;
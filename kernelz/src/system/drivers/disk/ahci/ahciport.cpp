@@ -53,6 +53,56 @@ int AHCIPort::FindFreeCMDSlot()
 	return -1;
 }
 
+a_commandTable_t* AHCIPort::PrepareCommandTable(int slot)
+{
+	a_commandTable_t* cmdTable = (a_commandTable_t*)(this->commandTables + slot * AHCI_COMMAND_TABLE_SIZE);
+	
+	// Only the FIS and command area, the PRDT entries are always written before use
+	MemoryOperations::memset(cmdTable, 0, sizeof(a_commandTable_t) - sizeof(a_prdtEntry_t));
+	this->commandList[slot].byteCount = 0;
+	return cmdTable;
+}
+uint32_t AHCIPort::BuildPRDT(a_commandTable_t* cmdTable, uint8_t* buffer, uint32_t size, bool deviceWrites)
+{
+	// The buffer is only contiguous in virtual memory, so add a PRDT entry for every physical region
+	uint32_t entryCount = 0;
+	uint32_t offset = 0;
+	while (offset < size)
+	{
+		uint32_t virt = (uint32_t)buffer + offset;
+		uint32_t phys = (uint32_t)VirtualMemoryManager::virtualToPhysical((void*)virt);
+		if (phys == 0)
+			return 0; // Not loaded yet
+		
+		// Pages of processes can be read-only or shared copy-on-write, the device would write past the page protection
+		if (deviceWrites && virt < KERNEL_VIRT_ADDR) {
+			PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(virt, false);
+			if (page == 0 || !page->readWrite)
+				return 0;
+		}
+
+		uint32_t length = 4_KB - (virt & 0xFFF);
+		if (length > size - offset)
+			length = size - offset;
+		
+		a_prdtEntry_t* prev = entryCount > 0 ? &cmdTable->prdt_entry[entryCount-1] : 0;
+		if (prev && prev->dataBase + prev->byteCount + 1 == phys)
+			prev->byteCount += length; // Physically continues the previous entry
+		else {
+			cmdTable->prdt_entry[entryCount].dataBase = phys;
+			cmdTable->prdt_entry[entryCount].dataBaseHigh = 0;
+			cmdTable->prdt_entry[entryCount].rsv0 = 0;
+			cmdTable->prdt_entry[entryCount].rsv1 = 0;
+			cmdTable->prdt_entry[entryCount].ioc = 0;
+			cmdTable->prdt_entry[entryCount].byteCount = length - 1; // This value should always be set to 1 less than the actual value
+			entryCount++;
+		}
+		offset += length;
+	}
+	cmdTable->prdt_entry[entryCount-1].ioc = 1;
+	return entryCount;
+}
+
 AHCIPort::AHCIPort(AHCIController* parent, uint32_t regBase, int index)
 {
     this->parent = parent;
@@ -67,6 +117,12 @@ AHCIPort::~AHCIPort()
     
     if(this->fis)
         delete this->fis;
+    
+    if(this->commandTables)
+        KernelHeap::allignedFree(this->commandTables);
+    
+    if(this->bounceBuffer)
+        KernelHeap::allignedFree(this->bounceBuffer);
 }
 
 bool AHCIPort::PreparePort()
@@ -82,6 +138,16 @@ bool AHCIPort::PreparePort()
     MemoryOperations::memset(this->commandList, 0, sizeof(a_commandHeader_t) * COMMAND_LIST_COUNT);
     MemoryOperations::memset(this->fis, 0, sizeof(a_fis_t));
 
+    // Every slot gets its own command table, so nothing needs to be allocated per command
+    this->commandTables = (uint8_t*)KernelHeap::alignedMalloc(AHCI_COMMAND_TABLE_SIZE * COMMAND_LIST_COUNT, AHCI_COMMAND_TABLE_SIZE, 0);
+    MemoryOperations::memset(this->commandTables, 0, AHCI_COMMAND_TABLE_SIZE * COMMAND_LIST_COUNT);
+    for(int i = 0; i < COMMAND_LIST_COUNT; i++) {
+        this->commandList[i].cmdTableAddress = (uint32_t)VirtualMemoryManager::virtualToPhysical(this->commandTables + i * AHCI_COMMAND_TABLE_SIZE);
+        this->commandList[i].cmdTableAddressHigh = 0;
+    }
+
+    this->bounceBuffer = (uint8_t*)KernelHeap::alignedMalloc(AHCI_MAX_TRANSFER_SIZE, 4_KB, 0);
+
     // Update port registers to point to structures
     writeRegister(AHCI_PORTREG_CMDLISTBASE, this->commandListPhys);
     writeRegister(AHCI_PORTREG_CMDLISTBASE2, 0);
@@ -237,25 +303,14 @@ bool AHCIPort::Identify(uint8_t* buffer)
 	if (slot == -1)
 		return false;
 
-	uint32_t bufPhys = 0;
-	uint8_t* buf = (uint8_t*)KernelHeap::alignedMalloc(512, 16, &bufPhys);
+	uint8_t* buf = this->bounceBuffer;
 	MemoryOperations::memset(buf, 0, 512);
  
-	a_commandHeader_t* cmdheader = &this->commandList[slot];
-	cmdheader->flags = (sizeof(FIS_REG_H2D) / sizeof(uint32_t)) | (0<<6) | (1<<16);
-
-	uint32_t cmdTablePhys = 0;
-	a_commandTable_t* cmdTable = (a_commandTable_t*)KernelHeap::alignedMalloc(sizeof(a_commandTable_t), 128, &cmdTablePhys);
-	MemoryOperations::memset(cmdTable, 0, sizeof(a_commandTable_t));
-
-	// Make header point to allocated table
-	cmdheader->cmdTableAddress = cmdTablePhys;
-	cmdheader->cmdTableAddressHigh = 0;
+	a_commandTable_t* cmdTable = this->PrepareCommandTable(slot);
+	uint32_t entryCount = this->BuildPRDT(cmdTable, buf, 512, true);
 
-	// Setup PRDT Entry
-	cmdTable->prdt_entry[0].dataBase = bufPhys;
-	cmdTable->prdt_entry[0].byteCount = 511;
-	cmdTable->prdt_entry[0].ioc = 1;
+	a_commandHeader_t* cmdheader = &this->commandList[slot];
+	cmdheader->flags = (sizeof(FIS_REG_H2D) / sizeof(uint32_t)) | (0<<6) | (entryCount<<16);
  
 	// Setup command
 	FIS_REG_H2D* cmdfis = (FIS_REG_H2D*)(&cmdTable->fis);
@@ -266,10 +321,6 @@ bool AHCIPort::Identify(uint8_t* buffer)
 
 	if(!waitForClear(AHCI_PORTREG_TASKFILE, 0x80 | 0x8, 1000)) {
 		Log(Error, "AHCI: Port is stuck!");
-		
-		KernelHeap::allignedFree(buf);
-		KernelHeap::allignedFree(cmdTable);
-		cmdheader->cmdTableAddress = 0;
 		return false;
 	}
 	
@@ -298,10 +349,6 @@ bool AHCIPort::Identify(uint8_t* buffer)
 	
 	if(ret)
 		MemoryOperations::memcpy(buffer, buf, 512);
-	
-	KernelHeap::allignedFree(buf);
-	KernelHeap::allignedFree(cmdTable);
-	cmdheader->cmdTableAddress = 0;
 
 	return ret;
 }
@@ -314,38 +361,28 @@ bool AHCIPort::TransferData(bool dirIn, uint32_t lba, uint8_t* buffer, uint32_t
 
 	// Required buffer size
 	uint32_t size = count * (this->isATATPI ? 2048 : 512);
-	uint32_t entryCount = (size / 8_KB + 1); // 8K bytes (16 sectors) per PRDT
-	uint32_t i = 0;
+	if (size > AHCI_MAX_TRANSFER_SIZE)
+		return false;
+	
 	uint32_t count2 = count;
 
-	uint32_t bufPhys = 0;
-	uint8_t* buf = (uint8_t*)KernelHeap::alignedMalloc(size, 16, &bufPhys);
-	MemoryOperations::memset(buf, 0, size);
- 
-	a_commandHeader_t* cmdheader = &this->commandList[slot];
-	cmdheader->flags = (sizeof(FIS_REG_H2D) / sizeof(uint32_t)) | (0<<6) | (entryCount<<16);
-
-	uint32_t cmdTablePhys = 0;
-	a_commandTable_t* cmdTable = (a_commandTable_t*)KernelHeap::alignedMalloc(sizeof(a_commandTable_t) + (entryCount-1) * sizeof(a_prdtEntry_t), 128, &cmdTablePhys);
-	MemoryOperations::memset(cmdTable, 0, sizeof(a_commandTable_t) + (entryCount-1) * sizeof(a_prdtEntry_t));
-
-	// Make header point to allocated table
-	cmdheader->cmdTableAddress = cmdTablePhys;
-	cmdheader->cmdTableAddressHigh = 0;
-
-	// Setup required entries
-	for (i = 0; i < (entryCount-1); i++)
-	{
-		cmdTable->prdt_entry[i].dataBase = bufPhys;
-		cmdTable->prdt_entry[i].byteCount = 8*1024-1;	// 8K bytes (this value should always be set to 1 less than the actual value)
-		cmdTable->prdt_entry[i].ioc = 1;
-		bufPhys += 4*1024;	// 4K words
-		count -= 16;	// 16 sectors
+	a_commandTable_t* cmdTable = this->PrepareCommandTable(slot);
+
+	// DMA goes directly to the callers buffer, unless it is not word aligned as required by the PRDT
+	// or has pages that are not present or can't be written by the device, then the bounce buffer is used
+	// The buffer needs to be mapped in the current address space, which is the case for the caller
+	uint32_t entryCount = ((uint32_t)buffer & 1) == 0 ? this->BuildPRDT(cmdTable, buffer, size, dirIn) : 0;
+	bool useBounce = entryCount == 0;
+	uint8_t* buf = useBounce ? this->bounceBuffer : buffer;
+	if(useBounce) {
+		this->bounceLock.Lock();
+		if(!dirIn)
+			MemoryOperations::memcpy(buf, buffer, size);
+		entryCount = this->BuildPRDT(cmdTable, buf, size, dirIn);
 	}
-	// Last entry
-	cmdTable->prdt_entry[i].dataBase = bufPhys;
-	cmdTable->prdt_entry[i].byteCount = (size % 4_KB)-1; // 512 bytes per sector
-	cmdTable->prdt_entry[i].ioc = 1;
+
+	a_commandHeader_t* cmdheader = &this->commandList[slot];
+	cmdheader->flags = (sizeof(FIS_REG_H2D) / sizeof(uint32_t)) | ((dirIn ? 0 : 1)<<6) | (entryCount<<16);
 
 	if(this->isATATPI)
 	{
@@ -368,10 +405,10 @@ bool AHCIPort::TransferData(bool dirIn, uint32_t lba, uint8_t* buffer, uint32_t
 		cmdTable->cmd[ 3] = (lba >> 16) & 0xFF;
 		cmdTable->cmd[ 4] = (lba >> 8) & 0xFF;
 		cmdTable->cmd[ 5] = (lba >> 0) & 0xFF;
-		cmdTable->cmd[ 6] = 0x0;
-		cmdTable->cmd[ 7] = 0x0;
-		cmdTable->cmd[ 8] = 0x0;
-		cmdTable->cmd[ 9] = count2;
+		cmdTable->cmd[ 6] = (count2 >> 24) & 0xFF;
+		cmdTable->cmd[ 7] = (count2 >> 16) & 0xFF;
+		cmdTable->cmd[ 8] = (count2 >> 8) & 0xFF;
+		cmdTable->cmd[ 9] = (count2 >> 0) & 0xFF;
 		cmdTable->cmd[10] = 0x0;
 		cmdTable->cmd[11] = 0x0;
 	}
@@ -399,10 +436,8 @@ bool AHCIPort::TransferData(bool dirIn, uint32_t lba, uint8_t* buffer, uint32_t
 
 	if(!waitForClear(AHCI_PORTREG_TASKFILE, 0x80 | 0x8, 1000)) {
 		Log(Error, "AHCI: Port is stuck!");
-		
-		KernelHeap::allignedFree(buf);
-		KernelHeap::allignedFree(cmdTable);
-		cmdheader->cmdTableAddress = 0;
+		if(useBounce)
+			this->bounceLock.Unlock();
 		return false;
 	}
 	
@@ -429,16 +464,19 @@ bool AHCIPort::TransferData(bool dirIn, uint32_t lba, uint8_t* buffer, uint32_t
 	if (readRegister(AHCI_PORTREG_COMMANDISSUE) & (1<<30))
 		ret = false;
 	
-	if(ret)
-		MemoryOperations::memcpy(buffer, buf, size);
-	
-	KernelHeap::allignedFree(buf);
-	KernelHeap::allignedFree(cmdTable);
-	cmdheader->cmdTableAddress = 0;
+	if(useBounce) {
+		if(ret && dirIn)
+			MemoryOperations::memcpy(buffer, buf, size);
+		this->bounceLock.Unlock();
+	}
 
 	return ret;
 }			
 
+uint32_t AHCIPort::SectorSize()
+{
+	return this->isATATPI ? 2048 : 512;
+}
 
 bool AHCIPort::Eject()
 {
@@ -452,13 +490,7 @@ bool AHCIPort::Eject()
 	a_commandHeader_t* cmdheader = &this->commandList[slot];
 	cmdheader->flags = (sizeof(FIS_REG_H2D) / sizeof(uint32_t)) | (0<<6) | (0<<16);
 
-	uint32_t cmdTablePhys = 0;
-	a_commandTable_t* cmdTable = (a_commandTable_t*)KernelHeap::alignedMalloc(sizeof(a_commandTable_t), 128, &cmdTablePhys);
-	MemoryOperations::memset(cmdTable, 0, sizeof(a_commandTable_t));
-
-	// Make header point to allocated table
-	cmdheader->cmdTableAddress = cmdTablePhys;
-	cmdheader->cmdTableAddressHigh = 0;
+	a_commandTable_t* cmdTable = this->PrepareCommandTable(slot);
 
 	// Setup command
 	FIS_REG_H2D* cmdfis = (FIS_REG_H2D*)(&cmdTable->fis);
@@ -477,9 +509,6 @@ bool AHCIPort::Eject()
 
 	if(!waitForClear(AHCI_PORTREG_TASKFILE, 0x80 | 0x8, 1000)) {
 		Log(Error, "AHCI: Port is stuck!");
-		
-		KernelHeap::allignedFree(cmdTable);
-		cmdheader->cmdTableAddress = 0;
 		return false;
 	}
 	
@@ -506,8 +535,5 @@ bool AHCIPort::Eject()
 	if (readRegister(AHCI_PORTREG_COMMANDISSUE) & (1<<30))
 		ret = false;
 	
-	KernelHeap::allignedFree(cmdTable);
-	cmdheader->cmdTableAddress = 0;
-
 	return ret;
 }
\ No newline at end of file
@@ -277,6 +277,19 @@ const void IDEController::WaitForIRQ()
     this->irqState = false;
 }
 
+const void IDEController::SetupPRDT(IDEDevice* dev, uint32_t bytes)
+{
+    for(uint32_t e = 0; e < IDE_DMA_BUFFER_SIZE / PAGE_SIZE; e++) {
+        uint32_t length = bytes > PAGE_SIZE ? PAGE_SIZE : bytes;
+        bytes -= length;
+
+        dev->prdt[e].byteCount = length;
+        dev->prdt[e].flags = (bytes == 0) ? (1<<15) : 0; // Mark the last entry
+        if(bytes == 0)
+            break;
+    }
+}
+
 bool IDEController::Initialize()
 {
     uint8_t mode = this->pciDevice->programmingInterfaceID & 0b1111;
@@ -471,15 +484,17 @@ bool IDEController::Initialize()
                 }
 
                 // Setup DMA Stuff
-                dev->prdt = (IDEPhysRegionDescriptor*)KernelHeap::alignedMalloc(sizeof(IDEPhysRegionDescriptor), 32, &dev->prdtPhys);
-                MemoryOperations::memset(dev->prdt, 0, sizeof(IDEPhysRegionDescriptor));
-                dev->prdtBuffer = (uint8_t*)KernelHeap::alignedMalloc(PAGE_SIZE, PAGE_SIZE, &dev->prdtBufferPhys);
-                MemoryOperations::memset(dev->prdtBuffer, 0, PAGE_SIZE);
-
-                // Setup PRDT
-                dev->prdt->bufferPtrPhys = dev->prdtBufferPhys;
-                dev->prdt->byteCount = ATA_SECTOR_SIZE;
-                dev->prdt->flags = (1<<15);
+                const uint32_t entries = IDE_DMA_BUFFER_SIZE / PAGE_SIZE;
+                dev->prdt = (IDEPhysRegionDescriptor*)KernelHeap::alignedMalloc(sizeof(IDEPhysRegionDescriptor) * entries, 64, &dev->prdtPhys);
+                MemoryOperations::memset(dev->prdt, 0, sizeof(IDEPhysRegionDescriptor) * entries);
+                dev->prdtBuffer = (uint8_t*)KernelHeap::alignedMalloc(IDE_DMA_BUFFER_SIZE, PAGE_SIZE, 0);
+                MemoryOperations::memset(dev->prdtBuffer, 0, IDE_DMA_BUFFER_SIZE);
+
+                // Setup PRDT, the buffer is only contiguous in virtual memory so every page gets its own entry
+                // A page never crosses a 64K boundary, so this also keeps the controller happy
+                for(uint32_t e = 0; e < entries; e++)
+                    dev->prdt[e].bufferPtrPhys = (uint32_t)VirtualMemoryManager::virtualToPhysical(dev->prdtBuffer + e * PAGE_SIZE);
+                this->SetupPRDT(dev, ATA_SECTOR_SIZE);
             }
 
             // Get Size for ATA drive
@@ -539,14 +554,14 @@ bool IDEController::Initialize()
     return true;
 }
 
-char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t* buf, bool read)
+char IDEController::ATA_DMA_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf, bool read)
 {
     IDEDevice* dev = this->devices[drive];
-    dev->prdt->byteCount = ATA_SECTOR_SIZE;
+    this->SetupPRDT(dev, count * ATA_SECTOR_SIZE);
 
     // Write data to DMA buffer
     if(!read)
-        MemoryOperations::memcpy(dev->prdtBuffer, buf, ATA_SECTOR_SIZE);
+        MemoryOperations::memcpy(dev->prdtBuffer, buf, count * ATA_SECTOR_SIZE);
 
     // Reset DMA command register
     this->WriteRegister(dev->Channel, IDE_REG_BMI_CMD, 0);
@@ -557,7 +572,7 @@ char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t
     // Enable interrupts
     this->SetChannelInterruptEnable(dev->Channel, true);
 
-    if(lba > 0xFFFFFFF) // We need to use 48-Bit addressing for this LBA
+    if(lba + count > 0xFFFFFFF) // We need to use 48-Bit addressing for this LBA
     {
         if(!dev->specs.use48_Bit)
             return 1; // 48-Bit addressing needs to be supported by drive
@@ -566,7 +581,7 @@ char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t
         this->WriteRegister(dev->Channel, IDE_REG_HDDEVSEL, 0xE0 | (dev->Drive << 4));
 
         // Setup registers for LBA address and sector count
-        this->SetCountAndLBA(dev->Channel, 1, lba, true);
+        this->SetCountAndLBA(dev->Channel, count, lba, true);
 
         if(read)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_READ_DMA_EXT); // Send command
@@ -579,7 +594,7 @@ char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t
         this->WriteRegister(dev->Channel, IDE_REG_HDDEVSEL, 0xE0 | (dev->Drive << 4) | (lba & 0xF000000) >> 24);
     
         // Setup registers for LBA address and sector count
-        this->SetCountAndLBA(dev->Channel, 1, lba, false);
+        this->SetCountAndLBA(dev->Channel, count, lba, false);
 
         if(read)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_READ_DMA); // Send command
@@ -607,14 +622,14 @@ char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t
         return 1; // Error occurred
 
     if(read)
-        MemoryOperations::memcpy(buf, dev->prdtBuffer, ATA_SECTOR_SIZE);
+        MemoryOperations::memcpy(buf, dev->prdtBuffer, count * ATA_SECTOR_SIZE);
     else
     {
         // In the case of a write we also need to send a Cache flush command
         this->SetCountAndLBA(dev->Channel, 0, 0, false);
         this->WriteRegister(dev->Channel, IDE_REG_FEATURES, 0);
 
-        if(lba > 0xFFFFFFF)
+        if(lba + count > 0xFFFFFFF)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_CACHE_FLUSH_EXT);
         else
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
@@ -626,10 +641,10 @@ char IDEController::ATA_DMA_TransferSector(uint16_t drive, uint32_t lba, uint8_t
     return 0;
 }
 
-char IDEController::ATAPI_DMA_TransferSector(uint16_t drive, uint16_t lba, uint8_t* buf)
+char IDEController::ATAPI_DMA_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
 {
     IDEDevice* dev = this->devices[drive];
-    dev->prdt->byteCount = ATAPI_SECTOR_SIZE;
+    this->SetupPRDT(dev, count * ATAPI_SECTOR_SIZE);
 
     // Set PDRT Pointer
     outportl(this->channels[dev->Channel].bmideReg + 4, dev->prdtPhys);
@@ -647,7 +662,7 @@ char IDEController::ATAPI_DMA_TransferSector(uint16_t drive, uint16_t lba, uint8
     this->Wait400NS(dev->Channel);
 
     // Send packet to device
-    if(!this->SendPacketCommand(dev->Channel, ATAPI_CMD_READ, lba, 1, true, dev->specs.IO_Ready))
+    if(!this->SendPacketCommand(dev->Channel, ATAPI_CMD_READ, lba, count, true, dev->specs.IO_Ready))
         return 1;
 
     // Start DMA operation by setting the right bits in the Command Register
@@ -670,12 +685,12 @@ char IDEController::ATAPI_DMA_TransferSector(uint16_t drive, uint16_t lba, uint8
     if(ctrlStatus & (1<<1) || devStatus & (1<<0))
         return 1; // Error occurred
 
-    MemoryOperations::memcpy(buf, dev->prdtBuffer, ATAPI_SECTOR_SIZE);
+    MemoryOperations::memcpy(buf, dev->prdtBuffer, count * ATAPI_SECTOR_SIZE);
 
     return 0;
 }
 
-char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t* buf, bool read)
+char IDEController::ATA_PIO_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf, bool read)
 {
     IDEDevice* dev = this->devices[drive];
 
@@ -686,7 +701,7 @@ char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t
     if(!this->WaitForClear(dev->Channel, IDE_REG_ALTSTATUS, IDE_SR_BSY, IDE_TIMEOUT))
         return 1;
 
-    if(lba > 0xFFFFFFF) // We need to use 48-Bit addressing for this LBA
+    if(lba + count > 0xFFFFFFF) // We need to use 48-Bit addressing for this LBA
     {
         if(!dev->specs.use48_Bit)
             return 1; // 48-Bit addressing needs to be supported by drive
@@ -695,7 +710,7 @@ char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t
         this->WriteRegister(dev->Channel, IDE_REG_HDDEVSEL, 0xE0 | (dev->Drive << 4));
 
         // Setup registers for LBA address and sector count
-        this->SetCountAndLBA(dev->Channel, 1, lba, true);
+        this->SetCountAndLBA(dev->Channel, count, lba, true);
 
         if(read)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_READ_PIO_EXT); // Send command
@@ -708,7 +723,7 @@ char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t
         this->WriteRegister(dev->Channel, IDE_REG_HDDEVSEL, 0xE0 | (dev->Drive << 4) | (lba & 0xF000000) >> 24);
     
         // Setup registers for LBA address and sector count
-        this->SetCountAndLBA(dev->Channel, 1, lba, false);
+        this->SetCountAndLBA(dev->Channel, count, lba, false);
 
         if(read)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_READ_PIO); // Send command
@@ -716,17 +731,20 @@ char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_WRITE_PIO); // Send command
     }
 
-    if(this->Polling(dev->Channel, true) == false)
-        return 1;
-    
-    // Transfer data through data port
-    if(read)
-        this->PIOReadData(dev->Channel, dev->specs.IO_Ready, buf, ATA_SECTOR_SIZE);
-    else {
-        this->PIOWriteData(dev->Channel, dev->specs.IO_Ready, buf, ATA_SECTOR_SIZE);
+    // Transfer data through data port, the drive is ready for every sector separately
+    for(uint32_t i = 0; i < count; i++) {
+        if(this->Polling(dev->Channel, true) == false)
+            return 1;
+        
+        if(read)
+            this->PIOReadData(dev->Channel, dev->specs.IO_Ready, buf + i * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE);
+        else
+            this->PIOWriteData(dev->Channel, dev->specs.IO_Ready, buf + i * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE);
+    }
 
+    if(!read) {
         // In the case of a write we also need to send a Cache flush command
-        if(lba > 0xFFFFFFF)
+        if(lba + count > 0xFFFFFFF)
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_CACHE_FLUSH_EXT);
         else
             this->WriteRegister(dev->Channel, IDE_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
@@ -740,7 +758,7 @@ char IDEController::ATA_PIO_TransferSector(uint16_t drive, uint32_t lba, uint8_t
     return 0;
 }
 
-char IDEController::ATAPI_PIO_TransferSector(uint16_t drive, uint16_t lba, uint8_t* buf)
+char IDEController::ATAPI_PIO_TransferSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
 {
     IDEDevice* dev = this->devices[drive];
 
@@ -751,18 +769,21 @@ char IDEController::ATAPI_PIO_TransferSector(uint16_t drive, uint16_t lba, uint8
     this->Wait400NS(dev->Channel);
 
     // Send packet to device
-    if(!this->SendPacketCommand(dev->Channel, ATAPI_CMD_READ, lba, 1, false, dev->specs.IO_Ready))
+    if(!this->SendPacketCommand(dev->Channel, ATAPI_CMD_READ, lba, count, false, dev->specs.IO_Ready))
         return 1;
 
-    // Wait for IRQ
-    this->WaitForIRQ();
+    // The byte count limit is one sector, so the drive interrupts for every sector
+    for(uint32_t i = 0; i < count; i++) {
+        // Wait for IRQ
+        this->WaitForIRQ();
 
-    // Check for errors by polling (could also check status register but this works fine)
-    if(!this->Polling(dev->Channel, true))
-        return 1;
+        // Check for errors by polling (could also check status register but this works fine)
+        if(!this->Polling(dev->Channel, true))
+            return 1;
 
-    // Finally read data
-    this->PIOReadData(dev->Channel, dev->specs.IO_Ready, buf, ATAPI_SECTOR_SIZE);
+        // Finally read data
+        this->PIOReadData(dev->Channel, dev->specs.IO_Ready, buf + i * ATAPI_SECTOR_SIZE, ATAPI_SECTOR_SIZE);
+    }
 
     return 0;
 }
@@ -770,23 +791,48 @@ char IDEController::ATAPI_PIO_TransferSector(uint16_t drive, uint16_t lba, uint8
 
 char IDEController::ReadSector(uint16_t drive, uint32_t lba, uint8_t* buf)
 {
+    return this->ReadSectors(drive, lba, 1, buf);
+}
+
+char IDEController::WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf)
+{
+    return this->WriteSectors(drive, lba, 1, buf);
+}
+
+char IDEController::ReadSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+    IDEDevice* dev = this->devices[drive];
+    if(dev->Type != IDE_ATA && dev->Type != IDE_ATAPI)
+        return 1;
+
+    uint32_t sectorSize = dev->Type == IDE_ATA ? ATA_SECTOR_SIZE : ATAPI_SECTOR_SIZE;
+    uint32_t maxCount = IDE_DMA_BUFFER_SIZE / sectorSize;
+
     // Prevent multiple processes from using this function at the same time
     this->ideLock.Lock();
 
-    uint8_t returnCode = 1;
-    if(this->devices[drive]->Type == IDE_ATA) 
+    uint8_t returnCode = 0;
+    while(count > 0 && returnCode == 0)
     {
-        if(IDE_DEV_DMA(this->devices[drive]))
-            returnCode = this->ATA_DMA_TransferSector(drive, lba, buf, true);
-        else
-            returnCode = this->ATA_PIO_TransferSector(drive, lba, buf, true);
-    }
-    else if (this->devices[drive]->Type == IDE_ATAPI)
-    {
-        if(IDE_DEV_DMA(this->devices[drive]))
-            returnCode = this->ATAPI_DMA_TransferSector(drive, lba, buf);
+        uint32_t n = count > maxCount ? maxCount : count;
+        if(dev->Type == IDE_ATA) 
+        {
+            if(IDE_DEV_DMA(dev))
+                returnCode = this->ATA_DMA_TransferSectors(drive, lba, n, buf, true);
+            else
+                returnCode = this->ATA_PIO_TransferSectors(drive, lba, n, buf, true);
+        }
         else
-            returnCode = this->ATAPI_PIO_TransferSector(drive, lba, buf);
+        {
+            if(IDE_DEV_DMA(dev))
+                returnCode = this->ATAPI_DMA_TransferSectors(drive, lba, n, buf);
+            else
+                returnCode = this->ATAPI_PIO_TransferSectors(drive, lba, n, buf);
+        }
+
+        lba += n;
+        buf += n * sectorSize;
+        count -= n;
     }
 
     // Everything is processed so an other process can have access to this function
@@ -795,21 +841,34 @@ char IDEController::ReadSector(uint16_t drive, uint32_t lba, uint8_t* buf)
     return returnCode;
 }
 
-char IDEController::WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf)
+char IDEController::WriteSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
 {
+    IDEDevice* dev = this->devices[drive];
+    if(dev->Type == IDE_ATAPI) {
+        Log(Error, "IDEController ATAPI::WriteSector not supported!");
+        return 1;
+    }
+    if(dev->Type != IDE_ATA)
+        return 1;
+    
+    uint32_t maxCount = IDE_DMA_BUFFER_SIZE / ATA_SECTOR_SIZE;
+
     // Prevent multiple processes from using this function at the same time
     this->ideLock.Lock();
 
-    uint8_t returnCode = 1;
-    if(this->devices[drive]->Type == IDE_ATA) 
+    uint8_t returnCode = 0;
+    while(count > 0 && returnCode == 0)
     {
-        if(IDE_DEV_DMA(this->devices[drive]))
-            returnCode = this->ATA_DMA_TransferSector(drive, lba, buf, false);
+        uint32_t n = count > maxCount ? maxCount : count;
+        if(IDE_DEV_DMA(dev))
+            returnCode = this->ATA_DMA_TransferSectors(drive, lba, n, buf, false);
         else
-            returnCode = this->ATA_PIO_TransferSector(drive, lba, buf, false);
+            returnCode = this->ATA_PIO_TransferSectors(drive, lba, n, buf, false);
+
+        lba += n;
+        buf += n * ATA_SECTOR_SIZE;
+        count -= n;
     }
-    else if (this->devices[drive]->Type == IDE_ATAPI)
-        Log(Error, "IDEController ATAPI::WriteSector not supported!");
 
     // Everything is processed so an other process can have access to this function
     this->ideLock.Unlock();
@@ -479,6 +479,21 @@ char FloppyDriver::WriteSector(uint16_t drive, uint32_t lba, uint8_t* buf)
 
 	return ret;
 }
+// The DMA buffer only holds one sector, so multiple sectors are transfered one by one
+char FloppyDriver::ReadSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+	for(uint32_t i = 0; i < count; i++)
+		if(ReadSector(drive, lba + i, buf + i * BYTES_PER_SECT) != 0)
+			return 1;
+	return 0;
+}
+char FloppyDriver::WriteSectors(uint16_t drive, uint32_t lba, uint32_t count, uint8_t* buf)
+{
+	for(uint32_t i = 0; i < count; i++)
+		if(WriteSector(drive, lba + i, buf + i * BYTES_PER_SECT) != 0)
+			return 1;
+	return 0;
+}
 bool FloppyDriver::EjectDrive(uint8_t drive)
 {
 	return false;
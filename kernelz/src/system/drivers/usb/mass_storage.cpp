@@ -39,7 +39,7 @@ bool USBMassStorageDriver::Initialize()
     for(int i = 0; i < 3; i++) {
         if(!SCSIRequest(&checkReadyCMD, 0, 0)) {
             Log(Warning, "MSD Device not ready yet");
-            System::pit->Sleep(100);
+            System::scheduler->Sleep(100);
         }
         else {
             break;
@@ -295,9 +295,13 @@ bool USBMassStorageDriver::SCSIRequest(CommandBlockWrapper* request, uint8_t* da
     }
 
     // If this is a data command, recieve the data
-    if(dataLength > 0) {
+    // The host controller drivers only have transfer descriptors for a single block, so larger transfers are split up
+    // The device does not care, for it this is still one data stage
+    int chunkSize = (this->blockSize > 0 && dataLength > (int)this->blockSize) ? (int)this->blockSize : dataLength;
+    for(int offset = 0; offset < dataLength; offset += chunkSize) {
+        int length = (dataLength - offset) < chunkSize ? (dataLength - offset) : chunkSize;
         if(request->flags == 0x80) { // In Transfer
-            if(!this->device->controller->BulkIn(this->device, dataPointer, dataLength, this->bulkInEP)) {
+            if(!this->device->controller->BulkIn(this->device, dataPointer + offset, length, this->bulkInEP)) {
                 Log(Error, "Error receiving data after command %b from bulk endpoint, len=%d", request->command[0], dataLength);
                 
                 // Clear HALT feature for the IN-Endpoint
@@ -306,10 +310,11 @@ bool USBMassStorageDriver::SCSIRequest(CommandBlockWrapper* request, uint8_t* da
                     return false;
                 }
                 this->device->endpoints[this->bulkInEP-1]->SetToggle(0);
+                break;
             }
         }
         else { // Out Transfer
-            if(!this->device->controller->BulkOut(this->device, dataPointer, dataLength, this->bulkOutEP)) {
+            if(!this->device->controller->BulkOut(this->device, dataPointer + offset, length, this->bulkOutEP)) {
                 Log(Error, "Error sending data after command %b to bulk endpoint, len=%d", request->command[0], dataLength);
                 
                 // Clear HALT feature for the OUT-Endpoint
@@ -317,7 +322,8 @@ bool USBMassStorageDriver::SCSIRequest(CommandBlockWrapper* request, uint8_t* da
                     Log(Error, "MSD, Clear feature (HALT) Failed for Bulk-Out!");
                     return false;
                 }
-                this->device->endpoints[this->bulkOutEP-1]->SetToggle(0);                
+                this->device->endpoints[this->bulkOutEP-1]->SetToggle(0);
+                break;
             }
         }
     }
@@ -374,33 +380,63 @@ void USBMassStorageDriver::DeInitialize()
 }
 
 // Read Sector from mass storage device
-char USBMassStorageDriver::ReadSector(common::uint32_t lba, common::uint8_t* buf)
+char USBMassStorageDriver::ReadSectorDirect(common::uint32_t lba, common::uint8_t* buf)
+{
+    return this->ReadSectorsDirect(lba, 1, buf);
+}
+
+// Write Sector to mass storage device
+char USBMassStorageDriver::WriteSectorDirect(common::uint32_t lba, common::uint8_t* buf)
+{
+    return this->WriteSectorsDirect(lba, 1, buf);
+}
+
+// Read multiple sectors from mass storage device
+char USBMassStorageDriver::ReadSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf)
 {
+    uint32_t maxCount = MSD_MAX_TRANSFER_SIZE / this->blockSize;
+
     this->readWriteLock.Lock();
-    CommandBlockWrapper sendBuf = SCSIPrepareCommandBlock(this->use16Base ? SCSI_READ_16 : SCSI_READ_10, this->blockSize, lba, 1);
-    if(SCSIRequest(&sendBuf, buf, this->blockSize)) {
-        this->readWriteLock.Unlock();
-        return 0; // Command Succes
-    }
+    while(count > 0) {
+        uint32_t n = count > maxCount ? maxCount : count;
+        CommandBlockWrapper sendBuf = SCSIPrepareCommandBlock(this->use16Base ? SCSI_READ_16 : SCSI_READ_10, n * this->blockSize, lba, n);
+        if(!SCSIRequest(&sendBuf, buf, n * this->blockSize)) {
+            Log(Error, "MSD Error reading sector %x", lba);
+
+            this->readWriteLock.Unlock();
+            return -1;
+        }
 
-    Log(Error, "MSD Error reading sector %x", lba);
+        lba += n;
+        buf += n * this->blockSize;
+        count -= n;
+    }
 
     this->readWriteLock.Unlock();
-    return -1;
+    return 0; // Command Succes
 }
 
-// Write Sector to mass storage device
-char USBMassStorageDriver::WriteSector(common::uint32_t lba, common::uint8_t* buf)
+// Write multiple sectors to mass storage device
+char USBMassStorageDriver::WriteSectorsDirect(common::uint32_t lba, common::uint32_t count, common::uint8_t* buf)
 {
+    uint32_t maxCount = MSD_MAX_TRANSFER_SIZE / this->blockSize;
+
     this->readWriteLock.Lock();
-    CommandBlockWrapper sendBuf = SCSIPrepareCommandBlock(this->use16Base ? SCSI_WRITE_16 : SCSI_WRITE_10, this->blockSize, lba, 1);
-    if(SCSIRequest(&sendBuf, buf, this->blockSize)) {
-        this->readWriteLock.Unlock();
-        return 0; // Command Succes
-    }
+    while(count > 0) {
+        uint32_t n = count > maxCount ? maxCount : count;
+        CommandBlockWrapper sendBuf = SCSIPrepareCommandBlock(this->use16Base ? SCSI_WRITE_16 : SCSI_WRITE_10, n * this->blockSize, lba, n);
+        if(!SCSIRequest(&sendBuf, buf, n * this->blockSize)) {
+            Log(Error, "MSD Error writing sector %x", lba);
+
+            this->readWriteLock.Unlock();
+            return -1;
+        }
 
-    Log(Error, "MSD Error writing sector %x", lba);
+        lba += n;
+        buf += n * this->blockSize;
+        count -= n;
+    }
 
     this->readWriteLock.Unlock();
-    return -1;
+    return 0; // Command Succes
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <system/listings/systeminfo.h>
 #include <system/system.h>
+#include <core/fpu.h>
+#include <system/memory/pagecache.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -237,6 +239,14 @@ bool SystemInfoManager::HandleSysinfoRequest(void* arrayPointer, int count, comm
                 *((uint32_t*)retAddr) = ProcessHelper::Processes[index]->heap.heapEnd;
                 return true;
             }
+            else if(String::strcmp(items[3].id, "start-ticks")) {
+                *((uint64_t*)retAddr) = ProcessHelper::Processes[index]->startTicks;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "demand-pages")) {
+                *((uint32_t*)retAddr) = ProcessHelper::Processes[index]->demandPages;
+                return true;
+            }
             else if(String::strcmp(items[3].id, "filename")) {
                 char* targ = (char*)retAddr;
                 int len = String::strlen(ProcessHelper::Processes[index]->fileName);
@@ -247,6 +257,90 @@ bool SystemInfoManager::HandleSysinfoRequest(void* arrayPointer, int count, comm
             else
                 return false;
         }
+        else if(String::strcmp(items[1].id, "scheduler")) {
+            if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::String)
+                return false; // Needs to be property id
+            
+            if(String::strcmp(items[2].id, "threads")) {
+                *((uint32_t*)retAddr) = System::scheduler->ThreadCount();
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "wakeups")) {
+                *((uint32_t*)retAddr) = System::scheduler->wakeups;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "latewakeups")) {
+                *((uint32_t*)retAddr) = System::scheduler->lateWakeups;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "maxwakelatency")) {
+                *((uint32_t*)retAddr) = System::scheduler->wakeLatency.maximum;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "idle")) {
+                *((uint32_t*)retAddr) = System::scheduler->idlePercentage;
+                return true;
+            }
+            else
+                return false;
+        }
+        else if(String::strcmp(items[1].id, "fpu")) {
+            if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::String)
+                return false; // Needs to be property id
+            
+            if(String::strcmp(items[2].id, "traps")) {
+                *((uint32_t*)retAddr) = FPU::trapsPerSecond;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "savesavoided")) {
+                *((uint32_t*)retAddr) = FPU::savesAvoidedPerSecond;
+                return true;
+            }
+            else
+                return false;
+        }
+        else if(String::strcmp(items[1].id, "blockcache")) {
+            if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::String)
+                return false; // Needs to be property id
+            
+            if(String::strcmp(items[2].id, "size")) {
+                *((uint32_t*)retAddr) = BLOCKCACHE_ENTRIES;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "hits")) {
+                *((uint32_t*)retAddr) = BlockCache::hits;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "misses")) {
+                *((uint32_t*)retAddr) = BlockCache::misses;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "dirty")) {
+                *((uint32_t*)retAddr) = BlockCache::dirtyBlocks;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "writebacks")) {
+                *((uint32_t*)retAddr) = BlockCache::writeBacks;
+                return true;
+            }
+            else
+                return false;
+        }
+        else if(String::strcmp(items[1].id, "heap")) {
+            if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::String)
+                return false; // Needs to be property id
+            
+            if(String::strcmp(items[2].id, "used")) {
+                *((uint32_t*)retAddr) = KernelHeap::UsedMemory();
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "contention")) {
+                *((uint32_t*)retAddr) = KernelHeap::LockContention();
+                return true;
+            }
+            else
+                return false;
+        }
         else if(String::strcmp(items[1].id, "memory")) {
             if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::String)
                 return false; // Needs to be property id
@@ -263,6 +357,59 @@ bool SystemInfoManager::HandleSysinfoRequest(void* arrayPointer, int count, comm
                 *((uint32_t*)retAddr) = PhysicalMemoryManager::FreeBlocks() * PAGE_SIZE;
                 return true;
             }
+            else if(String::strcmp(items[2].id, "cached")) {
+                *((uint32_t*)retAddr) = PageCache::cachedPages * PAGE_SIZE;
+                return true;
+            }
+            else if(String::strcmp(items[2].id, "shared")) {
+                *((uint32_t*)retAddr) = PageCache::sharedPages * PAGE_SIZE;
+                return true;
+            }
+            else
+                return false;
+        }
+        else if(String::strcmp(items[1].id, "slabcaches")) {
+            if(getSize) {
+                *((int*)retAddr) = SLAB_CACHE_COUNT;
+                return true;
+            }
+            if(items[2].type != LIBHeisenKernel::SIPropertyIdentifier::Index || items[3].type != LIBHeisenKernel::SIPropertyIdentifier::String)
+                return false; // Needs to be index for collection and next needs to be property id
+
+            SlabCache* cache = KernelHeap::GetSlabCache(items[2].index);
+            if(cache == 0)
+                return false;
+
+            if(String::strcmp(items[3].id, "objectsize")) {
+                *((uint32_t*)retAddr) = cache->objectSize;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "live")) {
+                *((uint32_t*)retAddr) = cache->objectsLive;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "slabs")) {
+                *((uint32_t*)retAddr) = cache->numSlabs;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "allocations")) {
+                *((uint32_t*)retAddr) = cache->allocations;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "misses")) {
+                *((uint32_t*)retAddr) = cache->misses;
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "magazinehits")) {
+                *((uint32_t*)retAddr) = KernelHeap::MagazineHits(items[2].index);
+                return true;
+            }
+            else if(String::strcmp(items[3].id, "hitrate")) {
+                // Percentage of allocations that did not need a new slab
+                uint32_t hits = cache->allocations - cache->misses;
+                *((uint32_t*)retAddr) = cache->allocations == 0 ? 0 : (cache->allocations < 0x1000000 ? (hits * 100) / cache->allocations : hits / (cache->allocations / 100));
+                return true;
+            }
             else
                 return false;
         }
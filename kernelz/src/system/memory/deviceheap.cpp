@@ -1,6 +1,7 @@
 #include <system/memory/deviceheap.h>
 #include <system/memory/heap.h>
 #include <system/log.h>
+#include <core/virtualmemory.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -11,6 +12,10 @@ uint32_t DeviceHeap::currentAddress = DEVICE_HEAP_START;
 
 uint32_t DeviceHeap::AllocateChunk(uint32_t size)
 {
+    // Large chunks are aligned to 4MB so they can be mapped using large pages
+    if(size >= LARGE_PAGE_SIZE)
+        DeviceHeap::currentAddress = (DeviceHeap::currentAddress + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+
     uint32_t ret = DeviceHeap::currentAddress;
     DeviceHeap::currentAddress += pageRoundUp(size);
 
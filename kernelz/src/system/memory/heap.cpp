@@ -10,6 +10,9 @@ uint32_t KernelHeap::startAddress = 0;
 uint32_t KernelHeap::endAddress = 0;
 MemoryHeader* KernelHeap::firstHeader = 0;
 MutexLock KernelHeap::heapMutex = MutexLock();
+SlabCache KernelHeap::slabCaches[SLAB_CACHE_COUNT];
+Slab* KernelHeap::slabPages[KERNEL_HEAP_PAGES];
+HeapCPUCache KernelHeap::cpuCaches[HEAP_MAX_CPUS];
 
 void KernelHeap::Initialize(uint32_t start, uint32_t end)
 {
@@ -30,6 +33,12 @@ void KernelHeap::Initialize(uint32_t start, uint32_t end)
     firstHeader->next = 0;
     firstHeader->size = end - start - sizeof(MemoryHeader); // Make this the size of the whole memory range   
     firstHeader->magic = MEMORY_HEADER_MAGIC;
+
+    // Setup the caches for small objects
+    MemoryOperations::memset(slabPages, 0, sizeof(slabPages));
+    MemoryOperations::memset(cpuCaches, 0, sizeof(cpuCaches));
+    for(int i = 0; i < SLAB_CACHE_COUNT; i++)
+        slabCaches[i].Initialize(i + 4); // Starting at 16 bytes
 }
 
 MemoryHeader* KernelHeap::FirstFree(uint32_t size)
@@ -48,9 +57,6 @@ MemoryHeader* KernelHeap::FirstFree(uint32_t size)
 
 void* KernelHeap::InternalAllocate(uint32_t size)
 {
-    // Set Mutex
-    heapMutex.Lock();
-
     // First we align the size to a 4-byte boundary
     // This makes accessing memory a bit faster
     size = align_up(size, sizeof(uint32_t));
@@ -62,7 +68,6 @@ void* KernelHeap::InternalAllocate(uint32_t size)
     if(freeBlock == 0) {
         Log(Error, "KernelHeap: Out of Heap space!. This should never happen!");
         System::Panic();
-        heapMutex.Unlock(); // Not really required but perhaps panic function will return in the future
         return 0;
     }
 
@@ -89,17 +94,11 @@ void* KernelHeap::InternalAllocate(uint32_t size)
 
     freeBlock->allocated = true;
     freeBlock->size = size;
-    
-    // Free mutex
-    heapMutex.Unlock();
 
     return (void*)((uint32_t)freeBlock + sizeof(MemoryHeader));
 }
-void KernelHeap::free(void* ptr)
+void KernelHeap::InternalFree(void* ptr)
 {
-    // Set mutex
-    heapMutex.Lock();
-
     // Get pointer to memory block associated with pointer
     MemoryHeader* block = (MemoryHeader*)((uint32_t)ptr - sizeof(MemoryHeader));
 
@@ -143,6 +142,114 @@ void KernelHeap::free(void* ptr)
         if(block->next != 0)
             block->next->prev = block;
     }
+}
+
+void KernelHeap::SetSlabPages(Slab* slab, Slab* owner)
+{
+    uint32_t firstPage = ((uint32_t)slab - startAddress) / PAGE_SIZE;
+    for(uint32_t i = 0; i < SLAB_SIZE / PAGE_SIZE; i++)
+        slabPages[firstPage + i] = owner;
+}
+
+void* KernelHeap::SmallAllocate(uint32_t size)
+{
+    int index = CacheIndexForSize(size);
+
+    // The magazines of this cpu can only be changed by an other thread when we get interrupted
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    HeapCPUCache* cpu = &cpuCaches[CurrentCPU()];
+    SlabMagazine* magazine = &cpu->magazines[index];
+    if(magazine->count > 0) {
+        cpu->hits[index]++;
+        void* result = magazine->objects[--magazine->count];
+
+        if(interrupts)
+            InterruptDescriptorTable::EnableInterrupts();
+        return result;
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+
+    // Magazine is empty, refill it from the slab cache
+    heapMutex.Lock();
+    interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    // Another thread could have refilled the magazine while we waited for the lock
+    while(magazine->count < MAGAZINE_BATCH) {
+        void* object = slabCaches[index].Allocate();
+        if(object == 0)
+            break;
+        magazine->objects[magazine->count++] = object;
+    }
+    void* result = magazine->count > 0 ? magazine->objects[--magazine->count] : 0;
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    heapMutex.Unlock();
+
+    return result;
+}
+
+void KernelHeap::SmallFree(Slab* slab, void* ptr)
+{
+    int index = CacheIndexForSize(slab->cache->objectSize);
+
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    SlabMagazine* magazine = &cpuCaches[CurrentCPU()].magazines[index];
+    if(magazine->count < MAGAZINE_SIZE) {
+        magazine->objects[magazine->count++] = ptr;
+
+        if(interrupts)
+            InterruptDescriptorTable::EnableInterrupts();
+        return;
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+
+    // Magazine is full, give a batch of objects back to their slabs
+    heapMutex.Lock();
+    interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    while(magazine->count > MAGAZINE_SIZE - MAGAZINE_BATCH) {
+        void* object = magazine->objects[--magazine->count];
+        Slab* owner = slabPages[((uint32_t)object - startAddress) / PAGE_SIZE];
+        owner->cache->Free(owner, object);
+    }
+    magazine->objects[magazine->count++] = ptr;
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    heapMutex.Unlock();
+}
+
+void KernelHeap::free(void* ptr)
+{
+    if(ptr == 0)
+        return;
+
+    // Check if this pointer belongs to a slab
+    // The page can't change owner while the object on it is still allocated, so no lock is needed here
+    Slab* slab = 0;
+    if((uint32_t)ptr >= startAddress && (uint32_t)ptr < endAddress)
+        slab = slabPages[((uint32_t)ptr - startAddress) / PAGE_SIZE];
+
+    if(slab != 0 && slab->magic == SLAB_MAGIC) {
+        SmallFree(slab, ptr);
+        return;
+    }
+
+    // Set mutex
+    heapMutex.Lock();
+
+    InternalFree(ptr);
 
     // Unlock mutex
     heapMutex.Unlock();
@@ -150,11 +257,22 @@ void KernelHeap::free(void* ptr)
 
 void* KernelHeap::malloc(uint32_t size, uint32_t* physReturn)
 {
-    void* addr = InternalAllocate(size);
+    void* addr = 0;
+    if(size <= SLAB_MAX_OBJECT_SIZE)
+        addr = SmallAllocate(size);
+    else {
+        // Set mutex
+        heapMutex.Lock();
+
+        addr = InternalAllocate(size);
+
+        // Unlock mutex
+        heapMutex.Unlock();
+    }
+
     if(physReturn != 0)
     {
-        PageTableEntry* page = VirtualMemoryManager::GetPageForAddress((uint32_t)addr, 0);
-        *physReturn = (page->frame * PAGE_SIZE) + ((uint32_t)addr & 0xFFF);
+        *physReturn = (uint32_t)VirtualMemoryManager::virtualToPhysical(addr);
     }
     return addr;
 }
@@ -228,4 +346,29 @@ uint32_t KernelHeap::UsedMemory()
     }
 
     return result;
+}
+
+SlabCache* KernelHeap::GetSlabCache(int index)
+{
+    if(index < 0 || index >= SLAB_CACHE_COUNT)
+        return 0;
+    
+    return &slabCaches[index];
+}
+
+uint32_t KernelHeap::MagazineHits(int index)
+{
+    if(index < 0 || index >= SLAB_CACHE_COUNT)
+        return 0;
+
+    uint32_t result = 0;
+    for(int i = 0; i < HEAP_MAX_CPUS; i++)
+        result += cpuCaches[i].hits[index];
+    
+    return result;
+}
+
+uint32_t KernelHeap::LockContention()
+{
+    return heapMutex.contended;
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include <system/memory/pagecache.h>
+#include <system/system.h>
+
+using namespace HeisenOs;
+using namespace HeisenOs::common;
+using namespace HeisenOs::core;
+using namespace HeisenOs::system;
+
+CachedPage* PageCache::hashTable[PAGECACHE_HASH_SIZE];
+uint32_t PageCache::cachedPages = 0;
+uint32_t PageCache::sharedPages = 0;
+
+uint32_t PageCache::Hash(uint32_t fileLocation, uint32_t virtAddress)
+{
+    return (fileLocation * 2654435761U + virtAddress / PAGE_SIZE) & (PAGECACHE_HASH_SIZE - 1);
+}
+
+uint32_t PageCache::Acquire(VirtualFileSystem* fs, uint32_t fileLocation, uint32_t virtAddress)
+{
+    //The cache is also used from the page fault handler, so we can not use a lock here
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    uint32_t physAddress = 0;
+    for(CachedPage* page = hashTable[Hash(fileLocation, virtAddress)]; page != 0; page = page->hashNext)
+        if(page->fs == fs && page->fileLocation == fileLocation && page->virtAddress == virtAddress && !page->stale) {
+            page->refCount++;
+            sharedPages++;
+            physAddress = page->physAddress;
+            break;
+        }
+    
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    return physAddress;
+}
+
+void PageCache::Insert(VirtualFileSystem* fs, uint32_t fileLocation, uint32_t virtAddress, uint32_t physAddress)
+{
+    CachedPage* page = new CachedPage();
+    page->fs = fs;
+    page->fileLocation = fileLocation;
+    page->virtAddress = virtAddress;
+    page->physAddress = physAddress;
+    page->refCount = 1;
+    page->stale = false;
+
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    CachedPage** bucket = &hashTable[Hash(fileLocation, virtAddress)];
+    page->hashNext = *bucket;
+    *bucket = page;
+    cachedPages++;
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
+
+void PageCache::Release(uint32_t fileLocation, uint32_t virtAddress, uint32_t physAddress)
+{
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    // The physical address is unique, the filesystem of the process could already be gone
+    CachedPage** link = &hashTable[Hash(fileLocation, virtAddress)];
+    while(*link != 0) {
+        CachedPage* page = *link;
+        if(page->physAddress != physAddress) {
+            link = &page->hashNext;
+            continue;
+        }
+
+        if(--page->refCount > 0)
+            sharedPages--;
+        else {
+            *link = page->hashNext;
+            PhysicalMemoryManager::FreeBlock((void*)page->physAddress);
+            cachedPages--;
+            delete page;
+        }
+        break;
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
+
+void PageCache::Invalidate(VirtualFileSystem* fs)
+{
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    // Pages still in use stay mapped until their processes exit
+    for(int i = 0; i < PAGECACHE_HASH_SIZE; i++)
+        for(CachedPage* page = hashTable[i]; page != 0; page = page->hashNext)
+            if(page->fs == fs)
+                page->stale = true;
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
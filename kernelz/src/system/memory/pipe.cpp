@@ -0,0 +1,175 @@
+#include <system/memory/pipe.h>
+#include <system/system.h>
+
+using namespace HeisenOs;
+using namespace HeisenOs::common;
+using namespace HeisenOs::core;
+using namespace HeisenOs::system;
+
+Pipe::Pipe(int capacity)
+{
+    this->buffer = new char[capacity];
+    this->capacity = capacity;
+    this->count = 0;
+    this->readPos = 0;
+    this->writePos = 0;
+    this->hangup = false;
+}
+
+Pipe::~Pipe()
+{
+    // Writers check if their output still points to this pipe after waking up
+    WakeAll(&this->writers);
+    WakeAll(&this->readers);
+
+    delete this->buffer;
+}
+
+void Pipe::WakeAll(List<Thread*>* waiters)
+{
+    for(Thread* thread : *waiters)
+        System::scheduler->Unblock(thread);
+    
+    waiters->Clear();
+}
+
+void Pipe::RemoveWaiters(Process* proc)
+{
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    for(int i = 0; i < this->readers.size();)
+        if(this->readers[i]->parent == proc)
+            this->readers.Remove(i);
+        else
+            i++;
+    
+    for(int i = 0; i < this->writers.size();)
+        if(this->writers[i]->parent == proc)
+            this->writers.Remove(i);
+        else
+            i++;
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
+
+void Pipe::Hangup()
+{
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    this->hangup = true;
+    WakeAll(&this->readers);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
+
+char Pipe::Read()
+{
+    char result = 0;
+    if(Available() > 0)
+        Read(&result, 1);
+    
+    return result;
+}
+
+void Pipe::Write(char byte)
+{
+    Write(&byte, 1);
+}
+
+int Pipe::Available()
+{
+    return this->count;
+}
+
+int Pipe::Read(char* dest, int length)
+{
+    if(length <= 0)
+        return 0;
+
+    // Checking and blocking needs to happen at once, otherwise a wake-up could be missed
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    while(this->count == 0) {
+        if(this->hangup) {
+            this->hangup = false;
+            if(interrupts)
+                InterruptDescriptorTable::EnableInterrupts();
+            return 0;
+        }
+
+        Thread* thread = System::scheduler->CurrentThread();
+        this->readers.push_back(thread);
+        System::scheduler->Block(thread);
+    }
+
+    if(length > this->count)
+        length = this->count;
+
+    // Copy in at most two parts, the data could wrap around the end of the buffer
+    int first = this->capacity - this->readPos;
+    if(first > length)
+        first = length;
+    
+    MemoryOperations::memcpy(dest, this->buffer + this->readPos, first);
+    MemoryOperations::memcpy(dest + first, this->buffer, length - first);
+
+    this->readPos = (this->readPos + length) % this->capacity;
+    this->count -= length;
+
+    WakeAll(&this->writers);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    
+    return length;
+}
+
+int Pipe::Write(const char* src, int length)
+{
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    int written = 0;
+    while(written < length)
+    {
+        if(this->count == this->capacity) {
+            Process* proc = System::scheduler->CurrentProcess();
+            Thread* thread = System::scheduler->CurrentThread();
+
+            this->writers.push_back(thread);
+            System::scheduler->Block(thread);
+
+            // The reading process is gone and this pipe has been deleted
+            if(proc->stdOutput != this)
+                break;
+            continue;
+        }
+
+        int part = this->capacity - this->count;
+        if(part > length - written)
+            part = length - written;
+        
+        int first = this->capacity - this->writePos;
+        if(first > part)
+            first = part;
+
+        MemoryOperations::memcpy(this->buffer + this->writePos, src + written, first);
+        MemoryOperations::memcpy(this->buffer, src + written + first, part - first);
+
+        this->writePos = (this->writePos + part) % this->capacity;
+        this->count += part;
+        written += part;
+
+        WakeAll(&this->readers);
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+
+    return written;
+}
@@ -16,50 +16,26 @@ bool SharedMemory::CreateSharedRegion(Process* proc1, Process* proc2, uint32_t v
     if(proc1 == 0 || proc2 == 0 || len <= 0)
         return false;
 
-    //Since we are messing with pagetables we need to disable the scheduler
-    System::scheduler->Enabled = false;
-
     //Allocate the required memory block
-    uint32_t physMemStart = (uint32_t)PhysicalMemoryManager::AllocateBlocks(len / PAGE_SIZE);
-    Log(Info, "Allocated shared memory block of %d bytes at %x", len, physMemStart);
-
-    uint32_t oldCR3 = VirtualMemoryManager::GetPageDirectoryAddress();
-    //Check if we are running proc1 already, so we don't have to switch the pagedir
-    if(oldCR3 != proc1->pageDirPhys) {
-        VirtualMemoryManager::SwitchPageDirectory(proc1->pageDirPhys);
+    uint32_t pages = pageRoundUp(len) / PAGE_SIZE;
+    uint32_t physMemStart = (uint32_t)PhysicalMemoryManager::AllocateBlocks(pages);
+    if(physMemStart == 0) {
+        Log(Error, "Could not allocate shared memory block of %d bytes", len);
+        return false;
     }
-    
-    //Map the memory region for process 1
-    for(uint32_t memAddr = 0; memAddr < len; memAddr += PAGE_SIZE)
-    {
-        //Get or create page for address
-        PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(memAddr + virtStart1, true, true, true);
+    Log(Info, "Allocated shared memory block of %d bytes at %x", len, physMemStart);
 
-        page->frame = (physMemStart + memAddr) / PAGE_SIZE; //Assign the correct memory address
-        page->readWrite = 1;
-        page->isUser = 1;
-        page->present = 1;
+    //Map the memory region for both processes, their page directories are edited without switching to them
+    //MapRange removes its own pages when it fails, so only the mapping of proc1 needs to be undone
+    if(!VirtualMemoryManager::MapRange(virtStart1, physMemStart, pages, VMM_WRITEABLE | VMM_USER, proc1->pageDirPhys)) {
+        PhysicalMemoryManager::FreeBlocks((void*)physMemStart, pages);
+        return false;
     }
-
-    //Switch to process 2 pagedir
-    VirtualMemoryManager::SwitchPageDirectory(proc2->pageDirPhys);
-
-    //Map the memory region for process 2
-    for(uint32_t memAddr = 0; memAddr < len; memAddr += PAGE_SIZE)
-    {
-        //Get or create page for address
-        PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(memAddr + virtStart2, true, true, true);
-
-        page->frame = (physMemStart + memAddr) / PAGE_SIZE; //Assign the correct memory address
-        page->readWrite = 1;
-        page->isUser = 1;
-        page->present = 1;
+    if(!VirtualMemoryManager::MapRange(virtStart2, physMemStart, pages, VMM_WRITEABLE | VMM_USER, proc2->pageDirPhys)) {
+        VirtualMemoryManager::UnmapRange(virtStart1, pages, false, proc1->pageDirPhys);
+        PhysicalMemoryManager::FreeBlocks((void*)physMemStart, pages);
+        return false;
     }
-
-    //Restore page directory
-    VirtualMemoryManager::SwitchPageDirectory(oldCR3);
-
-    System::scheduler->Enabled = true;
     
     return true;
 }
@@ -74,40 +50,10 @@ bool SharedMemory::RemoveSharedRegion(Process* proc1, Process* proc2, uint32_t v
 
     Log(Info, "Removing shared memory between %s and %s from %x and %x with length %d", proc1->fileName, proc2->fileName, virtStart1, virtStart2, len);
 
-    //Since we are messing with pagetables we need to disable the scheduler
-    System::scheduler->Enabled = false;
-
-    uint32_t oldCR3 = VirtualMemoryManager::GetPageDirectoryAddress();
-    //Check if we are running proc1 already, so we don't have to switch the pagedir
-    if(oldCR3 != proc1->pageDirPhys) {
-        VirtualMemoryManager::SwitchPageDirectory(proc1->pageDirPhys);
-    }
-    
-    //Map the memory region for process 1
-    for(uint32_t memAddr = 0; memAddr < len; memAddr += PAGE_SIZE)
-    {
-        //Get or create page for address
-        PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(memAddr + virtStart1, false);
-        if(page != 0)
-            VirtualMemoryManager::FreePage(page);
-    }
-
-    //Switch to process 2 pagedir
-    VirtualMemoryManager::SwitchPageDirectory(proc2->pageDirPhys);
-
-    //Map the memory region for process 2
-    for(uint32_t memAddr = 0; memAddr < len; memAddr += PAGE_SIZE)
-    {
-        //Get or create page for address
-        PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(memAddr + virtStart2, false);
-        if(page != 0)
-            VirtualMemoryManager::FreePage(page);
-    }
-
-    //Restore page directory
-    VirtualMemoryManager::SwitchPageDirectory(oldCR3);
-
-    System::scheduler->Enabled = true;
+    //Both processes map the same physical memory, so it is only freed once
+    uint32_t pages = pageRoundUp(len) / PAGE_SIZE;
+    VirtualMemoryManager::UnmapRange(virtStart1, pages, true, proc1->pageDirPhys);
+    VirtualMemoryManager::UnmapRange(virtStart2, pages, false, proc2->pageDirPhys);
     
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,146 @@
+#include <system/memory/slab.h>
+#include <system/memory/heap.h>
+#include <system/system.h>
+
+using namespace HeisenOs;
+using namespace HeisenOs::common;
+using namespace HeisenOs::core;
+using namespace HeisenOs::system;
+
+void SlabCache::Initialize(uint32_t objectShift)
+{
+    this->partialSlabs = 0;
+    this->fullSlabs = 0;
+    this->objectShift = objectShift;
+    this->objectSize = 1 << objectShift;
+
+    this->numSlabs = 0;
+    this->emptySlabs = 0;
+    this->objectsLive = 0;
+    this->allocations = 0;
+    this->misses = 0;
+}
+
+void SlabCache::AddToList(Slab** list, Slab* slab)
+{
+    slab->prev = 0;
+    slab->next = *list;
+    if(*list)
+        (*list)->prev = slab;
+    *list = slab;
+}
+
+void SlabCache::RemoveFromList(Slab** list, Slab* slab)
+{
+    if(slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+    
+    if(slab->next)
+        slab->next->prev = slab->prev;
+}
+
+Slab* SlabCache::CreateSlab()
+{
+    // Allocate a extra page so that we can align the slab on a page boundary
+    void* block = KernelHeap::InternalAllocate(SLAB_SIZE + PAGE_SIZE);
+    if(block == 0)
+        return 0;
+
+    Slab* slab = (Slab*)align_up((uint32_t)block, PAGE_SIZE);
+    slab->magic = SLAB_MAGIC;
+    slab->cache = this;
+    slab->block = block;
+
+    // Objects are aligned on their own size, this way they never cross a page boundary
+    slab->firstObject = align_up((uint32_t)slab + sizeof(Slab), this->objectSize);
+    slab->numObjects = ((uint32_t)slab + SLAB_SIZE - slab->firstObject) >> this->objectShift;
+    slab->usedObjects = 0;
+    slab->freeHint = 0;
+
+    MemoryOperations::memset(slab->freeMap, 0, sizeof(slab->freeMap));
+    for(uint32_t i = 0; i < slab->numObjects; i++)
+        slab->freeMap[i / 32] |= (1 << (i % 32));
+
+    KernelHeap::SetSlabPages(slab, slab);
+    AddToList(&this->partialSlabs, slab);
+    
+    this->numSlabs++;
+    this->emptySlabs++;
+    return slab;
+}
+
+void SlabCache::DestroySlab(Slab* slab)
+{
+    RemoveFromList(&this->partialSlabs, slab);
+    KernelHeap::SetSlabPages(slab, 0);
+
+    slab->magic = 0;
+    KernelHeap::InternalFree(slab->block);
+
+    this->numSlabs--;
+}
+
+void* SlabCache::Allocate()
+{
+    this->allocations++;
+
+    Slab* slab = this->partialSlabs;
+    if(slab == 0) {
+        this->misses++;
+        if((slab = CreateSlab()) == 0)
+            return 0;
+    }
+
+    if(slab->usedObjects == 0)
+        this->emptySlabs--;
+
+    // There is at least one free object, so this loop ends within one round of the bitmap
+    uint32_t words = (slab->numObjects + 31) / 32;
+    uint32_t word = slab->freeHint;
+    while(slab->freeMap[word] == 0)
+        word = (word + 1) % words;
+    
+    uint32_t bit = __builtin_ctz(slab->freeMap[word]);
+    slab->freeMap[word] &= ~(1 << bit);
+    slab->freeHint = word;
+    slab->usedObjects++;
+    this->objectsLive++;
+
+    if(slab->usedObjects == slab->numObjects) {
+        RemoveFromList(&this->partialSlabs, slab);
+        AddToList(&this->fullSlabs, slab);
+    }
+
+    return (void*)(slab->firstObject + ((word * 32 + bit) << this->objectShift));
+}
+
+void SlabCache::Free(Slab* slab, void* ptr)
+{
+    uint32_t offset = (uint32_t)ptr - slab->firstObject;
+    uint32_t index = offset >> this->objectShift;
+
+    // Check if this is a object that we handed out
+    if((uint32_t)ptr < slab->firstObject || (offset & (this->objectSize - 1)) != 0 || index >= slab->numObjects || (slab->freeMap[index / 32] & (1 << (index % 32)))) {
+        Log(Error, "SlabCache: Object is not allocated or not part of this slab");
+        System::Panic();
+    }
+
+    if(slab->usedObjects == slab->numObjects) {
+        RemoveFromList(&this->fullSlabs, slab);
+        AddToList(&this->partialSlabs, slab);
+    }
+
+    slab->freeMap[index / 32] |= (1 << (index % 32));
+    slab->usedObjects--;
+    this->objectsLive--;
+
+    // Keep one empty slab around so that a alloc/free pattern does not create and destroy slabs all the time
+    if(slab->usedObjects == 0) {
+        if(this->emptySlabs > 0)
+            DestroySlab(slab);
+        else
+            this->emptySlabs++;
+    }
+}
@@ -1,5 +1,6 @@
 #include <system/memory/stream.h>
 #include <system/log.h>
+#include <system/system.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -23,4 +24,36 @@ int Stream::Available()
 {
     Log(Error, "Virtual stream function called");
     return 0;
-}
\ No newline at end of file
+}
+
+// Default implementations for streams that only work per byte
+// These streams have no way to wake us up, so we yield until data arrives
+int Stream::Read(char* buffer, int length)
+{
+    while(Available() <= 0)
+        System::scheduler->ForceSwitch();
+    
+    int count = 0;
+    while(count < length && Available() > 0)
+        buffer[count++] = Read();
+
+    return count;
+}
+
+int Stream::Write(const char* buffer, int length)
+{
+    for(int i = 0; i < length; i++)
+        Write(buffer[i]);
+    
+    return length;
+}
+
+void Stream::RemoveWaiters(Process* proc)
+{
+    // Byte streams don't keep track of waiting threads
+}
+
+void Stream::Hangup()
+{
+    // Readers of byte streams don't wait for a writer
+}
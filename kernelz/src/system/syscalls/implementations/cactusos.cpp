@@ -2,6 +2,7 @@
 
 #include <../../lib/include/syscall.h>
 #include <../../lib/include/datetime.h>
+#include <../../lib/include/listing.h>
 
 #include <system/system.h>
 #include <system/tasking/ipcmanager.h>
@@ -9,6 +10,7 @@
 #include <core/power.h>
 #include <system/listings/listingcontroller.h>
 #include <system/listings/systeminfo.h>
+#include <system/memory/pipe.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -18,11 +20,137 @@ using namespace HeisenOs::system;
 MutexLock stdOutStream;
 extern PowerRequest powerRequestState; //Defined in kernel.cpp
 
+// Is this memory the process is allowed to map things at?
+static bool UserRange(Process* proc, uint32_t address, uint32_t length)
+{
+    return !proc->isUserspace || (address < KERNEL_VIRT_ADDR && length <= KERNEL_VIRT_ADDR - address);
+}
+
+// Load the user memory a system call is going to use before it takes any locks
+// Page faults from kernel code can not read the excecutable, so this also needs to happen for pages that are not loaded yet
+// Every system call needs a case here, unknown ones are refused
+static bool PrepareArguments(Process* proc, CPUState* state)
+{
+    switch (state->EAX)
+    {
+        case LIBHeisenKernel::SYSCALL_LOG:
+            return ProcessHelper::PrepareUserString(proc, (char*)state->ECX);
+        case LIBHeisenKernel::SYSCALL_PRINT:
+        case LIBHeisenKernel::SYSCALL_FILE_EXISTS:
+        case LIBHeisenKernel::SYSCALL_DIR_EXISTS:
+        case LIBHeisenKernel::SYSCALL_GET_FILESIZE:
+        case LIBHeisenKernel::SYSCALL_CREATE_FILE:
+        case LIBHeisenKernel::SYSCALL_CREATE_DIRECTORY:
+        case LIBHeisenKernel::SYSCALL_EJECT_DISK:
+        case LIBHeisenKernel::SYSCALL_OPEN_FILE:
+        case LIBHeisenKernel::SYSCALL_RUN_PROC:
+            return ProcessHelper::PrepareUserString(proc, (char*)state->EBX);
+        case LIBHeisenKernel::SYSCALL_READ_FILE:
+            {
+                if(!ProcessHelper::PrepareUserString(proc, (char*)state->EBX))
+                    return false;
+                
+                // Only the part of the buffer that is filled, the length can be -1 to read until the end
+                uint32_t size = System::vfs->GetFileSize((char*)state->EBX);
+                if(size == (uint32_t)-1 || state->EDX >= size)
+                    return true;
+                return ProcessHelper::PrepareUserBuffer(proc, state->ECX, state->ESI < size - state->EDX ? state->ESI : size - state->EDX, true);
+            }
+        case LIBHeisenKernel::SYSCALL_WRITE_FILE:
+            return ProcessHelper::PrepareUserString(proc, (char*)state->EBX) && ProcessHelper::PrepareUserBuffer(proc, state->ECX, state->EDX, false);
+        case LIBHeisenKernel::SYSCALL_READ_OPEN_FILE:
+            {
+                int fd = (int)state->EBX;
+                if(fd < 0 || fd >= PROC_MAX_OPEN_FILES || proc->openFiles[fd] == 0)
+                    return true;
+                
+                VFSOpenFile* file = proc->openFiles[fd];
+                uint32_t offset = state->ESI == (uint32_t)-1 ? file->position : state->ESI;
+                if(offset >= file->node.size)
+                    return true;
+                return ProcessHelper::PrepareUserBuffer(proc, state->ECX, state->EDX < file->node.size - offset ? state->EDX : file->node.size - offset, true);
+            }
+        case LIBHeisenKernel::SYSCALL_GUI_GETLFB:
+            return System::gfxDevice == 0 || UserRange(proc, state->EBX, pageRoundUp(System::gfxDevice->GetBufferSize()));
+        case LIBHeisenKernel::SYSCALL_GET_SCREEN_PROPERTIES:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(int), true) && ProcessHelper::PrepareUserBuffer(proc, state->ECX, sizeof(int), true);
+        case LIBHeisenKernel::SYSCALL_CREATE_SHARED_MEM:
+        case LIBHeisenKernel::SYSCALL_REMOVE_SHARED_MEM:
+            return UserRange(proc, state->ECX, state->ESI) && UserRange(proc, state->EDX, state->ESI);
+        case LIBHeisenKernel::SYSCALL_MAP_SYSINFO:
+            return UserRange(proc, state->EBX, PAGE_SIZE);
+        case LIBHeisenKernel::SYSCALL_GET_ARGUMENTS:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, PROC_ARG_LEN_MAX, true);
+        case LIBHeisenKernel::SYSCALL_IPC_SEND:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(LIBHeisenKernel::IPCMessage), false);
+        case LIBHeisenKernel::SYSCALL_IPC_RECEIVE:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(LIBHeisenKernel::IPCMessage), true) && (state->EDX == 0 || ProcessHelper::PrepareUserBuffer(proc, state->EDX, sizeof(int), true));
+        case LIBHeisenKernel::SYSCALL_FUTEX_WAIT:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(uint32_t), false);
+        case LIBHeisenKernel::SYSCALL_GET_TICKS:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(uint64_t), true);
+        case LIBHeisenKernel::SYSCALL_GET_DATETIME:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, sizeof(LIBHeisenKernel::DateTime), true);
+        case LIBHeisenKernel::SYSCALL_READ_STDIO:
+            return state->EBX == 0 || ProcessHelper::PrepareUserBuffer(proc, state->EBX, state->ECX, true);
+        case LIBHeisenKernel::SYSCALL_WRITE_STDIO:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EBX, state->ECX, false);
+        case LIBHeisenKernel::SYSCALL_BEGIN_LISTING:
+            return state->EBX != DIRECTORY_LISTING || ProcessHelper::PrepareUserString(proc, (char*)state->ECX);
+        case LIBHeisenKernel::SYSCALL_LISTING_ENTRY:
+            return ProcessHelper::PrepareUserBuffer(proc, state->EDX, sizeof(LIBHeisenKernel::VFSEntry), true);
+        case LIBHeisenKernel::SYSCALL_GET_SYSINFO_VALUE:
+            {
+                // The path to the property, the identifiers are usually string literals
+                int count = (int)state->EDX;
+                LIBHeisenKernel::SIPropertyProvider* items = (LIBHeisenKernel::SIPropertyProvider*)state->EBX;
+                if(count <= 0 || !ProcessHelper::PrepareUserBuffer(proc, state->EBX, count * sizeof(LIBHeisenKernel::SIPropertyProvider), false))
+                    return false;
+                for(int i = 0; i < count; i++)
+                    if(items[i].type == LIBHeisenKernel::SIPropertyIdentifier::String && items[i].id && !ProcessHelper::PrepareUserString(proc, items[i].id))
+                        return false;
+                
+                // Values are at most 8 bytes, strings are returned in a buffer on the heap which is never loaded on demand
+                return ProcessHelper::PrepareUserBuffer(proc, state->ECX, sizeof(uint64_t), true);
+            }
+        
+        // These don't use any memory of the process
+        case LIBHeisenKernel::SYSCALL_EXIT:
+        case LIBHeisenKernel::SYSCALL_SEEK_FILE:
+        case LIBHeisenKernel::SYSCALL_CLOSE_FILE:
+        case LIBHeisenKernel::SYSCALL_GET_HEAP_START:
+        case LIBHeisenKernel::SYSCALL_GET_HEAP_END:
+        case LIBHeisenKernel::SYSCALL_SET_HEAP_SIZE:
+        case LIBHeisenKernel::SYSCALL_SLEEP_MS:
+        case LIBHeisenKernel::SYSCALL_START_THREAD:
+        case LIBHeisenKernel::SYSCALL_YIELD:
+        case LIBHeisenKernel::SYSCALL_PROC_EXIST:
+        case LIBHeisenKernel::SYSCALL_UNBLOCK:
+        case LIBHeisenKernel::SYSCALL_SET_SCHEDULER:
+        case LIBHeisenKernel::SYSCALL_IPC_AVAILABLE:
+        case LIBHeisenKernel::SYSCALL_FUTEX_WAKE:
+        case LIBHeisenKernel::SYSCALL_SHUTDOWN:
+        case LIBHeisenKernel::SYSCALL_REBOOT:
+        case LIBHeisenKernel::SYSCALL_REDIRECT_STDIO:
+        case LIBHeisenKernel::SYSCALL_STDIO_AVAILABLE:
+        case LIBHeisenKernel::SYSCALL_END_LISTING:
+            return true;
+        default:
+            return false;
+    }
+}
+
 CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
 {
     LIBHeisenKernel::Systemcalls sysCall = (LIBHeisenKernel::Systemcalls)state->EAX;
     Process* proc = System::scheduler->CurrentProcess();
 
+    if(!PrepareArguments(proc, state)) {
+        Log(Warning, "Process %d passed invalid memory to syscall %d, or the syscall is unknown", proc->id, sysCall);
+        state->EAX = SYSCALL_RET_ERROR;
+        return state;
+    }
+
     switch (sysCall)
     {
         case LIBHeisenKernel::SYSCALL_EXIT:
@@ -57,7 +185,7 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
             state->EAX = System::vfs->GetFileSize((char*)state->EBX);
             break;
         case LIBHeisenKernel::SYSCALL_READ_FILE:
-            state->EAX = System::vfs->ReadFile((char*)state->EBX, (uint8_t*)state->ECX);
+            state->EAX = System::vfs->ReadFile((char*)state->EBX, (uint8_t*)state->ECX, state->EDX, state->ESI);
             break;
         case LIBHeisenKernel::SYSCALL_WRITE_FILE:
             state->EAX = System::vfs->WriteFile((char*)state->EBX, (uint8_t*)state->ECX, state->EDX, (bool)state->ESI);
@@ -71,13 +199,70 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
         case LIBHeisenKernel::SYSCALL_EJECT_DISK:
             state->EAX = System::vfs->EjectDrive((char*)state->EBX);
             break;
+        case LIBHeisenKernel::SYSCALL_OPEN_FILE:
+            {
+                state->EAX = -1;
+                for(int fd = 0; fd < PROC_MAX_OPEN_FILES; fd++)
+                    if(proc->openFiles[fd] == 0) {
+                        proc->openFiles[fd] = System::vfs->OpenFile((char*)state->EBX);
+                        if(proc->openFiles[fd] != 0)
+                            state->EAX = fd;
+                        break;
+                    }
+            }
+            break;
+        case LIBHeisenKernel::SYSCALL_READ_OPEN_FILE:
+            {
+                int fd = (int)state->EBX;
+                if(fd < 0 || fd >= PROC_MAX_OPEN_FILES || proc->openFiles[fd] == 0) {
+                    state->EAX = -1;
+                    break;
+                }
+                state->EAX = System::vfs->ReadOpenFile(proc->openFiles[fd], (uint8_t*)state->ECX, state->EDX, state->ESI);
+            }
+            break;
+        case LIBHeisenKernel::SYSCALL_SEEK_FILE:
+            {
+                int fd = (int)state->EBX;
+                if(fd < 0 || fd >= PROC_MAX_OPEN_FILES || proc->openFiles[fd] == 0) {
+                    state->EAX = -1;
+                    break;
+                }
+                VFSOpenFile* file = proc->openFiles[fd];
+                int position = (int)state->ECX;
+                if(state->EDX == VFS_SEEK_CUR)
+                    position += file->position;
+                else if(state->EDX == VFS_SEEK_END)
+                    position += file->node.size;
+                
+                if(position < 0) {
+                    state->EAX = -1;
+                    break;
+                }
+                file->position = position;
+                state->EAX = position;
+            }
+            break;
+        case LIBHeisenKernel::SYSCALL_CLOSE_FILE:
+            {
+                int fd = (int)state->EBX;
+                if(fd < 0 || fd >= PROC_MAX_OPEN_FILES || proc->openFiles[fd] == 0) {
+                    state->EAX = SYSCALL_RET_ERROR;
+                    break;
+                }
+                System::vfs->CloseFile(proc->openFiles[fd]);
+                proc->openFiles[fd] = 0;
+                state->EAX = SYSCALL_RET_SUCCES;
+            }
+            break;
 
         //////////////
         // GUI
         //////////////
         
         case LIBHeisenKernel::SYSCALL_GUI_GETLFB:
-            VirtualMemoryManager::mapVirtualToPhysical((void*)System::gfxDevice->framebufferPhys, (void*)state->EBX, pageRoundUp(System::gfxDevice->GetBufferSize()), false, true);
+            // Large pages keep the amount of TLB entries needed for a full screen copy low
+            VirtualMemoryManager::MapRange(state->EBX, System::gfxDevice->framebufferPhys, pageRoundUp(System::gfxDevice->GetBufferSize()) / PAGE_SIZE, VMM_WRITEABLE | VMM_USER | VMM_LARGE_PAGES | VMM_WRITE_COMBINING);
             state->EAX = SYSCALL_RET_SUCCES;
             Log(Info, "Mapped LFB for process %d to virtual address %x", proc->id, state->EBX);
             break;
@@ -105,8 +290,7 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
             state->EAX = proc->heap.heapEnd;
             break;
         case LIBHeisenKernel::SYSCALL_SET_HEAP_SIZE:
-            ProcessHelper::UpdateHeap(proc, state->EBX);
-            state->EAX = SYSCALL_RET_SUCCES;
+            state->EAX = ProcessHelper::UpdateHeap(proc, state->EBX) ? SYSCALL_RET_SUCCES : SYSCALL_RET_ERROR;
             break;
         case LIBHeisenKernel::SYSCALL_CREATE_SHARED_MEM:
             {
@@ -186,8 +370,7 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
                 Thread* newThread = ThreadHelper::CreateFromFunction((void (*)())state->EBX, false, 514, proc);
                 
                 //Create memory for stack
-                for(uint32_t i = (uint32_t)newThread->userStack; i < ((uint32_t)newThread->userStack + newThread->userStackSize); i+=PAGE_SIZE)
-                    VirtualMemoryManager::AllocatePage(VirtualMemoryManager::GetPageForAddress(i, true, true, true), false, true);
+                VirtualMemoryManager::MapRange((uint32_t)newThread->userStack, 0, newThread->userStackSize / PAGE_SIZE, VMM_ALLOCATE | VMM_WRITEABLE | VMM_USER);
 
                 //Assign parent
                 newThread->parent = proc;
@@ -217,12 +400,31 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
         case LIBHeisenKernel::SYSCALL_UNBLOCK:
             {
                 Process* proc = ProcessHelper::ProcessById(state->EBX);
-                if(proc != 0 && (int)state->ECX < proc->Threads.size())
+                if(proc != 0 && (int)state->ECX < proc->Threads.size()) {
                     proc->Threads[state->ECX]->state = Started;
+                    System::scheduler->Unblock(proc->Threads[state->ECX]);
+                }
             }
             break;
         case LIBHeisenKernel::SYSCALL_SET_SCHEDULER:
             {
+                if(state->EBX == SCHEDULER_SET_PRIORITY) {
+                    // A pid of -1 means the current thread, processes can only change their own threads
+                    Thread* thread = 0;
+                    if((int)state->ECX == -1)
+                        thread = System::scheduler->CurrentThread();
+                    else if((int)state->ECX == proc->id && (int)state->EDX < proc->Threads.size())
+                        thread = proc->Threads[state->EDX];
+
+                    if(thread == 0) {
+                        state->EAX = SYSCALL_RET_ERROR;
+                        break;
+                    }
+                    System::scheduler->SetPriority(thread, state->ESI);
+                    state->EAX = SYSCALL_RET_SUCCES;
+                    break;
+                }
+
                 bool active = (bool)state->EBX;
                 System::scheduler->Enabled = active;
             }
@@ -251,6 +453,12 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
         case LIBHeisenKernel::SYSCALL_IPC_AVAILABLE:
             state->EAX = proc->ipcMessages.size();
             break;
+        case LIBHeisenKernel::SYSCALL_FUTEX_WAIT:
+            state->EAX = IPCManager::FutexWait(proc, state->EBX, state->ECX);
+            break;
+        case LIBHeisenKernel::SYSCALL_FUTEX_WAKE:
+            state->EAX = IPCManager::FutexWake(proc, state->EBX, (int)state->ECX);
+            break;
 
         //////////////
         // Clock
@@ -300,9 +508,14 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
         case LIBHeisenKernel::SYSCALL_READ_STDIO:
             if(proc->stdInput != 0)
             {
-                while (proc->stdInput->Available() <= 0) //TODO: Use blocking here
-                    System::scheduler->ForceSwitch();
-                state->EAX = proc->stdInput->Read();
+                char* buffer = (char*)state->EBX;
+                if(buffer == 0) { // Single byte request
+                    char byte = 0;
+                    proc->stdInput->Read(&byte, 1);
+                    state->EAX = byte;
+                }
+                else
+                    state->EAX = proc->stdInput->Read(buffer, state->ECX);
             }
             else
                 Log(Warning, "StdIn is zero for process %s", proc->fileName);
@@ -318,8 +531,7 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
                 if(proc->stdOutput == System::ProcStandardOut)
                     stdOutStream.Lock();
 
-                for(uint32_t d = 0; d < state->ECX; d++)
-                    proc->stdOutput->Write(data[d]);
+                state->EAX = proc->stdOutput->Write(data, state->ECX);
 
                 //Don't forget to unlock
                 if(proc->stdOutput == System::ProcStandardOut)
@@ -351,7 +563,7 @@ CPUState* CactusOSSyscalls::HandleSyscall(CPUState* state)
                 Log(Info, "Redirecting StdOut from %s to StdIn of %s", fromProc->fileName, toProc->fileName);
 
                 if(toProc->stdInput == System::keyboardManager || toProc->stdInput == 0)
-                    toProc->stdInput = new FIFOStream();
+                    toProc->stdInput = new Pipe();
                 
                 fromProc->stdOutput = toProc->stdInput;
             }
@@ -39,6 +39,83 @@ bool System::isBochs = false; //are we running inside bochs
 #endif
 System::SYSTEM_STATS System::statistics = {};
 
+#if ENABLE_BOOT_BENCHMARKS
+// Print the memcpy speed for small, medium and large blocks
+static void BenchmarkMemoryOperations()
+{
+    const uint32_t sizes[] = { 64, 4_KB, 4_MB };
+    const uint32_t total = 256_MB; // Bytes copied for every block size
+
+    // The first 4MB of physical memory is always mapped at 3GB, use it as source
+    uint8_t* src = (uint8_t*)KERNEL_VIRT_ADDR;
+    uint8_t* dst = new uint8_t[4_MB];
+
+    for(uint32_t size : sizes)
+    {
+        uint64_t start = System::pit->Ticks();
+        for(uint32_t copied = 0; copied < total; copied += size)
+            MemoryOperations::memcpy(dst, src, size);
+        uint32_t ms = (uint32_t)(System::pit->Ticks() - start);
+        if(ms == 0)
+            ms = 1;
+
+        Log(Info, "Memcpy Benchmark: %d byte blocks, %d MB in %d ms, %d MB/s", size, total / 1_MB, ms, (total / 1_MB) * 1000 / ms);
+    }
+
+    delete dst;
+}
+
+// Map a framebuffer sized region page by page and with MapRange, in the current and in another address space
+static void BenchmarkPageMapping()
+{
+    const uint32_t pages = 16_MB / PAGE_SIZE;
+    const uint32_t rounds = 64;
+    const uint32_t virtAddress = 1_GB; // Nothing is mapped here during boot
+
+    // The pages are never accessed, so any physical address will do
+    uint32_t physAddress = System::gfxDevice != 0 ? System::gfxDevice->framebufferPhys : 0;
+
+    uint64_t start = System::pit->Ticks();
+    for(uint32_t i = 0; i < rounds; i++) {
+        VirtualMemoryManager::mapVirtualToPhysical((void*)physAddress, (void*)virtAddress, pages * PAGE_SIZE, true, true);
+        VirtualMemoryManager::UnmapRange(virtAddress, pages, false);
+    }
+    uint32_t perPageMs = (uint32_t)(System::pit->Ticks() - start);
+
+    start = System::pit->Ticks();
+    for(uint32_t i = 0; i < rounds; i++) {
+        VirtualMemoryManager::MapRange(virtAddress, physAddress, pages, VMM_WRITEABLE);
+        VirtualMemoryManager::UnmapRange(virtAddress, pages, false);
+    }
+    uint32_t rangeMs = (uint32_t)(System::pit->Ticks() - start);
+
+    uint32_t pageDirPhys = 0;
+    PageDirectory* pageDir = (PageDirectory*)KernelHeap::alignedMalloc(sizeof(PageDirectory), sizeof(PageDirectory), &pageDirPhys);
+    MemoryOperations::memset(pageDir, 0, sizeof(PageDirectory));
+
+    start = System::pit->Ticks();
+    for(uint32_t i = 0; i < rounds; i++) {
+        VirtualMemoryManager::MapRange(virtAddress, physAddress, pages, VMM_WRITEABLE, pageDirPhys);
+        VirtualMemoryManager::UnmapRange(virtAddress, pages, false, pageDirPhys);
+    }
+    uint32_t otherMs = (uint32_t)(System::pit->Ticks() - start);
+
+    // Free the page tables created by the benchmark
+    PageDirectory* currentDir = (PageDirectory*)PAGE_DIRECTORY_ADDRESS;
+    for(uint32_t i = PAGEDIR_INDEX(virtAddress); i <= PAGEDIR_INDEX(virtAddress + pages * PAGE_SIZE - 1); i++) {
+        if(pageDir->entries[i].present)
+            PhysicalMemoryManager::FreeBlock((void*)(pageDir->entries[i].frame * PAGE_SIZE));
+        if(currentDir->entries[i].present)
+            PhysicalMemoryManager::FreeBlock((void*)(currentDir->entries[i].frame * PAGE_SIZE));
+        MemoryOperations::memset(&currentDir->entries[i], 0, sizeof(PageDirectoryEntry));
+    }
+    VirtualMemoryManager::ReloadCR3();
+    KernelHeap::allignedFree(pageDir);
+
+    Log(Info, "Mapping Benchmark: 16 MB %d times, per page %d ms, MapRange %d ms, other address space %d ms", rounds, perPageMs, rangeMs, otherMs);
+}
+#endif
+
 void System::Start()
 {
     BootConsole::ForegroundColor = VGA_COLOR_BLACK;
@@ -51,6 +128,9 @@ void System::Start()
     System::pit = new PIT();
     InterruptDescriptorTable::EnableInterrupts();
     Log(Info, "- PIT [Done]     (%x)", (uint32_t)System::pit);
+#if ENABLE_BOOT_BENCHMARKS
+    BenchmarkMemoryOperations();
+#endif
 
     System::dma = new DMAController();
     Log(Info, "- DMA [Done]     (%x)", (uint32_t)System::dma);
@@ -65,6 +145,9 @@ void System::Start()
     // The graphics component is added here but not used right away, we don't need to be in video mode so early.
     System::gfxDevice = GraphicsDevice::GetBestDevice();
     Log(Info, "- GFX [Done]     (%x)", (uint32_t)System::gfxDevice);
+#if ENABLE_BOOT_BENCHMARKS
+    BenchmarkPageMapping();
+#endif
 
     // Check for monitor EDID
     System::edid = new EDID();
@@ -83,6 +166,7 @@ void System::Start()
     System::driverManager = new DriverManager();
 
     Log(Info, "Starting Disk Manager");
+    BlockCache::Initialize();
     System::diskManager = new DiskManager();
 
     Log(Info, "Starting Keyboard Manager");
@@ -133,6 +217,10 @@ void System::Start()
     else
         BootConsole::WriteLine(" [Not found]");
 
+#if ENABLE_BOOT_BENCHMARKS
+    System::vfs->Benchmark();
+#endif
+
     Log(Info, "Starting Debugger");
     System::kernelDebugger = new SymbolDebugger("B:\\debug.sym", true);
 
@@ -141,6 +229,9 @@ void System::Start()
 
     Log(Info, "Preparing IPC");
     IPCManager::Initialize();
+#if ENABLE_BOOT_BENCHMARKS
+    IPCManager::Benchmark();
+#endif
 
     Log(Info, "Adding default listing handlers");
     System::listings = new List<ListingController*>();
@@ -7,10 +7,91 @@ using namespace HeisenOs::common;
 using namespace HeisenOs::core;
 using namespace HeisenOs::system;
 
-List<IPCReceiveDescriptor>* receivingBlockedList;
+List<FutexWaiter>* futexWaiters;
 void IPCManager::Initialize()
 {
-    receivingBlockedList = new List<IPCReceiveDescriptor>();
+    futexWaiters = new List<FutexWaiter>();
+}
+
+// Get the physical address of a word in userspace, returns 0 when it is not mapped
+static uint32_t FutexAddress(uint32_t address)
+{
+    if(address >= KERNEL_VIRT_ADDR || (address & 3))
+        return 0;
+
+    PageTableEntry* page = VirtualMemoryManager::GetPageForAddress(address, false);
+    if(page == 0 || !page->present || !page->isUser)
+        return 0;
+    
+    return page->frame * PAGE_SIZE + (address & (PAGE_SIZE - 1));
+}
+
+int IPCManager::FutexWait(Process* proc, uint32_t address, uint32_t expected)
+{
+    uint32_t phys = FutexAddress(address);
+    if(phys == 0)
+        return SYSCALL_RET_ERROR;
+    
+    //Comparing and blocking can not be interrupted, or a wake could get lost
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    //Value has already been changed, no need to wait
+    if(*(volatile uint32_t*)address != expected) {
+        if(interrupts)
+            InterruptDescriptorTable::EnableInterrupts();
+        return SYSCALL_RET_SUCCES;
+    }
+
+    FutexWaiter waiter;
+    waiter.physAddress = phys;
+    waiter.thread = System::scheduler->CurrentThread();
+    futexWaiters->push_back(waiter);
+
+    System::scheduler->Block(waiter.thread);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    return SYSCALL_RET_SUCCES;
+}
+
+int IPCManager::FutexWake(Process* proc, uint32_t address, int count)
+{
+    uint32_t phys = FutexAddress(address);
+    if(phys == 0)
+        return 0;
+    
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    int woken = 0;
+    for(int i = 0; i < futexWaiters->size() && woken < count;)
+    {
+        FutexWaiter waiter = futexWaiters->GetAt(i);
+        if(waiter.physAddress != phys) {
+            i++;
+            continue;
+        }
+
+        futexWaiters->Remove(i);
+        System::scheduler->Unblock(waiter.thread);
+        woken++;
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+    return woken;
+}
+
+void IPCManager::RemoveWaiters(Process* proc)
+{
+    for(int i = 0; i < futexWaiters->size();)
+    {
+        if(futexWaiters->GetAt(i).thread->parent == proc)
+            futexWaiters->Remove(i);
+        else
+            i++;
+    }
 }
 
 //Called from systemcalls when process tries to send a ipc message
@@ -36,15 +117,12 @@ void IPCManager::HandleSend(core::CPUState* state, Process* proc)
     //Add the message to the buffer of the target process
     target->ipcMessages.push_back(*msg);
 
+    //Wake up a thread of the target that waits for this kind of message
     int i = 0;
-    for(IPCReceiveDescriptor desc : *receivingBlockedList) {
-        if(desc.receivingProcess == target && (desc.receiveFromPID == -1 ? true : desc.receiveFromPID == proc->id) && (desc.receiveType == -1 ? true : desc.receiveType == msg->type))
-        {    
-            Thread* receivingThread = desc.receivingThread;
-            if(receivingThread == 0)
-                continue;
-            
-            receivingBlockedList->Remove(i);
+    for(Thread* receivingThread : target->ipcReceivers) {
+        if((receivingThread->ipcReceiveFrom == -1 || receivingThread->ipcReceiveFrom == proc->id) && (receivingThread->ipcReceiveType == -1 || receivingThread->ipcReceiveType == msg->type))
+        {
+            target->ipcReceivers.Remove(i);
             System::scheduler->Unblock(receivingThread);
             break;
         }
@@ -65,29 +143,26 @@ void IPCManager::HandleReceive(core::CPUState* state, Process* proc)
 
     //We need to block ourself if there are no messages at the moment
     if (proc->ipcMessages.size() <= 0) {
-        //Generate IPC Receive Descriptor
-        IPCReceiveDescriptor desc;
-
-        //////////
-        // Fill in variables
-        //////////
-        desc.receivingProcess = proc;
-        desc.receivingThread = System::scheduler->CurrentThread();
-        desc.receiveFromPID = recvFrom;
-        desc.receiveType = type;
-
-        //Add this thread to the list of blocked processes
-        receivingBlockedList->push_back(desc);
-        System::scheduler->Block(desc.receivingThread, BlockedState::ReceiveIPC);
+        //Remember what we are waiting for, so a sender only wakes us for a matching message
+        Thread* thread = System::scheduler->CurrentThread();
+        thread->ipcReceiveFrom = recvFrom;
+        thread->ipcReceiveType = type;
+
+        proc->ipcReceivers.push_back(thread);
+        System::scheduler->Block(thread, BlockedState::ReceiveIPC);
     }
 
     //If we get here we are either unblocked or there was already a message ready to receive
     int messageIndex = 0;
-    LIBHeisenKernel::IPCMessage message = proc->ipcMessages.GetAt(messageIndex);
+    LIBHeisenKernel::IPCMessage message;
     
     //Loop throug all the messages until we find a correct one.
-    while ((message.dest != proc->id || (recvFrom == -1 ? false : recvFrom != message.source) || (type == -1 ? false : type != message.type)) && (messageIndex < proc->ipcMessages.size())) { //Is the message not for us or not from the correct source
-        proc->ipcMessages.GetAt(++messageIndex);
+    for(LIBHeisenKernel::IPCMessage item : proc->ipcMessages) {
+        if(item.dest == proc->id && (recvFrom == -1 || recvFrom == item.source) && (type == -1 || type == item.type)) {
+            message = item;
+            break;
+        }
+        messageIndex++;
     }
 
     //We did not find a message that is for us or has the right parameters
@@ -107,4 +182,50 @@ void IPCManager::HandleReceive(core::CPUState* state, Process* proc)
 
     if (errRet != 0)
         *errRet = SYSCALL_RET_SUCCES;
-}
\ No newline at end of file
+}
+
+void IPCManager::Benchmark()
+{
+    const int processCounts[] = { 1, 16, 128 };
+    List<Process*> created;
+
+    for(int count : processCounts)
+    {
+        // Add dummy processes until there are enough, the last one is the target so the lookup is not the first hit of a list
+        while(created.size() < count)
+            created.push_back(ProcessHelper::CreateKernelProcess());
+        
+        Process* sender = created[0];
+        Process* target = created[count - 1];
+
+        LIBHeisenKernel::IPCMessage message;
+        MemoryOperations::memset(&message, 0, sizeof(LIBHeisenKernel::IPCMessage));
+        message.source = sender->id;
+        message.dest = target->id;
+
+        LIBHeisenKernel::IPCMessage received;
+        CPUState state;
+
+        uint64_t start = System::pit->Ticks();
+        for(int i = 0; i < IPC_BENCHMARK_MESSAGES; i++)
+        {
+            message.arg1 = i;
+            state.EBX = (uint32_t)&message;
+            HandleSend(&state, sender);
+
+            state.EBX = (uint32_t)&received;
+            state.ECX = -1;
+            state.EDX = 0;
+            state.ESI = -1;
+            HandleReceive(&state, target);
+        }
+        uint32_t ms = (uint32_t)(System::pit->Ticks() - start);
+
+        Log(Info, "IPC Benchmark: %d processes, %d messages in %d ms, %d ns per message", count, IPC_BENCHMARK_MESSAGES, ms, ms * (1000000 / IPC_BENCHMARK_MESSAGES));
+    }
+
+    for(Process* proc : created) {
+        ProcessHelper::ForgetProcess(proc);
+        delete proc;
+    }
+}
@@ -9,9 +9,14 @@ extern "C" int TestAndSet(int newValue, int* ptr);
 MutexLock::MutexLock()
 {
     this->value = 0;
+    this->contended = 0;
 }
 void MutexLock::Lock()
 {
+    if (TestAndSet(1, &this->value) == 0)
+        return;
+    
+    this->contended++;
     while (TestAndSet(1, &this->value) == 1) {
         if(System::scheduler && System::scheduler->Enabled)
             System::scheduler->ForceSwitch();
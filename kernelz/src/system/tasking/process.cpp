@@ -3,6 +3,8 @@
 #include <system/system.h>
 #include <system/memory/deviceheap.h>
 #include <system/tasking/elf.h>
+#include <system/memory/pipe.h>
+#include <system/memory/pagecache.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -11,43 +13,45 @@ using namespace HeisenOs::system;
 
 static int currentPID = 1;
 List<Process*> ProcessHelper::Processes;
+Process* ProcessHelper::processTable[PROC_TABLE_SIZE];
 
 ProcessHelper::ProcessHelper()
 {   }
 
 Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
 {
-    // Check if the file exists
-    if(!System::vfs->FileExists(fileName))
+    // Only the headers are read here, the rest of the file is loaded on demand
+    VFSOpenFile* file = System::vfs->OpenFile(fileName);
+    if(file == 0)
         return 0;
 
-    // Get the filesize
-    int fileSize = System::vfs->GetFileSize(fileName);
-    if(fileSize == -1)
-        return 0;
-
-    // Allocate a buffer to read the bin
-    uint8_t* fileBuffer = new uint8_t[fileSize];
-
-    if(System::vfs->ReadFile(fileName, fileBuffer) != 0) //An error occurred
+    ElfHeader header;
+    if(System::vfs->ReadOpenFile(file, (uint8_t*)&header, sizeof(ElfHeader), 0) != sizeof(ElfHeader))
     {
-        delete fileBuffer;
+        System::vfs->CloseFile(file);
         return 0;
     }
 
-    InterruptDescriptorTable::DisableInterrupts();
-
     /*////////////////////
     Check for valid elf file
     */////////////////////
-    ElfHeader* header = (ElfHeader*)fileBuffer;
+    if(!(header.e_ident[0] == ELFMAG0 && header.e_ident[1] == ELFMAG1 && header.e_ident[2] == ELFMAG2 && header.e_ident[3] == ELFMAG3) || header.e_type != 2)
+    {
+        System::vfs->CloseFile(file);
+        return 0;
+    }
 
-    if(!(header->e_ident[0] == ELFMAG0 && header->e_ident[1] == ELFMAG1 && header->e_ident[2] == ELFMAG2 && header->e_ident[3] == ELFMAG3) || header->e_type != 2)
+    uint32_t prgmHeadersSize = header.e_phnum * sizeof(ElfProgramHeader);
+    ElfProgramHeader* prgmHeaders = new ElfProgramHeader[header.e_phnum];
+    if(System::vfs->ReadOpenFile(file, (uint8_t*)prgmHeaders, prgmHeadersSize, header.e_phoff) != (int)prgmHeadersSize)
     {
-        delete fileBuffer;
+        delete prgmHeaders;
+        System::vfs->CloseFile(file);
         return 0;
     }
 
+    InterruptDescriptorTable::DisableInterrupts();
+
     /*////////////////////
     Create addres space
     */////////////////////
@@ -62,6 +66,9 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
     for(uint32_t i = 0; i < KERNEL_HEAP_SIZE / 4_MB; i++)
         pageDir->entries[KERNEL_PTNUM + i + 1] = ((PageDirectory*)&BootPageDirectory)->entries[KERNEL_PTNUM + i + 1];
 
+    // And the windows used to access physical memory
+    pageDir->entries[PAGEDIR_INDEX(KERNEL_WINDOW_START)] = ((PageDirectory*)&BootPageDirectory)->entries[PAGEDIR_INDEX(KERNEL_WINDOW_START)];
+
     // We also need to copy memory used by devices to this process
     // We assume all memory is initialized when the first process is started
     for(uint32_t i = DEVICE_HEAP_START; i < (DEVICE_HEAP_START + DEVICE_HEAP_SIZE); i += 4_MB)
@@ -77,9 +84,6 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
     lastPDE.present = 1;
     pageDir->entries[1023] = lastPDE;
 
-    uint32_t oldCR3 = VirtualMemoryManager::GetPageDirectoryAddress();
-    VirtualMemoryManager::SwitchPageDirectory(pageDirPhys);
-
     /*////////////////////
     Create PCB
     */////////////////////
@@ -87,20 +91,27 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
     MemoryOperations::memset(proc, 0, sizeof(Process));
 
     /*////////////////////
-    Load process into memory
+    Register loadable segments
     */////////////////////
-    ElfProgramHeader* prgmHeader = (ElfProgramHeader*)(fileBuffer + header->e_phoff);
+    proc->excecutable.file = file;
+    ElfProgramHeader* prgmHeader = prgmHeaders;
 
-    for(int i = 0; i < header->e_phnum; i++, prgmHeader++)
+    for(int i = 0; i < header.e_phnum; i++, prgmHeader++)
         if(prgmHeader->p_type == 1)
         {
+            if(proc->excecutable.numSegments == PROC_MAX_SEGMENTS) {
+                Log(Warning, "Excecutable %s has too many segments", fileName);
+                break;
+            }
+
             // Should the pages for section be read only or write as well?
             // This way we can prevent that usercode modifies itself
-            bool rw = prgmHeader->p_flags & (1<<1);
-
-            // Allocate pages for section
-            for(uint32_t x = 0; x < prgmHeader->p_memsz; x+=PAGE_SIZE)
-                VirtualMemoryManager::AllocatePage(VirtualMemoryManager::GetPageForAddress(prgmHeader->p_vaddr + x, true, true, !isKernel), isKernel, rw);
+            ExcecutableSegment* segment = &proc->excecutable.segments[proc->excecutable.numSegments++];
+            segment->virtAddress = prgmHeader->p_vaddr;
+            segment->memSize = prgmHeader->p_memsz;
+            segment->fileOffset = prgmHeader->p_offset;
+            segment->fileSize = prgmHeader->p_filesz;
+            segment->writeable = prgmHeader->p_flags & (1<<1);
 
             // Store memory information about excecutable
 			if (prgmHeader->p_vaddr < proc->excecutable.memBase || proc->excecutable.memBase == 0) {
@@ -110,29 +121,8 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
 				proc->excecutable.memSize = prgmHeader->p_vaddr + prgmHeader->p_memsz - proc->excecutable.memBase;
             }
         }
-    
-    VirtualMemoryManager::ReloadCR3();
 
-    // Reset it otherwise the code will not be copied
-    prgmHeader = (ElfProgramHeader*)(fileBuffer + header->e_phoff);
-
-    // Load application by copying all loadable sections into memory
-    for(int i = 0; i < header->e_phnum; i++, prgmHeader++) {
-        //Log(Info, "[Process.Create] Program header type %d", prgmHeader->p_type);
-        if(prgmHeader->p_type == 1) {
-            //Log(Info, "[Process.Create] p_memsz = %d, p_filesz = %d", prgmHeader->p_memsz, prgmHeader->p_filesz);
-            
-            // First copy part that is actually present in file
-            MemoryOperations::memcpy((void*)prgmHeader->p_vaddr, fileBuffer + prgmHeader->p_offset, prgmHeader->p_filesz);
-
-            // Calculate remaning space (if there is some)
-            uint32_t rem = prgmHeader->p_memsz - prgmHeader->p_filesz;
-            uint32_t off = prgmHeader->p_filesz;
-
-            // And clear remaning memory if necessary
-            if(rem) MemoryOperations::memset((void*)(prgmHeader->p_vaddr + off), 0, rem);
-        }
-    }
+    delete prgmHeaders;
 
     // Put information in PCB
     proc->id = currentPID++;
@@ -140,36 +130,47 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
     proc->state = ProcessState::Active;
     proc->isUserspace = !isKernel;
     proc->args = arguments;
-    proc->Threads.push_back(ThreadHelper::CreateFromFunction((void (*)())header->e_entry, isKernel));
+    proc->startTicks = System::pit->Ticks();
+    proc->Threads.push_back(ThreadHelper::CreateFromFunction((void (*)())header.e_entry, isKernel));
 
     Thread* mainThread = proc->Threads[0];
 
+    // The address space is filled in from here, so there is no need to switch to it
+    uint32_t mapFlags = VMM_ALLOCATE | VMM_WRITEABLE | (isKernel ? 0 : VMM_USER);
+
     // Create userstack for process
-    for(uint32_t i = (uint32_t)mainThread->userStack; i < ((uint32_t)mainThread->userStack + mainThread->userStackSize); i+=PAGE_SIZE)
-        VirtualMemoryManager::AllocatePage(VirtualMemoryManager::GetPageForAddress(i, true, true, !isKernel), isKernel, true);
+    bool mapped = VirtualMemoryManager::MapRange((uint32_t)mainThread->userStack, 0, mainThread->userStackSize / PAGE_SIZE, mapFlags, pageDirPhys);
 
     //Create heap for user process
-    for(uint32_t i = 0; i < PROC_USER_HEAP_SIZE; i+=PAGE_SIZE)
-    {
-        uint32_t addr = pageRoundUp(proc->excecutable.memBase + proc->excecutable.memSize) + i;
-        VirtualMemoryManager::AllocatePage(VirtualMemoryManager::GetPageForAddress(addr, true, true, !isKernel), isKernel, true);
-    }
-
     proc->heap.heapStart = pageRoundUp(proc->excecutable.memBase + proc->excecutable.memSize);
     proc->heap.heapEnd = proc->heap.heapStart + PROC_USER_HEAP_SIZE;
+    if(mapped && !VirtualMemoryManager::MapRange(proc->heap.heapStart, 0, PROC_USER_HEAP_SIZE / PAGE_SIZE, mapFlags, pageDirPhys)) {
+        VirtualMemoryManager::UnmapRange((uint32_t)mainThread->userStack, mainThread->userStackSize / PAGE_SIZE, true, pageDirPhys);
+        mapped = false;
+    }
+
+    if(!mapped)
+    {
+        // MapRange already removed the pages of the range that failed
+        Log(Error, "Out of memory while creating process %s", fileName);
+        KernelHeap::allignedFree(mainThread->stack);
+        KernelHeap::allignedFree(mainThread->FPUBuffer);
+        delete mainThread;
+        delete proc;
+        KernelHeap::allignedFree(pageDir);
+        System::vfs->CloseFile(file);
+
+        InterruptDescriptorTable::EnableInterrupts();
+        return 0;
+    }
 
     //Create stream for input
-    proc->stdInput = new FIFOStream(10_KB);
+    proc->stdInput = new Pipe();
     //Redirect output to system console
     proc->stdOutput = System::ProcStandardOut;
    
     mainThread->parent = proc;
 
-    delete fileBuffer;
-
-    VirtualMemoryManager::SwitchPageDirectory(oldCR3);
-
-    //We can only copy the filename when we are in the same virtual space as the application that requested the exec
     int fileNameLen = String::strlen(fileName);
     MemoryOperations::memcpy(proc->fileName, fileName, fileNameLen <= 32 ? fileNameLen : 32);
 
@@ -185,7 +186,7 @@ Process* ProcessHelper::Create(char* fileName, char* arguments, bool isKernel)
     delete symbolFile;
 #endif
 
-    Processes.push_back(proc); //Finally add it to all known processes
+    AddProcess(proc); //Finally add it to all known processes
 
     return proc;
 }   
@@ -207,7 +208,7 @@ Process* ProcessHelper::CreateKernelProcess()
     proc->heap.heapEnd = KERNEL_HEAP_SIZE;
     
     //Finally add it to all known processes
-    Processes.push_back(proc);
+    AddProcess(proc);
 
     return proc;
 }
@@ -216,22 +217,56 @@ void ProcessHelper::RemoveProcess(Process* proc)
 {
     Log(Info, "Removing process %d from system", proc->id);
     InterruptDescriptorTable::DisableInterrupts(); //We do not want to be interrupted during the switch
-    Processes.Remove(proc); //Remove the process from the list
+    ForgetProcess(proc); //Remove the process from the list
 
     for(int i = 0; i < proc->Threads.size(); i++)
         ThreadHelper::RemoveThread(proc->Threads[i]);
 
-    //Free pages used by excecutable code
-    for(uint32_t p = proc->excecutable.memBase; p < proc->excecutable.memBase + proc->excecutable.memSize; p+=PAGE_SIZE)
-        VirtualMemoryManager::FreePage(VirtualMemoryManager::GetPageForAddress(p, false));
+    //Free pages used by excecutable code, pages shared with other processes are owned by the page cache
+    for(uint32_t p = pageRoundDown(proc->excecutable.memBase); p < proc->excecutable.memBase + proc->excecutable.memSize; p+=PAGE_SIZE)
+    {
+        PageTableEntry* pageEntry = VirtualMemoryManager::GetPageForAddress(p, false);
+        if(pageEntry == 0)
+            continue; // Never accessed
+        else if(pageEntry->present && (pageEntry->unused & PAGE_SHARED)) {
+            PageCache::Release(proc->excecutable.file->node.location, p, pageEntry->frame * PAGE_SIZE);
+            pageEntry->present = 0;
+        }
+        else
+            VirtualMemoryManager::FreePage(pageEntry);
+    }
+
+    if(proc->excecutable.file != 0)
+        System::vfs->CloseFile(proc->excecutable.file);
 
     //Free pages used by the heap
     for(uint32_t p = proc->heap.heapStart; p < proc->heap.heapEnd; p+=PAGE_SIZE)
-        VirtualMemoryManager::FreePage(VirtualMemoryManager::GetPageForAddress(p, false));
+    {
+        PageTableEntry* pageEntry = VirtualMemoryManager::GetPageForAddress(p, false);
+        if(pageEntry != 0)
+            VirtualMemoryManager::FreePage(pageEntry);
+    }
 
     //Delete ipc messages
     proc->ipcMessages.Clear();
+    IPCManager::RemoveWaiters(proc);
+
+    //Close files left open by the process
+    for(int i = 0; i < PROC_MAX_OPEN_FILES; i++)
+        if(proc->openFiles[i] != 0)
+            System::vfs->CloseFile(proc->openFiles[i]);
+    
+    //Threads of this process that are blocked on a pipe will never be woken up
+    for(int i = 0; i < Processes.size(); i++)
+        if(Processes[i]->stdInput != 0)
+            Processes[i]->stdInput->RemoveWaiters(proc);
+    if(proc->stdInput != 0)
+        proc->stdInput->RemoveWaiters(proc);
     
+    //Let the process reading our output know that nothing more will come
+    if(proc->stdOutput != 0)
+        proc->stdOutput->Hangup();
+
     //Remove processes output that point to this process input
     for(int i = 0; i < Processes.size(); i++)
         if(Processes[i]->stdOutput == proc->stdInput)
@@ -249,14 +284,21 @@ void ProcessHelper::RemoveProcess(Process* proc)
     System::scheduler->ForceSwitch();
 }
 
-void ProcessHelper::UpdateHeap(Process* proc, uint32_t newEndAddr)
+bool ProcessHelper::UpdateHeap(Process* proc, uint32_t newEndAddr)
 {
     if(proc->heap.heapEnd < newEndAddr) //Expand
     {
+        if(proc->isUserspace && newEndAddr > KERNEL_VIRT_ADDR)
+            return false;
+
         Log(Info, "Expanding heap (PID: %d) from %x to %x", proc->id, proc->heap.heapEnd, newEndAddr);
         
-        for(uint32_t i = proc->heap.heapEnd; i < pageRoundUp(newEndAddr); i+=PAGE_SIZE)
-            VirtualMemoryManager::AllocatePage(VirtualMemoryManager::GetPageForAddress(i, true, true, proc->isUserspace), !proc->isUserspace, true);
+        // Nothing is mapped when this fails, so the heap stays as it was
+        uint32_t mapFlags = VMM_ALLOCATE | VMM_WRITEABLE | (proc->isUserspace ? VMM_USER : 0);
+        if(!VirtualMemoryManager::MapRange(proc->heap.heapEnd, 0, (pageRoundUp(newEndAddr) - proc->heap.heapEnd) / PAGE_SIZE, mapFlags, proc->pageDirPhys)) {
+            Log(Error, "Out of memory while expanding heap of process %d", proc->id);
+            return false;
+        }
         
         proc->heap.heapEnd = pageRoundUp(newEndAddr);
     }
@@ -264,16 +306,218 @@ void ProcessHelper::UpdateHeap(Process* proc, uint32_t newEndAddr)
     {
         Log(Info, "shrinking heap (PID: %d) from %x to %x", proc->id, proc->heap.heapEnd, newEndAddr);
 
-        for(uint32_t i = pageRoundUp(newEndAddr); i < proc->heap.heapEnd; i+=PAGE_SIZE)
-            VirtualMemoryManager::FreePage(VirtualMemoryManager::GetPageForAddress(i, false, true, proc->isUserspace));
+        VirtualMemoryManager::UnmapRange(pageRoundUp(newEndAddr), (proc->heap.heapEnd - pageRoundUp(newEndAddr)) / PAGE_SIZE, true, proc->pageDirPhys);
         
         proc->heap.heapEnd = pageRoundUp(newEndAddr);
     }
+    return true;
+}
+
+bool ProcessHelper::HandlePageFault(Process* proc, uint32_t address, bool allowIO)
+{
+    if(proc->excecutable.file == 0)
+        return false;
+
+    uint32_t page = pageRoundDown(address);
+    VirtualFileSystem* fs = proc->excecutable.file->fs;
+    uint32_t fileLocation = proc->excecutable.file->node.location;
+
+    // Segments do not need to be page aligned, so multiple of them can share this page
+    bool found = false;
+    bool writeable = false;
+    for(int i = 0; i < proc->excecutable.numSegments; i++)
+    {
+        ExcecutableSegment* segment = &proc->excecutable.segments[i];
+        if(page < segment->virtAddress + segment->memSize && page + PAGE_SIZE > segment->virtAddress) {
+            found = true;
+            writeable |= segment->writeable;
+        }
+    }
+    if(!found)
+        return false;
+
+    PageTableEntry* pageEntry = VirtualMemoryManager::GetPageForAddress(page, true, true, proc->isUserspace);
+
+    // Another process running this file might have loaded the page already
+    uint32_t physAddress = PageCache::Acquire(fs, fileLocation, page);
+    if(physAddress == 0)
+    {
+        // Contents of the page, parts not backed by the file stay zero (bss)
+        uint8_t* buffer = new uint8_t[PAGE_SIZE];
+        MemoryOperations::memset(buffer, 0, PAGE_SIZE);
+
+        //Interrupts need to be enabled for disk io
+        if(allowIO)
+            InterruptDescriptorTable::EnableInterrupts();
+
+        for(int i = 0; i < proc->excecutable.numSegments && found; i++)
+        {
+            ExcecutableSegment* segment = &proc->excecutable.segments[i];
+            uint32_t start = page > segment->virtAddress ? page : segment->virtAddress;
+            uint32_t end = page + PAGE_SIZE < segment->virtAddress + segment->fileSize ? page + PAGE_SIZE : segment->virtAddress + segment->fileSize;
+            if(end <= start)
+                continue;
+            
+            // System calls prepare user buffers before using them, so the kernel should never get here
+            if(!allowIO) {
+                Log(Error, "Page %x of process %d needs to be loaded from kernel code", page, proc->id);
+                found = false;
+                break;
+            }
+
+            int len = System::vfs->ReadOpenFile(proc->excecutable.file, buffer + (start - page), end - start, segment->fileOffset + (start - segment->virtAddress));
+            if(len != (int)(end - start)) {
+                Log(Error, "Could not load page %x of process %d", page, proc->id);
+                found = false;
+            }
+        }
+
+        if(allowIO)
+            InterruptDescriptorTable::DisableInterrupts();
+
+        // Another thread of this process could have loaded the page while we were reading
+        if(!found || pageEntry->present) {
+            delete buffer;
+            return found;
+        }
+
+        // Or another process running the same file
+        physAddress = PageCache::Acquire(fs, fileLocation, page);
+        if(physAddress == 0)
+        {
+            physAddress = (uint32_t)PhysicalMemoryManager::AllocateBlock();
+            if(physAddress == 0) {
+                delete buffer;
+                return false;
+            }
+
+            pageEntry->frame = physAddress / PAGE_SIZE;
+            pageEntry->readWrite = 1;
+            pageEntry->isUser = proc->isUserspace;
+            pageEntry->present = 1;
+            invlpg((void*)page);
+
+            MemoryOperations::memcpy((void*)page, buffer, PAGE_SIZE);
+            PageCache::Insert(fs, fileLocation, page, physAddress);
+        }
+        delete buffer;
+    }
+
+    // Map the cached page read only, writeable segments get a private copy on the first write
+    pageEntry->frame = physAddress / PAGE_SIZE;
+    pageEntry->readWrite = 0;
+    pageEntry->isUser = proc->isUserspace;
+    pageEntry->unused = PAGE_SHARED | (writeable ? PAGE_COPY_ON_WRITE : 0);
+    pageEntry->present = 1;
+    invlpg((void*)page);
+
+    proc->demandPages++;
+    return true;
+}
+
+bool ProcessHelper::HandleCopyOnWrite(Process* proc, uint32_t address)
+{
+    if(proc->excecutable.file == 0)
+        return false;
+    
+    uint32_t page = pageRoundDown(address);
+    PageTableEntry* pageEntry = VirtualMemoryManager::GetPageForAddress(page, false);
+    if(!(pageEntry->unused & PAGE_COPY_ON_WRITE))
+        return false;
+    
+    uint32_t newPhysAddress = (uint32_t)PhysicalMemoryManager::AllocateBlock();
+    if(newPhysAddress == 0)
+        return false;
+
+    uint8_t* buffer = new uint8_t[PAGE_SIZE];
+    MemoryOperations::memcpy(buffer, (void*)page, PAGE_SIZE);
+
+    // Replace the shared page with a private writeable one
+    uint32_t oldPhysAddress = pageEntry->frame * PAGE_SIZE;
+    pageEntry->frame = newPhysAddress / PAGE_SIZE;
+    pageEntry->readWrite = 1;
+    pageEntry->unused = 0;
+    invlpg((void*)page);
+
+    MemoryOperations::memcpy((void*)page, buffer, PAGE_SIZE);
+    delete buffer;
+
+    PageCache::Release(proc->excecutable.file->node.location, page, oldPhysAddress);
+    return true;
+}
+
+bool ProcessHelper::PrepareUserBuffer(Process* proc, uint32_t address, uint32_t length, bool write)
+{
+    // Kernel processes pass kernel memory
+    if(!proc->isUserspace || length == 0)
+        return true;
+    if(address >= KERNEL_VIRT_ADDR || length > KERNEL_VIRT_ADDR - address)
+        return false;
+    
+    for(uint32_t page = pageRoundDown(address); page < address + length; page += PAGE_SIZE)
+    {
+        PageTableEntry* pageEntry = VirtualMemoryManager::GetPageForAddress(page, false);
+        if(pageEntry == 0 || !pageEntry->present) {
+            bool loaded = HandlePageFault(proc, page, true);
+            // It ends with interrupts disabled like the exception handler expects, system calls run with them enabled
+            InterruptDescriptorTable::EnableInterrupts();
+            if(!loaded)
+                return false;
+            pageEntry = VirtualMemoryManager::GetPageForAddress(page, false);
+        }
+
+        if(write && !pageEntry->readWrite && !HandleCopyOnWrite(proc, page))
+            return false;
+    }
+    return true;
+}
+
+bool ProcessHelper::PrepareUserString(Process* proc, const char* string)
+{
+    if(!proc->isUserspace)
+        return true;
+    
+    uint32_t address = (uint32_t)string;
+    while(true)
+    {
+        if(!PrepareUserBuffer(proc, address, 1, false))
+            return false;
+        
+        // Continue with the next page when the end is not in this one
+        uint32_t pageEnd = pageRoundDown(address) + PAGE_SIZE;
+        for(; address < pageEnd; address++)
+            if(*(char*)address == '\0')
+                return true;
+    }
+}
+
+void ProcessHelper::AddProcess(Process* proc)
+{
+    Processes.push_back(proc);
+
+    Process** bucket = &processTable[proc->id & (PROC_TABLE_SIZE - 1)];
+    proc->hashNext = *bucket;
+    *bucket = proc;
+}
+
+void ProcessHelper::ForgetProcess(Process* proc)
+{
+    Processes.Remove(proc);
+
+    Process** link = &processTable[proc->id & (PROC_TABLE_SIZE - 1)];
+    while(*link != 0) {
+        if(*link == proc) {
+            *link = proc->hashNext;
+            break;
+        }
+        link = &(*link)->hashNext;
+    }
 }
 
 Process* ProcessHelper::ProcessById(int id)
 {
-    for(Process* p : Processes)
+    // Ids are handed out sequentially, so with less than PROC_TABLE_SIZE processes every bucket holds at most one
+    for(Process* p = processTable[id & (PROC_TABLE_SIZE - 1)]; p != 0; p = p->hashNext)
         if(p->id == id)
             return p;
             
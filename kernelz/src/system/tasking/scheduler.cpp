@@ -2,6 +2,8 @@
 
 #include <system/system.h>
 #include <core/tss.h>
+#include <core/cpu.h>
+#include <core/fpu.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -10,74 +12,172 @@ using namespace HeisenOs::core;
 
 extern "C" void enter_usermode(uint32_t location, uint32_t stackAddress, uint32_t flags);
 
+// Add a thread to the end of a queue
+static void QueuePush(ThreadQueue* queue, Thread* thread)
+{
+    thread->queue = queue;
+    thread->queueNext = 0;
+    thread->queuePrev = queue->tail;
+
+    if(queue->tail)
+        queue->tail->queueNext = thread;
+    else
+        queue->head = thread;
+    
+    queue->tail = thread;
+    queue->count++;
+}
+
+// Add a thread to a queue in front of another one, or at the end when before is 0
+static void QueueInsertBefore(ThreadQueue* queue, Thread* before, Thread* thread)
+{
+    if(before == 0) {
+        QueuePush(queue, thread);
+        return;
+    }
+
+    thread->queue = queue;
+    thread->queueNext = before;
+    thread->queuePrev = before->queuePrev;
+
+    if(before->queuePrev)
+        before->queuePrev->queueNext = thread;
+    else
+        queue->head = thread;
+    
+    before->queuePrev = thread;
+    queue->count++;
+}
+
+// Remove a thread from the queue it is on
+static void QueueRemove(ThreadQueue* queue, Thread* thread)
+{
+    if(thread->queuePrev)
+        thread->queuePrev->queueNext = thread->queueNext;
+    else
+        queue->head = thread->queueNext;
+    
+    if(thread->queueNext)
+        thread->queueNext->queuePrev = thread->queuePrev;
+    else
+        queue->tail = thread->queuePrev;
+    
+    thread->queue = 0;
+    thread->queueNext = 0;
+    thread->queuePrev = 0;
+    queue->count--;
+}
+
 Scheduler::Scheduler()
 : InterruptHandler(0x20)
 {
     this->tickCount = 0;
     this->frequency = SCHEDULER_FREQUENCY;
+    this->threadCount = 0;
     this->currentThread = 0;
-    this->threadsList.Clear();
     this->Enabled = false;
     this->switchForced = false;
+
+    MemoryOperations::memset(this->runQueues, 0, sizeof(this->runQueues));
+    MemoryOperations::memset(&this->blockedThreads, 0, sizeof(this->blockedThreads));
+    MemoryOperations::memset(&this->sleepingThreads, 0, sizeof(this->sleepingThreads));
+    this->activeQueue = &this->runQueues[0];
+    this->expiredQueue = &this->runQueues[1];
 }
 
 uint32_t Scheduler::HandleInterrupt(uint32_t esp)
 {
-    tickCount++;
-    if(this->switchForced == false)
-        ProcessSleepingThreads();
+    //The cpu is not halted anymore, this interrupt could switch away from the idle thread
+    if(idleStart != 0) {
+        idleCycles += CPU::ReadTimestamp() - idleStart;
+        idleStart = 0;
+    }
+
+    //Multiple ticks can pass with one interrupt when the timer was stopped during idle
+    uint32_t ticks = System::pit ? System::pit->InterruptTicks() : 1;
+    tickCount += ticks;
+    bool preempt = false;
+
+#if ENABLE_TICKLESS_IDLE
+    //The idle thread can be switched away from before its one-shot fired, the timer has to tick periodically again
+    uint32_t skipped = System::pit ? System::pit->StopOneShot() : 0;
+    if(skipped > 0) {
+        timerTicks += skipped;
+        tickCount += skipped;
+        preempt = ProcessSleepingThreads(skipped);
+    }
+#endif
+
+    if(this->switchForced == false) {
+        timerTicks += ticks;
+        preempt |= ProcessSleepingThreads(ticks);
+
+        if(timerTicks - idleWindowTick >= PIT_FREQUENCY) {
+            UpdateIdleStatistics();
+            FPU::UpdateStatistics();
+        }
+    }
     else
         this->switchForced = false; //Reset it back
+    
+    //A thread that just woke up should not have to wait until the time slice of the current one is over
+    if(preempt)
+        tickCount = frequency;
 
-    if(tickCount == frequency)
+    if(tickCount >= frequency)
     {
         //Log(Info, "Performing Task Switch");
         
         //Reset tick count first
         tickCount = 0;
 
-        if(threadsList.size() > 0 && this->Enabled)
+        if(threadCount > 0 && this->Enabled)
         {
-            //Get a new thread to switch to
+            //Get a new thread to switch to, the current thread is not on a queue so it will not be picked here
             Thread* nextThread = GetNextReadyThread();
 
-            //Remove all the threads that are stopped from the system
-            while(nextThread->state == Stopped)
-            {
-                Log(Info, "Removing thread %x from system", (uint32_t)nextThread);
-                threadsList.Remove(nextThread);
-                delete nextThread;
-
-                //Ask for a new thread
-                nextThread = GetNextReadyThread();
-            }
+            //There is nothing else to run, so just continue with the current thread
+            if(nextThread == 0)
+                return esp;
       
             //Check if the current thread is stopped
             if(currentThread != 0 && currentThread->state == Stopped)
+                RemoveStoppedThread(currentThread);
+            
+            else if(currentThread != 0)
             {
-                Log(Info, "Removing thread %x from system", (uint32_t)currentThread);
-                threadsList.Remove(currentThread);
-                delete currentThread;
+                //At the first context switch the esp is pointing at the stack pointer used by the kernel,
+                //we do not want to save this info otherwise we will be running the kernel instead of the task
+                //Since all the stack pointers are allocated by the kernel we can check if it is kernel or not
+                //TODO: Is there no better way for this?
+                if(esp >= KERNEL_HEAP_START)
+                {
+                    //Save old registers
+                    currentThread->regsPtr = (CPUState*)esp;
+                }
+
+                //Its time slice is used, so it has to wait until all other ready threads had their turn
+                //When it is preempted it can continue in this round
+                if(currentThread != nextThread)
+                    Enqueue(currentThread, !preempt);
             }
 
-            //At the first context switch the esp is pointing at the stack pointer used by the kernel,
-            //we do not want to save this info otherwise we will be running the kernel instead of the task
-            //Since all the stack pointers are allocated by the kernel we can check if it is kernel or not
-            //TODO: Is there no better way for this?
-            else if(esp >= KERNEL_HEAP_START)
+            //Measure how long it took for a thread to run again after its sleep ended
+            if(nextThread->wakeTimestamp != 0)
             {
-                //Save old registers
-                currentThread->regsPtr = (CPUState*)esp;
-
-                //Save current fpu status
-                asm volatile ("fxsave (%%eax)" : : "a" (currentThread->FPUBuffer));
+                wakeLatency.Add(CPU::ReadTimestamp() - nextThread->wakeTimestamp);
+                if(timerTicks - nextThread->wakeTick > 1)
+                    lateWakeups++;
+                
+                nextThread->wakeTimestamp = 0;
             }
 
-            //Load fpu status
-            asm volatile ("fxrstor (%%eax)" : : "a" (nextThread->FPUBuffer));
+            //The fpu status is only switched when the next thread uses the fpu
+            FPU::SwitchTo(nextThread->FPUBuffer);
             
             //Since we are switching now
             currentThread = nextThread;
+            frequency = TimeSlice(nextThread);
 
             //Check if the next thread has not been called before
             if(nextThread->state == Started && nextThread->parent && nextThread->parent->isUserspace)
@@ -105,23 +205,119 @@ uint32_t Scheduler::HandleInterrupt(uint32_t esp)
 
 Thread* Scheduler::GetNextReadyThread()
 {
-    int currentThreadIndex = (currentThread != 0 ? threadsList.IndexOf(currentThread) : 0);
-    currentThreadIndex += 1;
-    if(currentThreadIndex >= threadsList.size())
-        currentThreadIndex = 0;
+    while(true)
+    {
+        //Every ready thread had its turn, start a new round
+        if(activeQueue->bitmap == 0)
+        {
+            RunQueue* temp = activeQueue;
+            activeQueue = expiredQueue;
+            expiredQueue = temp;
+
+            if(activeQueue->bitmap == 0)
+                return 0;
+        }
+
+        //Pick the first thread of the highest priority level that has one
+        uint32_t level = 31 - __builtin_clz(activeQueue->bitmap);
+        Thread* thread = activeQueue->levels[level].head;
+        Dequeue(thread);
+
+        //Remove threads that are stopped from the system
+        if(thread->state == Stopped)
+            RemoveStoppedThread(thread);
+        
+        //The state could have been changed without calling Block(), move it to the blocked threads
+        else if(thread->state == Blocked)
+            Enqueue(thread);
+        
+        else
+            return thread;
+    }
+}
+
+void Scheduler::Enqueue(Thread* thread, bool expired, bool front)
+{
+    if(thread->queue != 0)
+        return;
+    
+    if(thread->state == Blocked) {
+        if(thread->blockedState == SleepMS)
+            AddSleepingThread(thread);
+        else
+            QueuePush(&blockedThreads, thread);
+        return;
+    }
+
+    RunQueue* runQueue = expired ? expiredQueue : activeQueue;
+    ThreadQueue* level = &runQueue->levels[thread->priority];
+    if(front)
+        QueueInsertBefore(level, level->head, thread);
+    else
+        QueuePush(level, thread);
+    runQueue->bitmap |= (1 << thread->priority);
+}
+
+void Scheduler::Dequeue(Thread* thread)
+{
+    ThreadQueue* queue = thread->queue;
+    if(queue == 0)
+        return;
+    
+    //The next sleeping thread now has to wait for the time that was left for this one as well
+    if(queue == &sleepingThreads && thread->queueNext != 0)
+        thread->queueNext->timeDelta += thread->timeDelta;
+
+    QueueRemove(queue, thread);
+
+    //Clear the bit of this level when it is empty now
+    if(queue->head == 0)
+        for(int i = 0; i < 2; i++)
+            if(queue == &runQueues[i].levels[thread->priority])
+                runQueues[i].bitmap &= ~(1 << thread->priority);
+}
+
+void Scheduler::RemoveStoppedThread(Thread* thread)
+{
+    Log(Info, "Removing thread %x from system", (uint32_t)thread);
+    Dequeue(thread);
+    threadCount--;
+    delete thread;
+}
 
-    while(threadsList[currentThreadIndex]->state == Blocked){
-        currentThreadIndex += 1;
-        if(currentThreadIndex >= threadsList.size())
-            currentThreadIndex = 0;
+void Scheduler::AddSleepingThread(Thread* thread)
+{
+    //Find the place in the queue, and make the delta relative to the threads in front of it
+    //A sleep of 0 lasts until the next tick, this way the first thread never has a delta of 0 when a tick starts
+    uint32_t delta = thread->timeDelta > 0 ? thread->timeDelta : 1;
+    Thread* next = sleepingThreads.head;
+    while(next != 0 && next->timeDelta <= delta) {
+        delta -= next->timeDelta;
+        next = next->queueNext;
     }
 
-    return threadsList[currentThreadIndex]; 
+    thread->timeDelta = delta;
+    if(next != 0)
+        next->timeDelta -= delta;
+    
+    QueueInsertBefore(&sleepingThreads, next, thread);
+}
+
+uint32_t Scheduler::TimeSlice(Thread* thread)
+{
+    return SCHEDULER_FREQUENCY * (thread->priority + 1) / (THREAD_PRIORITY_NORMAL + 1);
 }
 
 void Scheduler::AddThread(Thread* thread, bool forceSwitch)
 {
-    threadsList.push_back(thread);
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    threadCount++;
+    Enqueue(thread);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
 
     if(forceSwitch)
     {
@@ -136,6 +332,11 @@ void Scheduler::InitialThreadUserJump(Thread* thread)
 {
     InterruptDescriptorTable::DisableInterrupts();
 
+    //The thread we are replacing still needs to run later on
+    if(currentThread != 0 && currentThread != thread && currentThread->state != Stopped)
+        Enqueue(currentThread, true);
+    Dequeue(thread);
+
     TSS::SetStack(0x10, (uint32_t)thread->stack + THREAD_STACK_SIZE);
 
     //Dont forget to load the page directory
@@ -143,6 +344,7 @@ void Scheduler::InitialThreadUserJump(Thread* thread)
 
     //We are becoming the current thread
     currentThread = thread;
+    FPU::SwitchTo(thread->FPUBuffer);
 
     //We need to be enabled on the next timer interrupt
     this->Enabled = true;
@@ -175,30 +377,167 @@ Process* Scheduler::CurrentProcess()
 void Scheduler::Block(Thread* thread, BlockedState reason)
 {
     //Log(Info, "Blocking thread %x", (uint32_t)thread);
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
     thread->blockedState = reason;
     thread->state = ThreadState::Blocked;
 
+    //Move it to the blocked or sleeping threads, this is also done for the current thread since
+    //it keeps running when there is nothing else to switch to, and it should still be woken up then
+    Dequeue(thread);
+    Enqueue(thread);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+
     if(thread == CurrentThread())
         ForceSwitch();
 }
 void Scheduler::Unblock(Thread* thread, bool forceSwitch)
 {
     //Log(Info, "Unblocking thread %x", (uint32_t)thread);
-    thread->state = ThreadState::Ready;
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    //Threads that have not been started yet keep their state
+    if(thread->state == ThreadState::Blocked)
+        thread->state = ThreadState::Ready;
+
+    //Woken up threads don't have to wait for the next round, and run first within their priority
+    if(thread->queue == &blockedThreads || thread->queue == &sleepingThreads) {
+        Dequeue(thread);
+        Enqueue(thread, false, true);
+    }
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
 
     if(forceSwitch)
         ForceSwitch();
 }
-void Scheduler::ProcessSleepingThreads()
+void Scheduler::SetPriority(Thread* thread, uint32_t priority)
 {
-    for(int i = 0; i < threadsList.size(); i++)
+    if(priority >= THREAD_PRIORITY_LEVELS)
+        priority = THREAD_PRIORITY_HIGHEST;
+    
+    bool interrupts = InterruptDescriptorTable::AreEnabled();
+    InterruptDescriptorTable::DisableInterrupts();
+
+    //Ready threads need to be moved to the queue of their new level
+    bool queued = thread->queue != 0 && thread->queue != &blockedThreads && thread->queue != &sleepingThreads;
+    if(queued)
+        Dequeue(thread);
+    
+    thread->priority = priority;
+
+    if(queued)
+        Enqueue(thread);
+
+    if(interrupts)
+        InterruptDescriptorTable::EnableInterrupts();
+}
+bool Scheduler::ProcessSleepingThreads(uint32_t ticks)
+{
+    bool preempt = false;
+    Thread* thread = 0;
+    while(ticks > 0 && (thread = sleepingThreads.head) != 0)
     {
-        Thread* thread = threadsList[i];
-        if(thread->state == Blocked && thread->blockedState == SleepMS && thread->timeDelta > 0)
+        //Only the first thread needs to be updated, the others are relative to it
+        uint32_t step = thread->timeDelta < ticks ? thread->timeDelta : ticks;
+        thread->timeDelta -= step;
+        ticks -= step;
+
+        while((thread = sleepingThreads.head) != 0 && thread->timeDelta == 0)
         {
-            thread->timeDelta--;
-            if(thread->timeDelta <= 0)
-                Unblock(thread); //Perhaps call thread directly when time has passed, this will be more acurate but harder to implement
+            thread->wakeTimestamp = CPU::ReadTimestamp();
+            thread->wakeTick = timerTicks;
+            wakeups++;
+
+            if(currentThread == 0 || thread->priority >= currentThread->priority)
+                preempt = true;
+
+            Unblock(thread);
         }
     }
+
+    return preempt;
+}
+void Scheduler::Sleep(uint32_t ms)
+{
+    //Without a thread to block, or with interrupts disabled, all we can do is wait for the timer
+    if(!this->Enabled || currentThread == 0 || !InterruptDescriptorTable::AreEnabled()) {
+        System::pit->Sleep(ms);
+        return;
+    }
+
+    Thread* thread = currentThread;
+    thread->timeDelta = ms;
+    Block(thread, BlockedState::SleepMS);
+
+    //Block() returns directly when there was no other thread to switch to
+    while(thread->state == Blocked)
+        asm ("hlt");
+}
+uint32_t Scheduler::ThreadCount()
+{
+    return threadCount;
+}
+void Scheduler::Idle()
+{
+    InterruptDescriptorTable::DisableInterrupts();
+
+    //Only halt when there is really nothing else to do
+    if(activeQueue->bitmap != 0 || expiredQueue->bitmap != 0 || !this->Enabled || currentThread == 0) {
+        InterruptDescriptorTable::EnableInterrupts();
+        ForceSwitch();
+        return;
+    }
+
+#if ENABLE_TICKLESS_IDLE
+    //No need for a tick until the first sleeping thread wakes up, other interrupts will wake us earlier
+    System::pit->StartOneShot(sleepingThreads.head ? sleepingThreads.head->timeDelta : PIT_ONESHOT_MAX_TICKS);
+#endif
+
+    //Enabling interrupts only takes effect after the next instruction, so we can't miss one before the hlt
+    idleStart = CPU::ReadTimestamp();
+    asm volatile ("sti; hlt; cli");
+    if(idleStart != 0) {
+        idleCycles += CPU::ReadTimestamp() - idleStart;
+        idleStart = 0;
+    }
+
+#if ENABLE_TICKLESS_IDLE
+    //When it was not the timer that woke us up, account for the ticks that were skipped until now
+    uint32_t passed = System::pit->StopOneShot();
+    if(passed > 0) {
+        timerTicks += passed;
+        tickCount += passed;
+        ProcessSleepingThreads(passed);
+    }
+#endif
+
+    InterruptDescriptorTable::EnableInterrupts();
+    ForceSwitch();
+}
+void Scheduler::UpdateIdleStatistics()
+{
+    uint64_t now = CPU::ReadTimestamp();
+
+    //Scale both down so we can use a 32-bit division
+    uint64_t total = now - idleWindowStart;
+    uint64_t idle = idleCycles;
+    while(total > 0xFFFFFF) {
+        total >>= 1;
+        idle >>= 1;
+    }
+
+    if(idleWindowStart != 0 && total > 0)
+        idlePercentage = ((uint32_t)idle * 100) / (uint32_t)total;
+    if(idlePercentage > 100)
+        idlePercentage = 100;
+
+    idleCycles = 0;
+    idleWindowStart = now;
+    idleWindowTick = timerTicks;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <system/memory/heap.h> 
 #include <system/system.h>
+#include <core/fpu.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -51,9 +52,15 @@ Thread* ThreadHelper::CreateFromFunction(void (*entryPoint)(), bool isKernel, ui
     //Assign thread parent
     result->parent = parent;
 
+    //Threads are not on a scheduler queue until they are added to it
+    result->priority = THREAD_PRIORITY_NORMAL;
+    result->queue = 0;
+    result->queueNext = 0;
+    result->queuePrev = 0;
+
     //Create a buffer for the fpu
-    result->FPUBuffer = (uint8_t*)KernelHeap::alignedMalloc(512, 16);
-    MemoryOperations::memset(result->FPUBuffer, 0, 512);
+    result->FPUBuffer = (uint8_t*)KernelHeap::alignedMalloc(FPU_STATE_SIZE, 16);
+    MemoryOperations::memset(result->FPUBuffer, 0, FPU_STATE_SIZE);
 
     //Return the result
     return result;
@@ -62,9 +69,14 @@ Thread* ThreadHelper::CreateFromFunction(void (*entryPoint)(), bool isKernel, ui
 void ThreadHelper::RemoveThread(Thread* thread)
 {
     KernelHeap::allignedFree(thread->stack);
+    FPU::ReleaseState(thread->FPUBuffer);
     KernelHeap::allignedFree(thread->FPUBuffer);
     for(uint32_t i = (uint32_t)thread->userStack; i < (uint32_t)thread->userStack + thread->userStackSize; i+=PAGE_SIZE)
         VirtualMemoryManager::FreePage(VirtualMemoryManager::GetPageForAddress(i, false));
 
     thread->state = ThreadState::Stopped;
+
+    //Blocked threads are not looked at by the scheduler, so move it back to the ready threads where it will be removed
+    if(System::scheduler)
+        System::scheduler->Unblock(thread);
 }
\ No newline at end of file
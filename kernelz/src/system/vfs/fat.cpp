@@ -1018,49 +1018,120 @@ uint32_t FAT::GetFileSize(const char* path)
 
     return fileSize;
 }
-int FAT::ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t len)
-{ 
-    if((int)len == -1)
-        len = GetFileSize(path);
+int FAT::ReadSectorRange(uint32_t sector, uint32_t offset, uint32_t length, uint8_t* dest)
+{
+    sector += offset / this->bytesPerSector;
+    offset = offset % this->bytesPerSector;
+
+    // Partial first sector
+    if(offset > 0 || length < this->bytesPerSector) {
+        if(this->disk->ReadSector(this->StartLBA + sector, this->readBuffer) != 0) {
+            Log(Error, "Error reading disk at lba %d", this->StartLBA + sector);
+            return -1;
+        }
+
+        uint32_t part = this->bytesPerSector - offset;
+        if(part > length)
+            part = length;
+        MemoryOperations::memcpy(dest, this->readBuffer + offset, part);
+
+        dest += part;
+        length -= part;
+        sector++;
+    }
 
+    // All complete sectors at once
+    uint32_t count = length / this->bytesPerSector;
+    if(count > 0) {
+        if(this->disk->ReadSectors(this->StartLBA + sector, count, dest) != 0) {
+            Log(Error, "Error reading disk at lba %d", this->StartLBA + sector);
+            return -1;
+        }
+
+        dest += count * this->bytesPerSector;
+        length -= count * this->bytesPerSector;
+        sector += count;
+    }
+
+    // Partial last sector
+    if(length > 0) {
+        if(this->disk->ReadSector(this->StartLBA + sector, this->readBuffer) != 0) {
+            Log(Error, "Error reading disk at lba %d", this->StartLBA + sector);
+            return -1;
+        }
+        MemoryOperations::memcpy(dest, this->readBuffer, length);
+    }
+    return 0;
+}
+
+bool FAT::LookupEntry(const char* path, VFSNode* node)
+{
     FATEntryInfo* entry = GetEntryByPath((char*)path);
     if(entry == 0)
+        return false;
+    
+    node->location = GET_CLUSTER(entry->entry);
+    node->isDirectory = (entry->entry.Attributes & ATTR_DIRECTORY);
+    node->size = node->isDirectory ? 0 : entry->entry.FileSize;
+
+    delete entry->filename;
+    delete entry;
+    return true;
+}
+
+int FAT::ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t len)
+{
+    VFSNode node;
+    if(!LookupEntry(path, &node))
         return -1;
     
-    if(entry->entry.Attributes & ATTR_DIRECTORY) {
-        delete entry->filename;
-        delete entry;
+    return ReadNode(&node, buffer, offset, len);
+}
+
+int FAT::ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset, uint32_t len)
+{ 
+    if(node->isDirectory)
         return -1;
-    }
 
-    uint32_t cluster = GET_CLUSTER(entry->entry);
-    uint8_t* bufferPointer = buffer;
-    uint32_t bytesRead = 0;
+    uint32_t cluster = node->location;
+    uint32_t fileSize = node->size;
 
-    // Not needed anymore
-    delete entry->filename;
-    delete entry;
+    if(offset >= fileSize)
+        return 0;
+    if(len > fileSize - offset)
+        len = fileSize - offset;
     
-    while ((cluster != CLUSTER_FREE) && (cluster < CLUSTER_END))
+    // Skip the clusters before the offset
+    for(uint32_t i = 0; i < offset / this->clusterSize && (cluster != CLUSTER_FREE) && (cluster < CLUSTER_END); i++)
+        cluster = ReadTable(cluster);
+    
+    uint32_t clusterOffset = offset % this->clusterSize;
+    uint32_t bytesRead = 0;
+    
+    while ((bytesRead < len) && (cluster != CLUSTER_FREE) && (cluster < CLUSTER_END))
     {
-        uint32_t sector = ClusterToSector(cluster);
-
-        for(uint16_t i = 0; i < this->sectorsPerCluster; i++) // Loop through sectors in this cluster
-        {
-            if(this->disk->ReadSector(this->StartLBA + sector + i, this->readBuffer) != 0) {
-                Log(Error, "Error reading disk at lba %d", this->StartLBA + sector + i);
-                return -1;
-            }
+        // Files are mostly stored in sequential clusters, so collect the run of clusters following this one
+        uint32_t clustersNeeded = (clusterOffset + (len - bytesRead) + this->clusterSize - 1) / this->clusterSize;
+        uint32_t runStart = cluster;
+        uint32_t runLength = 1;
+        uint32_t next = ReadTable(cluster);
+        while(runLength < clustersNeeded && next == cluster + 1) {
+            cluster = next;
+            runLength++;
+            next = ReadTable(cluster);
+        }
 
-            uint32_t remaingBytes = len - bytesRead;
+        uint32_t length = runLength * this->clusterSize - clusterOffset;
+        if(length > len - bytesRead)
+            length = len - bytesRead;
 
-            //Copy the required part of the buffer
-            MemoryOperations::memcpy(bufferPointer, this->readBuffer, remaingBytes <= this->bytesPerSector ? remaingBytes : this->bytesPerSector);
+        // And read the whole run with as few requests as possible
+        if(ReadSectorRange(ClusterToSector(runStart), clusterOffset, length, buffer + bytesRead) != 0)
+            return -1;
 
-            bytesRead += this->bytesPerSector;
-            bufferPointer += this->bytesPerSector;
-        }
-        cluster = ReadTable(cluster);
+        bytesRead += length;
+        clusterOffset = 0;
+        cluster = next;
     }
 
     return 0;
@@ -1087,32 +1158,33 @@ int FAT::WriteFile(const char* path, uint8_t* buffer, uint32_t len, bool create)
     uint32_t cluster = GET_CLUSTER(entry->entry);
     for(uint32_t i = 0; i < reqClusters; i++) {
         uint32_t sector = ClusterToSector(cluster);
-        for(uint32_t s = 0; s < this->sectorsPerCluster; s++) {
-            uint32_t bytesLeft = len - bytesWritten;
-
-            // Use readbuffer for partial writing when there is not a complete sector left
-            if(bytesLeft < this->bytesPerSector) {
-                MemoryOperations::memset(this->readBuffer, 0, this->bytesPerSector);        
-                MemoryOperations::memcpy(this->readBuffer, buffer + i*this->clusterSize + s*this->bytesPerSector, bytesLeft > this->bytesPerSector ? this->bytesPerSector : bytesLeft);
-
-                // Write sector with data to the disk
-                if(this->disk->WriteSector(this->StartLBA + sector + s, this->readBuffer) != 0) {
-                    delete entry->filename;
-                    delete entry;
-                    return -1;
-                }
-            }
-            else // Much faster routine for complete sectors (Much might be a overstatement, specialy for floppies)
-            {
-                if(this->disk->WriteSector(this->StartLBA + sector + s, buffer + i*this->clusterSize + s*this->bytesPerSector) != 0) {
-                    delete entry->filename;
-                    delete entry;
-                    return -1;
-                }
+
+        // Write all complete sectors of this cluster with one request
+        uint32_t fullSectors = (len - bytesWritten) / this->bytesPerSector;
+        if(fullSectors > this->sectorsPerCluster)
+            fullSectors = this->sectorsPerCluster;
+        if(fullSectors > 0) {
+            if(this->disk->WriteSectors(this->StartLBA + sector, fullSectors, buffer + bytesWritten) != 0) {
+                delete entry->filename;
+                delete entry;
+                return -1;
             }
+            bytesWritten += fullSectors * this->bytesPerSector;
+        }
+
+        // Use readbuffer for the last partial sector, the rest of it is padded with zeros
+        uint32_t bytesLeft = len - bytesWritten;
+        if(fullSectors < this->sectorsPerCluster && bytesLeft > 0) {
+            MemoryOperations::memset(this->readBuffer, 0, this->bytesPerSector);        
+            MemoryOperations::memcpy(this->readBuffer, buffer + bytesWritten, bytesLeft);
 
-            // And update variables
-            bytesWritten += this->bytesPerSector;
+            // Write sector with data to the disk
+            if(this->disk->WriteSector(this->StartLBA + sector + fullSectors, this->readBuffer) != 0) {
+                delete entry->filename;
+                delete entry;
+                return -1;
+            }
+            bytesWritten += bytesLeft;
         }
         
         // No need to clear cluster, will get overwritten
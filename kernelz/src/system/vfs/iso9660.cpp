@@ -282,38 +282,69 @@ uint32_t ISO9660::GetFileSize(const char* path)
     delete entry;
     return len;
 }
-int ISO9660::ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t len)
+bool ISO9660::LookupEntry(const char* path, VFSNode* node)
 {
     DirectoryRecord* entry = GetEntry(path);
+    if(entry == 0)
+        return false;
+    
+    node->location = entry->extent_location;
+    node->isDirectory = GetEntryType(entry) == Iso_Directory;
+    node->size = node->isDirectory ? 0 : entry->data_length;
 
-    if(entry == 0 || GetEntryType(entry) == Iso_Directory) {
-        if(entry != 0) delete entry;
+    delete entry;
+    return true;
+}
+int ISO9660::ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t len)
+{
+    VFSNode node;
+    if(!LookupEntry(path, &node))
+        return -1;
+    
+    return ReadNode(&node, buffer, offset, len);
+}
+int ISO9660::ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset, uint32_t len)
+{
+    if(node->isDirectory)
         return -1;
-    }
 
-    if(len == (uint32_t)-1)
-        len = entry->data_length;
+    uint32_t fileSize = node->size;
+    uint32_t sector = node->location + offset / CDROM_SECTOR_SIZE;
 
-    //TODO: Actually implement partial file reading, for now we read the whole file
-    int sectorCount = entry->data_length / CDROM_SECTOR_SIZE;
-    int dataRemainder = entry->data_length % CDROM_SECTOR_SIZE;
+    if(offset >= fileSize)
+        return 0;
+    if(len > fileSize - offset)
+        len = fileSize - offset;
+    offset = offset % CDROM_SECTOR_SIZE;
 
-    for(int i = 0; i < sectorCount; i++)
-        if(this->disk->ReadSector(entry->extent_location + i, buffer + (CDROM_SECTOR_SIZE * i)) != 0) {
-            delete entry;
+    // Files are stored in one extent, so all complete sectors can be read with one request
+    if(offset > 0) {
+        if(this->disk->ReadSector(sector, readBuffer) != 0)
             return -1;
-        }
+        
+        uint32_t part = CDROM_SECTOR_SIZE - offset;
+        if(part > len)
+            part = len;
+        MemoryOperations::memcpy(buffer, readBuffer + offset, part);
+
+        buffer += part;
+        len -= part;
+        sector++;
+    }
+
+    uint32_t sectorCount = len / CDROM_SECTOR_SIZE;
+    uint32_t dataRemainder = len % CDROM_SECTOR_SIZE;
+
+    if(sectorCount > 0 && this->disk->ReadSectors(sector, sectorCount, buffer) != 0)
+        return -1;
     
     if(dataRemainder > 0) //We have a remainder
     {
-        if(this->disk->ReadSector(entry->extent_location + sectorCount, readBuffer) != 0) {
-            delete entry;
+        if(this->disk->ReadSector(sector + sectorCount, readBuffer) != 0)
             return -1;
-        }
         MemoryOperations::memcpy(buffer + (sectorCount*CDROM_SECTOR_SIZE), readBuffer, dataRemainder);
     }
     
-    delete entry;
     return 0;
 }
 int ISO9660::WriteFile(const char* path, uint8_t* buffer, uint32_t len, bool create)
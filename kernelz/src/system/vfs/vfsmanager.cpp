@@ -1,5 +1,6 @@
 #include <system/vfs/vfsmanager.h>
 #include <system/system.h>
+#include <system/memory/pagecache.h>
 
 using namespace HeisenOs;
 using namespace HeisenOs::common;
@@ -9,6 +10,9 @@ using namespace HeisenOs::system;
 VFSManager::VFSManager()
 {
     this->Filesystems = new List<VirtualFileSystem*>();
+
+    MemoryOperations::memset(this->dentries, 0, sizeof(this->dentries));
+    MemoryOperations::memset(this->dentryHash, 0, sizeof(this->dentryHash));
 }
 
 int VFSManager::ExtractDiskNumber(const char* path, uint8_t* idSizeReturn)
@@ -49,6 +53,114 @@ int VFSManager::ExtractDiskNumber(const char* path, uint8_t* idSizeReturn)
     return -1;
 }
 
+VirtualFileSystem* VFSManager::GetFilesystem(const char* path, const char** fsPath)
+{
+    uint8_t idSize = 0;
+    int disk = ExtractDiskNumber(path, &idSize);
+
+    if(disk != -1 && Filesystems->size() > disk) {
+        *fsPath = path + idSize + 2; // skips the 0:\ part
+        return Filesystems->GetAt(disk);
+    }
+    return 0;
+}
+
+uint32_t VFSManager::HashPath(VirtualFileSystem* fs, const char* path)
+{
+    // FNV-1a of the path, seeded with the filesystem so equal paths on different disks differ
+    uint32_t hash = 2166136261 ^ (uint32_t)fs;
+    while(*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+bool VFSManager::Resolve(VirtualFileSystem* fs, const char* path, VFSNode* node)
+{
+    if(!dentryCacheEnabled)
+        return fs->LookupEntry(path, node);
+
+    uint32_t hash = HashPath(fs, path);
+    uint32_t bucket = hash & (VFS_DENTRY_HASH_SIZE - 1);
+
+    dentryLock.Lock();
+    for(VFSDentry* entry = dentryHash[bucket]; entry != 0; entry = entry->hashNext)
+        if(entry->fs == fs && entry->hash == hash && String::strcmp(entry->path, path)) {
+            *node = entry->node;
+            dentryHits++;
+            dentryLock.Unlock();
+            return true;
+        }
+    dentryMisses++;
+    uint32_t generation = dentryGeneration;
+    dentryLock.Unlock();
+
+    // Walk the directories on disk without holding the lock
+    // Lookups that fail are not remembered, the file might be created later
+    if(!fs->LookupEntry(path, node))
+        return false;
+
+    dentryLock.Lock();
+
+    // The result might be outdated by a write in the meantime, or another thread already added it
+    if(generation != dentryGeneration) {
+        dentryLock.Unlock();
+        return true;
+    }
+    for(VFSDentry* entry = dentryHash[bucket]; entry != 0; entry = entry->hashNext)
+        if(entry->fs == fs && entry->hash == hash && String::strcmp(entry->path, path)) {
+            dentryLock.Unlock();
+            return true;
+        }
+
+    VFSDentry* entry = &dentries[nextDentry];
+    nextDentry = (nextDentry + 1) % VFS_DENTRY_CACHE_SIZE;
+
+    // Remove the entry we are replacing from its bucket
+    if(entry->fs != 0) {
+        VFSDentry** link = &dentryHash[entry->hash & (VFS_DENTRY_HASH_SIZE - 1)];
+        while(*link != entry)
+            link = &(*link)->hashNext;
+        *link = entry->hashNext;
+        delete entry->path;
+    }
+
+    entry->fs = fs;
+    entry->hash = hash;
+    entry->path = new char[String::strlen(path) + 1];
+    String::strcpy(entry->path, path);
+    entry->node = *node;
+    entry->hashNext = dentryHash[bucket];
+    dentryHash[bucket] = entry;
+    dentryLock.Unlock();
+
+    return true;
+}
+
+void VFSManager::InvalidateDentries(VirtualFileSystem* fs)
+{
+    dentryLock.Lock();
+    dentryGeneration++;
+    for(int i = 0; i < VFS_DENTRY_HASH_SIZE; i++)
+    {
+        VFSDentry** link = &dentryHash[i];
+        while(*link != 0) {
+            VFSDentry* entry = *link;
+            if(fs == 0 || entry->fs == fs) {
+                *link = entry->hashNext;
+                delete entry->path;
+                entry->path = 0;
+                entry->fs = 0;
+                entry->hashNext = 0;
+            }
+            else
+                link = &entry->hashNext;
+        }
+    }
+    dentryLock.Unlock();
+}
+
 void VFSManager::Mount(VirtualFileSystem* vfs)
 {
     this->Filesystems->push_back(vfs); //Just add it to the list of known filesystems, easy.
@@ -56,6 +168,15 @@ void VFSManager::Mount(VirtualFileSystem* vfs)
 void VFSManager::Unmount(VirtualFileSystem* vfs)
 {
     this->Filesystems->Remove(vfs);
+    InvalidateDentries(vfs);
+    PageCache::Invalidate(vfs);
+
+    // Reads from files that are still open on this filesystem will fail from now on
+    openFilesLock.Lock();
+    for(VFSOpenFile* file : openFiles)
+        if(file->fs == vfs)
+            file->fs = 0;
+    openFilesLock.Unlock();
 }
 void VFSManager::UnmountByDisk(Disk* disk)
 {
@@ -132,23 +253,30 @@ List<LIBHeisenKernel::VFSEntry>* VFSManager::DirectoryList(const char* path)
 
 uint32_t VFSManager::GetFileSize(const char* path)
 {
-    uint8_t idSize = 0;
-    int disk = ExtractDiskNumber(path, &idSize);
-    if(disk != -1 && Filesystems->size() > disk)
-        return Filesystems->GetAt(disk)->GetFileSize(path + idSize + 2); // skips the 0:\ part
-    else
+    const char* fsPath = 0;
+    VirtualFileSystem* fs = GetFilesystem(path, &fsPath);
+    if(fs == 0)
         return -1;
+
+    VFSNode node;
+    if(!Resolve(fs, fsPath, &node))
+        return fs->GetFileSize(fsPath); // Let the filesystem decide what to return for missing files
+    
+    return node.isDirectory ? -1 : node.size;
 }
 
 int VFSManager::ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t len)
 {
-    uint8_t idSize = 0;
-    int disk = ExtractDiskNumber(path, &idSize);
+    const char* fsPath = 0;
+    VirtualFileSystem* fs = GetFilesystem(path, &fsPath);
+    if(fs == 0)
+        return -1;
 
-    if(disk != -1 && Filesystems->size() > disk)
-        return Filesystems->GetAt(disk)->ReadFile(path + idSize + 2, buffer, offset, len);
-    else
+    VFSNode node;
+    if(!Resolve(fs, fsPath, &node))
         return -1;
+
+    return fs->ReadNode(&node, buffer, offset, len);
 }
 
 int VFSManager::WriteFile(const char* path, uint8_t* buffer, uint32_t len, bool create)
@@ -156,36 +284,51 @@ int VFSManager::WriteFile(const char* path, uint8_t* buffer, uint32_t len, bool
     uint8_t idSize = 0;
     int disk = ExtractDiskNumber(path, &idSize);
 
-    if(disk != -1 && Filesystems->size() > disk)
-        return Filesystems->GetAt(disk)->WriteFile(path + idSize + 2, buffer, len, create);
+    if(disk != -1 && Filesystems->size() > disk) {
+        VirtualFileSystem* fs = Filesystems->GetAt(disk);
+        const char* fsPath = path + idSize + 2;
+        int ret = fs->WriteFile(fsPath, buffer, len, create);
+        
+        // Size and start cluster of the file might have changed
+        InvalidateDentries(fs);
+        PageCache::Invalidate(fs);
+
+        // Files that are still open should read the new data as well
+        openFilesLock.Lock();
+        for(VFSOpenFile* file : openFiles)
+            if(file->fs == fs && String::strcmp(file->path, fsPath))
+                if(!fs->LookupEntry(fsPath, &file->node))
+                    file->fs = 0;
+        openFilesLock.Unlock();
+        return ret;
+    }
     else
         return -1;
 }
 
 bool VFSManager::FileExists(const char* path)
 {
-    uint8_t idSize = 0;
-    int disk = ExtractDiskNumber(path, &idSize);
-
-    if(disk != -1 && Filesystems->size() > disk)
-        return Filesystems->GetAt(disk)->FileExists(path + idSize + 2);
-    else
+    const char* fsPath = 0;
+    VirtualFileSystem* fs = GetFilesystem(path, &fsPath);
+    if(fs == 0)
         return false;
+
+    VFSNode node;
+    return Resolve(fs, fsPath, &node) && !node.isDirectory;
 } 
 
 bool VFSManager::DirectoryExists(const char* path)
 {
-    uint8_t idSize = 0;
-    int disk = ExtractDiskNumber(path, &idSize);
-
-    if(disk != -1 && Filesystems->size() > disk) {
-        if(String::strlen(path) == idSize + 2) //Only disk part, like 0:\ ofcourse this is a directory as well
-            return true;
-        else
-            return Filesystems->GetAt(disk)->DirectoryExists(path + idSize + 2);
-    }
-    else
+    const char* fsPath = 0;
+    VirtualFileSystem* fs = GetFilesystem(path, &fsPath);
+    if(fs == 0)
         return false;
+    
+    if(*fsPath == '\0') //Only disk part, like 0:\ ofcourse this is a directory as well
+        return true;
+
+    VFSNode node;
+    return Resolve(fs, fsPath, &node) && node.isDirectory;
 }
 
 int VFSManager::CreateFile(const char* path)
@@ -224,8 +367,128 @@ bool VFSManager::EjectDrive(const char* path)
 
     if(disk != -1 && Filesystems->size() > disk) {
         VirtualFileSystem* fs = Filesystems->GetAt(disk);
+
+        // Write pending changes and forget the cached blocks, the media could be replaced
+        BlockCache::Flush(fs->disk);
+        BlockCache::Invalidate(fs->disk);
+        InvalidateDentries(fs);
+        PageCache::Invalidate(fs);
         return fs->disk->controller->EjectDrive(fs->disk->controllerIndex);
     }
     else
         return false;
+}
+
+VFSOpenFile* VFSManager::OpenFile(const char* path)
+{
+    const char* fsPath = 0;
+    VirtualFileSystem* fs = GetFilesystem(path, &fsPath);
+    if(fs == 0)
+        return 0;
+
+    VFSNode node;
+    if(!Resolve(fs, fsPath, &node) || node.isDirectory)
+        return 0;
+
+    VFSOpenFile* file = new VFSOpenFile();
+    file->fs = fs;
+    file->path = new char[String::strlen(fsPath) + 1];
+    String::strcpy(file->path, fsPath);
+    file->node = node;
+    file->position = 0;
+
+    openFilesLock.Lock();
+    openFiles.push_back(file);
+    openFilesLock.Unlock();
+    return file;
+}
+
+int VFSManager::ReadOpenFile(VFSOpenFile* file, uint8_t* buffer, uint32_t len, uint32_t offset)
+{
+    if(file->fs == 0)
+        return -1;
+    
+    bool usePosition = (offset == (uint32_t)-1);
+    if(usePosition)
+        offset = file->position;
+
+    if(offset >= file->node.size)
+        return 0;
+    if(len > file->node.size - offset)
+        len = file->node.size - offset;
+
+    if(file->fs->ReadNode(&file->node, buffer, offset, len) != 0)
+        return -1;
+    
+    if(usePosition)
+        file->position += len;
+    return len;
+}
+
+void VFSManager::CloseFile(VFSOpenFile* file)
+{
+    openFilesLock.Lock();
+    openFiles.Remove(file);
+    openFilesLock.Unlock();
+    delete[] file->path;
+    delete file;
+}
+
+void VFSManager::Benchmark()
+{
+    uint8_t* buffer = new uint8_t[VFS_BENCHMARK_CHUNK];
+
+    for(int i = 0; i < Filesystems->size(); i++)
+    {
+        VirtualFileSystem* fs = Filesystems->GetAt(i);
+        uint32_t fileSize = fs->GetFileSize(VFS_BENCHMARK_FILE);
+        if(fileSize == 0 || fileSize == (uint32_t)-1)
+            continue;
+        
+        // Read the file in chunks, the kernel heap is too small to hold it at once
+        uint64_t start = System::pit->Ticks();
+        for(uint32_t offset = 0; offset < fileSize; offset += VFS_BENCHMARK_CHUNK)
+            if(fs->ReadFile(VFS_BENCHMARK_FILE, buffer, offset, VFS_BENCHMARK_CHUNK) != 0) {
+                Log(Error, "VFS Benchmark: Error reading %s at %d", VFS_BENCHMARK_FILE, offset);
+                break;
+            }
+        uint32_t ms = (uint32_t)(System::pit->Ticks() - start);
+        if(ms == 0)
+            ms = 1;
+
+        Log(Info, "VFS Benchmark: %s on %s (%s) read %d KB in %d ms, %d KB/s", VFS_BENCHMARK_FILE, fs->disk->identifier ? fs->disk->identifier : "disk", fs->Name, fileSize / 1_KB, ms, (fileSize / 1_KB) * 1000 / ms);
+    }
+
+    // Lookup benchmark, stat and read the first 4KB of a file deep in the directory tree
+    // Once without and once with the dentry cache
+    char* path = new char[String::strlen(VFS_BENCHMARK_DEEP_FILE) + 8];
+    for(int i = 0; i < Filesystems->size(); i++)
+    {
+        char* idStr = Convert::IntToString(i);
+        String::strcpy(path, idStr);
+        String::strcpy(path + String::strlen(idStr), ":\\" VFS_BENCHMARK_DEEP_FILE);
+
+        if(!FileExists(path))
+            continue;
+
+        for(int cached = 0; cached < 2; cached++)
+        {
+            dentryCacheEnabled = cached;
+            uint32_t hits = dentryHits;
+
+            uint64_t start = System::pit->Ticks();
+            for(int n = 0; n < VFS_BENCHMARK_LOOKUPS; n++)
+                if(GetFileSize(path) == (uint32_t)-1 || ReadFile(path, buffer, 0, 4_KB) != 0) {
+                    Log(Error, "VFS Benchmark: Error reading %s", path);
+                    break;
+                }
+            uint32_t ms = (uint32_t)(System::pit->Ticks() - start);
+
+            Log(Info, "VFS Benchmark: %d lookups of %s %s dentry cache took %d ms (%d hits)", VFS_BENCHMARK_LOOKUPS, path, cached ? "with" : "without", ms, dentryHits - hits);
+        }
+        dentryCacheEnabled = true;
+    }
+    delete path;
+
+    delete buffer;
 }
\ No newline at end of file
@@ -28,6 +28,16 @@ int VirtualFileSystem::ReadFile(const char* filename, uint8_t* buffer, uint32_t
     Log(Error, "Virtual function called directly %s:%d", __FILE__, __LINE__);
     return -1;
 }
+bool VirtualFileSystem::LookupEntry(const char* path, VFSNode* node)
+{
+    Log(Error, "Virtual function called directly %s:%d", __FILE__, __LINE__);
+    return false;
+}
+int VirtualFileSystem::ReadNode(const VFSNode* node, uint8_t* buffer, uint32_t offset, uint32_t len)
+{
+    Log(Error, "Virtual function called directly %s:%d", __FILE__, __LINE__);
+    return -1;
+}
 int VirtualFileSystem::WriteFile(const char* filename, uint8_t* buffer, uint32_t len, bool create)
 {
     Log(Error, "Virtual function called directly %s:%d", __FILE__, __LINE__);
@@ -2,6 +2,7 @@
 #define __LIBCACTUSOS__BITREADER_H
 
 #include <types.h>
+#include <string.h>
 
 namespace LIBHeisenKernel
 {
@@ -10,50 +11,80 @@ namespace LIBHeisenKernel
     {
     private:
         uint8_t* dataPtr = 0;
+        uint32_t size = 0;
         uint32_t pos = 0;
-        uint8_t  byte = 0;
+
+        // Bits that are read from the data but not used yet, the next bit is the lowest one
+        uint64_t bitBuffer = 0;
         uint32_t numBits = 0;
+
+        // Fill the bit buffer with as many whole bytes as possible
+        void Refill()
+        {
+            if(this->pos + 8 <= this->size) {
+                // Load 8 bytes at once, the bits above numBits are the same bytes again on the next refill
+                this->bitBuffer |= *(uint64_t*)(this->dataPtr + this->pos) << this->numBits;
+                uint32_t bytes = (63 - this->numBits) / 8;
+                this->pos += bytes;
+                this->numBits += bytes * 8;
+                return;
+            }
+
+            // Near the end of the data, reading past the end gives zero's
+            while(this->numBits <= 56) {
+                uint64_t b = (this->pos < this->size) ? this->dataPtr[this->pos] : 0;
+                this->bitBuffer |= b << this->numBits;
+                this->pos += 1;
+                this->numBits += 8;
+            }
+        }
     public:
-        BitReader(uint8_t* data)
+        BitReader(uint8_t* data, uint32_t size = 0xFFFFFFFF)
         {
             this->dataPtr = data;
+            this->size = size;
             this->pos = 0;
-            this->byte = 0;
+            this->bitBuffer = 0;
             this->numBits = 0;
         }
 
+        // Look at the next n bits without using them, n can be at most 32
+        uint32_t PeekBits(uint32_t n)
+        {
+            if(this->numBits < n)
+                this->Refill();
+
+            return (uint32_t)(this->bitBuffer & ((1ULL << n) - 1));
+        }
+
+        // Skip n bits that are already peeked
+        void ConsumeBits(uint32_t n)
+        {
+            this->bitBuffer >>= n;
+            this->numBits -= n;
+        }
+
         // Read single byte
         uint8_t ReadByte()
         {
             // Discard other bits
-            this->numBits = 0;
-            uint8_t b = this->dataPtr[this->pos];
-            this->pos += 1;
-            return b;
+            this->ConsumeBits(this->numBits % 8);
+            return (uint8_t)this->ReadBits<uint32_t>(8);
         }
 
         // Read single bit
         uint8_t ReadBit()
         {
-            if(this->numBits <= 0) {
-                this->byte = this->ReadByte();
-                this->numBits = 8;
-            }
-            this->numBits -= 1;
-            uint8_t bit = this->byte & 1;
-            this->byte >>= 1;
-            return bit;
+            return this->ReadBits<uint8_t>(1);
         }
 
         // Read bits as type
         template<typename T>
         T ReadBits(uint32_t n)
         {
-            T ret = 0;
-            for(uint32_t i = 0; i < n; i++)
-                ret |= (this->ReadBit() << i);
-            
-            return ret;            
+            T ret = (T)this->PeekBits(n);
+            this->ConsumeBits(n);
+            return ret;
         }
 
         // Read bytes as type
@@ -63,10 +94,31 @@ namespace LIBHeisenKernel
             T ret = 0;
             for(uint32_t i = 0; i < n; i++)
                 ret |= (this->ReadByte() << (i*8));
-            
+
             return ret;
         }
+
+        // Copy n bytes to dest, starting at the next whole byte
+        void ReadAlignedBytes(uint8_t* dest, uint32_t n)
+        {
+            // Bytes that are already in the bit buffer
+            while(n > 0 && this->numBits >= 8) {
+                *dest++ = this->ReadByte();
+                n--;
+            }
+            if(n == 0)
+                return;
+
+            // The rest is copied directly from the data
+            this->bitBuffer = 0;
+            this->numBits = 0;
+            uint32_t available = this->pos < this->size ? this->size - this->pos : 0;
+            memcpy(dest, this->dataPtr + this->pos, n < available ? n : available);
+            if(n > available)
+                memset(dest + available, 0, n - available);
+            this->pos += n;
+        }
     };
 }
 
-#endif
\ No newline at end of file
+#endif
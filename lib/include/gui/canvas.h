@@ -36,6 +36,10 @@ namespace LIBHeisenKernel
         void DrawEllipse(uint32_t color, int x_center, int y_center, int x_radius, int y_radius);
 
         void DrawString(Font* font, char* string, int x, int y, uint32_t color);
+
+        // Draw length characters of text on a single line, clipped to the canvas
+        // Returns the x position after the last character
+        int DrawText(Font* font, const char* text, int length, int x, int y, uint32_t color);
     };
 }
 
@@ -70,6 +70,13 @@ namespace LIBHeisenKernel
          * Color2 is foreground
         */
         static const uint32_t AlphaBlend(uint32_t color1, uint32_t color2);
+
+        /**
+         * Blend n foreground pixels from src over the background pixels in bg and store them in dst
+         * Uses SSE2 to blend 4 pixels at once, the library is built with -msse2 so it is always available
+         * dst is allowed to be the same buffer as bg
+        */
+        static void BlendSpan(uint32_t* dst, const uint32_t* bg, const uint32_t* src, uint32_t n);
         
         /**
          * Convert a ARGB color to 0xAARRGGBB format
@@ -5,6 +5,11 @@
 
 namespace LIBHeisenKernel
 {
+    // Number of colors that can be cached for each font
+    #define FONT_GLYPH_CACHES 8
+
+    class GlyphCache;
+
     struct Font
     {
         uint8_t* data           = 0; // Raw font data including header
@@ -12,7 +17,13 @@ namespace LIBHeisenKernel
         int size                = 0; // Size of this font in points
         uint32_t* offsetTable   = 0; // Offsets for each character data sorted by character
 
+        GlyphCache* glyphCaches[FONT_GLYPH_CACHES] = {}; // Glyphs converted to spans for the most recent colors
+        int nextGlyphCache      = 0; // Slot that is replaced when a new color is used
+
         void BoundingBox(char* str, int* retW, int* retH);
+
+        // Get the glyphs of this font for a color, they are created when the color is not cached yet
+        GlyphCache* GetGlyphCache(uint32_t color);
     };
 }
 
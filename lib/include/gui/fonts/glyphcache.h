@@ -0,0 +1,58 @@
+#ifndef __LIBCACTUSOS__GUI__FONTS__GLYPHCACHE_H
+#define __LIBCACTUSOS__GUI__FONTS__GLYPHCACHE_H
+
+#include <types.h>
+#include <gui/fonts/font.h>
+
+namespace LIBHeisenKernel
+{
+    #define GLYPH_FIRST_CHAR 32
+    #define GLYPH_COUNT (127 - GLYPH_FIRST_CHAR)
+
+    enum GlyphSpanType : uint8_t
+    {
+        GlyphSkip,      // Pixels where the glyph is fully transparent
+        GlyphOpaque,    // Pixels that are filled with the color
+        GlyphBlend      // Pixels that are blended, the colors are stored in the pixel table
+    };
+
+    // A run of pixels with the same type inside one row of a glyph
+    struct GlyphSpan
+    {
+        uint8_t type;
+        uint8_t length;
+    } __attribute__((packed));
+
+    // Start of the spans and blended pixels of a single glyph row
+    struct GlyphRow
+    {
+        uint32_t firstSpan;
+        uint32_t firstPixel;
+    };
+
+    struct GlyphInfo
+    {
+        uint8_t width;
+        uint8_t height;
+        uint32_t firstRow; // Index in the row table, there are height+1 entries so the end of each row is known
+    };
+
+    // Pre-classified glyphs of a font drawn with one color
+    // The glyph data of the font is converted once into spans so drawing text does not need to look at every pixel
+    class GlyphCache
+    {
+    public:
+        uint32_t color = 0;
+        uint8_t maxHeight = 0;
+
+        GlyphInfo glyphs[GLYPH_COUNT];
+        GlyphRow* rows = 0;
+        GlyphSpan* spans = 0;
+        uint32_t* pixels = 0;
+
+        GlyphCache(Font* font, uint32_t color);
+        ~GlyphCache();
+    };
+}
+
+#endif
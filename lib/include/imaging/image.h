@@ -14,7 +14,8 @@ namespace LIBHeisenKernel
         enum ResizeMethod
         {
             NearestNeighbor,
-            Bilinear
+            Bilinear,
+            Box // Average of all source pixels below the destination pixel, best for downscaling
         };
 
         class Image
@@ -55,6 +56,7 @@ namespace LIBHeisenKernel
         private:
             static Image* ResizeNearestNeighbor(Image* source, int newWidth, int newHeight);
             static Image* ResizeBilinear(Image* source, int newWidth, int newHeight);
+            static Image* ResizeBox(Image* source, int newWidth, int newHeight);
         };
     }
 }
@@ -33,10 +33,10 @@ namespace LIBHeisenKernel
         class PNGDecoder
         {
         private:
-            static uint8_t PaethPredictor(uint8_t* recon, uint8_t a, uint8_t b, uint8_t c);
-            static uint8_t Recon_a(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c);
-            static uint8_t Recon_b(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c);
-            static uint8_t Recon_c(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c);
+            static uint8_t PaethPredictor(uint8_t a, uint8_t b, uint8_t c);
+
+            // Reverse the filter of one row and store it as ARGB pixels in out, prev is the previous output row
+            static bool UnfilterRow(uint8_t filterType, const uint8_t* filt, const uint8_t* prev, uint8_t* out, uint32_t width);
         public:
             // Convert image file into image buffer
             static Image* Convert(const char* filepath);
@@ -45,100 +45,92 @@ namespace LIBHeisenKernel
             static Image* ConvertRAW(const uint8_t* rawData);
         };
 
-        // Represents a single node in the huffman tree
-        class HuffmanNode
+        // Amount of bits used for the first level of a huffman lookup table
+        #define HUFFMAN_PRIMARY_BITS 9
+        // Set on a primary entry that points to a part of the overflow table
+        #define HUFFMAN_OVERFLOW (1 << 24)
+        // Symbol for bit patterns that are not a valid code
+        #define HUFFMAN_INVALID 0xFFFF
+
+        // Lookup table used to decode a huffman code with one or two table reads
+        // Entries hold the symbol in the low 16 bits and the length of the code in bits 16-23
+        // Codes longer than HUFFMAN_PRIMARY_BITS continue in the overflow table
+        class HuffmanTable
         {
         public:
-            uint32_t symbol = 0;
-            HuffmanNode* left = 0;
-            HuffmanNode* right = 0;
+            uint32_t primary[1 << HUFFMAN_PRIMARY_BITS];
+            uint32_t* overflow = 0;
+            uint32_t overflowBits = 0;
 
-            HuffmanNode()
+            ~HuffmanTable()
             {
-                this->symbol = 0;
-                this->left = 0;
-                this->right = 0;
+                if(this->overflow)
+                    delete[] this->overflow;
             }
         };
-        class HuffmanTree
-        {
-        private:
-            void DeleteNode(HuffmanNode* node)
-            {
-                if(node->left) DeleteNode(node->left);
-                if(node->right) DeleteNode(node->right);
-                delete node;
-            }
-        public:
-            HuffmanNode* root = 0;
 
-            HuffmanTree()
-            {
-                this->root = new HuffmanNode();
-            }
-            ~HuffmanTree()
-            {
-                this->DeleteNode(this->root);
-            }
-            void Insert(uint32_t codeWord, uint32_t n, uint32_t symbol)
-            {
-                HuffmanNode* node = this->root;
-                HuffmanNode* nextNode = 0;
-                for(int i = n - 1; i >= 0; i--) {
-                    uint32_t b = codeWord & (1 << i);
-                    if(b) {
-                        nextNode = node->right;
-                        if(nextNode == 0) {
-                            node->right = new HuffmanNode();
-                            nextNode = node->right;
-                        }
-                    }
-                    else {
-                        nextNode = node->left;
-                        if(nextNode == 0) {
-                            node->left = new HuffmanNode();
-                            nextNode = node->left;
-                        }
-                    }
-                    node = nextNode;
-                }
-                node->symbol = symbol;
-            }
-        };
-
-        struct DecodeTreesResult
-        {
-            HuffmanTree* literalLengthTree;
-            HuffmanTree* distanceTree;
-        };
+        // Amount of earlier output a back-reference can point to
+        #define ZLIB_WINDOW_SIZE 32_KB
+        // Longest back-reference
+        #define ZLIB_MAX_MATCH 258
 
         // Class used to decompress ZLIB data such as png and zip files
+        // The data is decompressed while it is read, so only the last part of the output is kept in memory
         class ZLIBDecompressor
         {
         private:
-            // Reads data from a non compression block
-            static void InflateBlockNoCompression(BitReader* reader, Vector<uint8_t>* target);
-            
-            // Reads data from dynamic block
-            static void InflateBlockDynamic(BitReader* reader, Vector<uint8_t>* target);
+            BitReader reader;
+
+            // Output that is still needed, either by the caller or for back-references
+            uint8_t* window = 0;
+            uint32_t windowCapacity = 0;
+            uint32_t windowSize = 0;
+
+            // Offset in window of the first byte that is not read yet
+            uint32_t readPos = 0;
+
+            // Current state of the decompression
+            bool headerDone = false;
+            bool inBlock = false;
+            bool lastBlock = false;
+            bool error = false;
+            uint8_t blockType = 0;
+            uint32_t storedRemaining = 0;
+
+            // Tables of the current block
+            HuffmanTable* literalLengthTable = 0;
+            HuffmanTable* distanceTable = 0;
+
+            // Check the zlib header
+            bool ReadHeader();
+
+            // Read the header of the next block
+            bool StartBlock();
+
+            // Decompress the current block until n bytes are available or the block ends
+            bool InflateBlock(uint32_t n);
 
-            // Reads data from static block
-            static void InflateBlockStatic(BitReader* reader, Vector<uint8_t>* target);
+            // Remove the output that is not needed anymore from the start of the window
+            void Compact();
 
-            // Decodes one symbol from bitstream using a HuffmanTree
-            static uint32_t DecodeSymbol(BitReader* reader, HuffmanTree* tree);
+            // Delete the tables of a dynamic block
+            void FreeTables();
 
-            static void InflateBlockData(BitReader* reader, HuffmanTree* literalLengthTree, HuffmanTree* distanceTree, Vector<uint8_t>* target);
+            // Decodes one symbol from bitstream using a HuffmanTable
+            static uint32_t DecodeSymbol(BitReader* reader, HuffmanTable* table);
 
-            static HuffmanTree* BitListToTree(Vector<uint32_t>* bitList, Vector<uint8_t>* alphabet);
+            // Fill the lookup table for the code lengths of count symbols, returns false when the lengths are not a valid code
+            static bool BuildTable(HuffmanTable* table, const uint8_t* lengths, uint32_t count);
         
-            static DecodeTreesResult DecodeTrees(BitReader* reader);
+            static bool DecodeTables(BitReader* reader, HuffmanTable* literalLengthTable, HuffmanTable* distanceTable);
         public:
-            // Perform decompression on input and return the complete set of data
-            static Vector<uint8_t>* Decompress(uint8_t* input);
+            // Create a decompressor for input, maxRead is the largest amount of bytes requested with one Read call
+            ZLIBDecompressor(uint8_t* input, uint32_t inputSize, uint32_t maxRead);
+            ~ZLIBDecompressor();
 
-            // Perform the actual inflation of the DEFLATE block
-            static Vector<uint8_t>* Inflate(BitReader* reader);
+            // Decompress the next n bytes and return a pointer to them
+            // The pointer is valid until the next call, returns 0 on errors or when the data ends
+            uint8_t* Read(uint32_t n);
         };
     }
 }
@@ -1,6 +1,8 @@
 #ifndef __LIBCACTUSOS__IPC_H
 #define __LIBCACTUSOS__IPC_H
 
+#include "types.h"
+
 namespace LIBHeisenKernel
 {
     enum IPCMessageType : int
@@ -45,6 +47,70 @@ namespace LIBHeisenKernel
      * FromID: Only receive a message from specified process
     */
     IPCMessage ICPReceive(int fromID = -1, int* errOut = 0, int type = -1);
+
+    /**
+     * Block until the word at address no longer contains expected or until FutexWake is called for it
+     * Works across processes when address is part of shared memory
+    */
+    int FutexWait(volatile uint32_t* address, uint32_t expected);
+    /**
+     * Wake up to count threads blocked in FutexWait on address, returns the number of threads woken
+    */
+    int FutexWake(volatile uint32_t* address, int count = 1);
+
+    // Placed at the start of the shared memory used by an IPCChannel
+    struct IPCChannelHeader
+    {
+        volatile uint32_t head; // Messages written by the producer
+        volatile uint32_t tail; // Messages read by the consumer
+
+        // Set when a side is (about to be) blocked, so the other side knows it needs to wake it
+        volatile uint32_t consumerWaiting;
+        volatile uint32_t producerWaiting;
+
+        // Number of message slots after the header, always a power of 2
+        uint32_t capacity;
+    };
+
+    /**
+     * Single producer, single consumer message queue in memory shared between two processes
+     * Messages are passed without any systemcalls, only a blocked side is woken up using FutexWake
+    */
+    class IPCChannel
+    {
+    private:
+        IPCChannelHeader* header;
+        IPCMessage* slots;
+    public:
+        /**
+         * Use size bytes of shared memory at region as a channel
+         * Only one of the processes should initialize it, before the other side uses it
+        */
+        IPCChannel(void* region, uint32_t size, bool initialize);
+
+        /**
+         * Add a message to the channel, returns false when it is full
+        */
+        bool TrySend(const IPCMessage& message);
+        /**
+         * Add a message to the channel, blocks while it is full
+        */
+        void Send(const IPCMessage& message);
+
+        /**
+         * Take the next message from the channel, returns false when it is empty
+        */
+        bool TryReceive(IPCMessage* message);
+        /**
+         * Take the next message from the channel, blocks while it is empty
+        */
+        IPCMessage Receive();
+
+        /**
+         * How many messages are ready for receiving?
+        */
+        int Available();
+    };
 }
 
 #endif
\ No newline at end of file
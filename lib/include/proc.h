@@ -73,6 +73,12 @@ namespace LIBHeisenKernel
          * Read a byte from this processes standard input stream
         */
         static char ReadStdIn();
+        /**
+         * Read up to length bytes from this processes standard input stream
+         * Blocks until at least one byte is available, returns the amount of bytes read
+         * Returns 0 when nothing is available and the process writing to it has exited
+        */
+        static int ReadStdIn(char* buffer, int length);
         /**
          * How many bytes can be read from the stdin stream? 
         */
@@ -93,6 +99,14 @@ namespace LIBHeisenKernel
          * Dissable or enable kernel scheduler
         */
         static void SetScheduler(bool active);
+        /**
+         * Change the priority of a thread of this process, by default of the thread calling this
+        */
+        static bool SetPriority(int priority, int procPID = -1, int thread = 0);
+        /**
+         * Milliseconds passed since the kernel started loading this process
+        */
+        static int TimeSinceLaunch();
     };
 }
 
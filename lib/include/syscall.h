@@ -7,6 +7,21 @@ namespace LIBHeisenKernel
     #define SYSCALL_RET_ERROR 0
     #define PROC_ARG_LEN_MAX 100
 
+    // Passed as first argument of SYSCALL_SET_SCHEDULER to change the priority of a thread instead of (de)activating the scheduler
+    #define SCHEDULER_SET_PRIORITY 2
+
+    // Thread priorities, a higher priority thread is picked first and gets a longer time slice
+    #define PROC_PRIORITY_IDLE 0
+    #define PROC_PRIORITY_LOW 1
+    #define PROC_PRIORITY_NORMAL 3
+    #define PROC_PRIORITY_HIGH 5
+    #define PROC_PRIORITY_HIGHEST 7
+
+    // Origin used by SYSCALL_SEEK_FILE
+    #define VFS_SEEK_SET 0
+    #define VFS_SEEK_CUR 1
+    #define VFS_SEEK_END 2
+
     enum Systemcalls {
         SYSCALL_EXIT = 0, // Tells kernel that procces is done and can be removed
 
@@ -29,6 +44,10 @@ namespace LIBHeisenKernel
         SYSCALL_CREATE_FILE,
         SYSCALL_CREATE_DIRECTORY,
         SYSCALL_EJECT_DISK,
+        SYSCALL_OPEN_FILE,
+        SYSCALL_READ_OPEN_FILE,
+        SYSCALL_SEEK_FILE,
+        SYSCALL_CLOSE_FILE,
 
         //////////////
         // GUI
@@ -68,6 +87,8 @@ namespace LIBHeisenKernel
         SYSCALL_IPC_SEND,
         SYSCALL_IPC_RECEIVE,
         SYSCALL_IPC_AVAILABLE,
+        SYSCALL_FUTEX_WAIT,
+        SYSCALL_FUTEX_WAKE,
 
         //////////////
         // Clock
@@ -4,6 +4,7 @@
 #include <types.h>
 #include <list.h>
 #include <shared.h>
+#include <syscall.h>
 
 namespace LIBHeisenKernel
 {
@@ -30,6 +31,18 @@ namespace LIBHeisenKernel
 
     // Request to eject a specific disk (only works for CD's at the moment, TODO: usb as well?)
     bool EjectDisk(char* path);
+
+    // Open a file for reading, returns a file descriptor or -1 when the file does not exist
+    // The path is only resolved once, so this is faster than ReadFile for repeated reads
+    int OpenFile(char* path);
+    // Read from an open file at offset, or at the current position when no offset is given
+    // Returns the number of bytes read or -1 on error
+    int ReadFromFile(int fd, uint8_t* buffer, uint32_t len, uint32_t offset = -1);
+    // Change the current position of an open file, whence is one of VFS_SEEK_SET/CUR/END
+    // Returns the new position or -1 on error
+    int SeekFile(int fd, int offset, int whence = VFS_SEEK_SET);
+    // Close a file descriptor returned by OpenFile
+    bool CloseFile(int fd);
 }
 
 #endif
\ No newline at end of file
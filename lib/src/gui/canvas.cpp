@@ -2,6 +2,7 @@
 #include <string.h>
 #include <math.h>
 #include <gui/colors.h>
+#include <gui/fonts/glyphcache.h>
 
 using namespace LIBHeisenKernel;
 
@@ -242,54 +243,86 @@ void Canvas::DrawString(Font* font, char* string, int x, int y, uint32_t color)
 {
     if(font == 0 || string == 0 || color == Colors::Transparent)
         return;
-    
-    int xOffset = x;
-    int yOffset = y;
-    while(*string)
+
+    // Draw the string line by line
+    while(true)
     {
-        // Get the character we need to draw for this string
-        char c = *string++;
+        int length = 0;
+        while(string[length] && string[length] != '\n')
+            length++;
+
+        this->DrawText(font, string, length, x, y, color);
+        if(string[length] == 0)
+            break;
 
-        // Check for newline
-        if(c == '\n') {
-            xOffset = x;
+        // Add the height of the space character. TODO: Update this!
+        y += ((uint8_t*)(font->data + font->offsetTable[0]))[1];
+        string += length + 1;
+    }
+}
+int Canvas::DrawText(Font* font, const char* text, int length, int x, int y, uint32_t color)
+{
+    if(font == 0 || text == 0 || color == Colors::Transparent)
+        return x;
+
+    GlyphCache* cache = font->GetGlyphCache(color);
+    if(cache == 0)
+        return x;
+
+    // Rows of the glyphs that are inside the canvas, the same for every character
+    const int rowStart = y < 0 ? -y : 0;
+    const int rowEnd = Math::Min(cache->maxHeight, this->Height - y);
+    const uint32_t opaque = 0xFF000000 | cache->color;
+
+    for(int i = 0; i < length; i++)
+    {
+        int index = (uint8_t)text[i] - GLYPH_FIRST_CHAR;
+        if(index < 0 || index >= GLYPH_COUNT)
+            continue; // No glyph for this character
 
-            // Add the height of the space character. TODO: Update this!
-            yOffset += ((uint8_t*)(font->data + font->offsetTable[0]))[1];
+        const GlyphInfo* glyph = &cache->glyphs[index];
+        const int glyphX = x;
+        x += glyph->width;
+
+        // Glyphs outside of the canvas only advance the position
+        if(rowStart >= rowEnd || x <= 0 || glyphX >= this->Width)
             continue;
-        }
 
-        // Load data for this char from the font
-        const uint8_t* charData = (uint8_t*)(font->data + font->offsetTable[(int)c - 32]);
-        const uint8_t width = charData[0];
-        const uint8_t height = charData[1];
-
-        // Loop through the complete bitmap and draw the character
-        for(uint8_t px = 0; px < width; px++) {
-            for(uint8_t py = 0; py < height; py++) {
-                // Can be any value between 0 and 255
-                uint8_t d = charData[py * width + px + 2];
-                
-                // This pixel does not need to be drawn
-                if(d == 0)
-                    continue;
-
-                // This is a full color pixel
-                if(d == 255)
-                    this->SetPixel(px + xOffset, py + yOffset, color);
-                // We need to blend this pixel with the background
-                else {
-                    Color4 realColor;
-                    realColor.c = color;
-                    realColor.argb.a = d; // Adjust the alpha component of the color. TODO: Also support full transparent text drawing in the future!
-
-                    this->SetPixel(px + xOffset, py + yOffset, Colors::AlphaBlend(this->GetPixel(px + xOffset, py + yOffset), realColor.c));
-                }  
+        // Only glyphs on the left or right edge need clipping per span
+        const bool clipped = glyphX < 0 || x > this->Width;
+        const int glyphRowEnd = Math::Min(glyph->height, rowEnd);
+        for(int py = rowStart; py < glyphRowEnd; py++)
+        {
+            const GlyphRow* row = cache->rows + glyph->firstRow + py;
+            const GlyphSpan* span = cache->spans + row[0].firstSpan;
+            const GlyphSpan* spanEnd = cache->spans + row[1].firstSpan;
+            const uint32_t* src = cache->pixels + row[0].firstPixel;
+            uint32_t* line = (uint32_t*)this->bufferPointer + (y + py) * this->Width;
+
+            for(int px = glyphX; span < spanEnd; px += span->length, span++)
+            {
+                int from = 0;
+                int to = span->length;
+                if(clipped) {
+                    if(px < 0)
+                        from = Math::Min(-px, to);
+                    if(px + to > this->Width)
+                        to = Math::Max(this->Width - px, from);
+                }
+
+                if(span->type == GlyphOpaque) {
+                    for(int n = from; n < to; n++)
+                        line[px + n] = opaque;
+                }
+                else if(span->type == GlyphBlend) {
+                    Colors::BlendSpan(line + px + from, line + px + from, src + from, to - from);
+                    src += span->length;
+                }
             }
         }
-
-        xOffset += width;
     }
+
+    return x;
 }
 void Canvas::DrawCircleHelper(int x, int y, int radius, uint32_t corner, uint32_t color)
 {
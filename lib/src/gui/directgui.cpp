@@ -19,6 +19,7 @@ bool DirectGUI::RequestFramebuffer()
     Log(Info, "This process is requesting a direct framebuffer");
 
     uint32_t addr = SYSTEM_INFO_ADDR /* System Info Area */ - pageRoundUp(GUI::Width * GUI::Height * 4) /* Space needed for FB */ - 4_KB /* 1 page margin */;
+    addr &= ~(4_MB - 1); // Align to 4MB so the kernel can map it using large pages
     bool ret = DoSyscall(SYSCALL_GUI_GETLFB, addr);
     if(ret)
         base = new Canvas((void*)addr, GUI::Width, GUI::Height);
@@ -1,4 +1,5 @@
 #include <gui/fonts/font.h>
+#include <gui/fonts/glyphcache.h>
 
 using namespace LIBHeisenKernel;
 
@@ -49,4 +50,25 @@ void Font::BoundingBox(char* string, int* retW, int* retH)
         *retW = xOffset;
     
     *retH = yOffset;
-}
\ No newline at end of file
+}
+
+GlyphCache* Font::GetGlyphCache(uint32_t color)
+{
+    if(this->data == 0)
+        return 0; // Not initialized
+
+    // The alpha of the text comes from the glyph, so only the rgb part matters
+    color &= 0x00FFFFFF;
+    for(int i = 0; i < FONT_GLYPH_CACHES; i++)
+        if(this->glyphCaches[i] && this->glyphCaches[i]->color == color)
+            return this->glyphCaches[i];
+
+    // Replace the oldest cached color
+    GlyphCache* cache = new GlyphCache(this, color);
+    if(this->glyphCaches[this->nextGlyphCache])
+        delete this->glyphCaches[this->nextGlyphCache];
+
+    this->glyphCaches[this->nextGlyphCache] = cache;
+    this->nextGlyphCache = (this->nextGlyphCache + 1) % FONT_GLYPH_CACHES;
+    return cache;
+}
@@ -0,0 +1,94 @@
+#include <gui/fonts/glyphcache.h>
+
+using namespace LIBHeisenKernel;
+
+// Classify a glyph value, 0 is not drawn and 255 does not need blending
+inline static uint8_t SpanType(uint8_t value)
+{
+    if(value == 0)
+        return GlyphSkip;
+    return value == 0xFF ? GlyphOpaque : GlyphBlend;
+}
+
+GlyphCache::GlyphCache(Font* font, uint32_t color)
+{
+    this->color = color & 0x00FFFFFF;
+
+    // First count how much space is needed for all glyphs
+    uint32_t numRows = 0;
+    uint32_t numSpans = 0;
+    uint32_t numPixels = 0;
+    for(int i = 0; i < GLYPH_COUNT; i++) {
+        const uint8_t* charData = (uint8_t*)(font->data + font->offsetTable[i]);
+        const uint8_t width = charData[0];
+        const uint8_t height = charData[1];
+
+        numRows += height + 1;
+        for(uint8_t py = 0; py < height; py++) {
+            const uint8_t* glyphRow = charData + 2 + py * width;
+            for(uint8_t px = 0; px < width; px++) {
+                uint8_t type = SpanType(glyphRow[px]);
+                if(px == 0 || type != SpanType(glyphRow[px - 1]))
+                    numSpans++;
+                if(type == GlyphBlend)
+                    numPixels++;
+            }
+        }
+    }
+
+    this->rows = new GlyphRow[numRows];
+    this->spans = new GlyphSpan[numSpans];
+    this->pixels = new uint32_t[numPixels];
+
+    // Then convert each row into spans, a skip at the end of a row is left out
+    uint32_t row = 0;
+    uint32_t span = 0;
+    uint32_t pixel = 0;
+    for(int i = 0; i < GLYPH_COUNT; i++) {
+        const uint8_t* charData = (uint8_t*)(font->data + font->offsetTable[i]);
+        const uint8_t width = charData[0];
+        const uint8_t height = charData[1];
+
+        this->glyphs[i].width = width;
+        this->glyphs[i].height = height;
+        this->glyphs[i].firstRow = row;
+        if(height > this->maxHeight)
+            this->maxHeight = height;
+
+        for(uint8_t py = 0; py < height; py++) {
+            const uint8_t* glyphRow = charData + 2 + py * width;
+            this->rows[row].firstSpan = span;
+            this->rows[row].firstPixel = pixel;
+            row++;
+
+            uint8_t px = 0;
+            while(px < width) {
+                uint8_t type = SpanType(glyphRow[px]);
+                uint8_t start = px;
+                while(px < width && SpanType(glyphRow[px]) == type) {
+                    if(type == GlyphBlend)
+                        this->pixels[pixel++] = this->color | ((uint32_t)glyphRow[px] << 24);
+                    px++;
+                }
+
+                if(type == GlyphSkip && px == width)
+                    break;
+                this->spans[span].type = type;
+                this->spans[span].length = px - start;
+                span++;
+            }
+        }
+
+        // End of the last row
+        this->rows[row].firstSpan = span;
+        this->rows[row].firstPixel = pixel;
+        row++;
+    }
+}
+
+GlyphCache::~GlyphCache()
+{
+    delete[] this->rows;
+    delete[] this->spans;
+    delete[] this->pixels;
+}
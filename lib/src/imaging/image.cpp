@@ -149,6 +149,8 @@ Image* Image::Resize(Image* source, int newWidth, int newHeight, ResizeMethod me
             return ResizeNearestNeighbor(source, newWidth, newHeight);
         case Bilinear:
             return ResizeBilinear(source, newWidth, newHeight);
+        case Box:
+            return ResizeBox(source, newWidth, newHeight);
     }
     return source;
 }
@@ -156,89 +158,291 @@ Image* Image::Resize(Image* source, int newWidth, int newHeight, ResizeMethod me
 ///////////
 // Resize Implementations
 ///////////
-// http://jankristanto.com/info/nearest-neighbor-interpolation-for-resize-image/
+typedef char PixelBytes __attribute__((vector_size(16)));
+typedef short PixelWords __attribute__((vector_size(16)));
+typedef unsigned short PixelUWords __attribute__((vector_size(16)));
+typedef int PixelDwords __attribute__((vector_size(16)));
+typedef char PixelBytesUnaligned __attribute__((vector_size(16), aligned(1)));
+typedef int PixelDwordsUnaligned __attribute__((vector_size(16), aligned(1)));
+
+// Does the cpu support SSE2? -1 when not checked yet
+static int resizeSSE2 = -1;
+static bool ResizeUseSSE2()
+{
+    if(resizeSSE2 == -1) {
+        unsigned int eax, ebx, ecx, edx;
+        asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+        resizeSSE2 = (edx & (1 << 26)) ? 1 : 0; // SSE2
+    }
+    return resizeSSE2;
+}
+
+// Interpolate between 2 pixels, weight is between 0 and 255
+// Red and blue are calculated together, as are alpha and green, the 16 bit lanes can not overflow
+static inline uint32_t LerpPixel(uint32_t p, uint32_t q, uint32_t weight)
+{
+    uint32_t rb = (((p & 0x00FF00FF) * (256 - weight) + (q & 0x00FF00FF) * weight) >> 8) & 0x00FF00FF;
+    uint32_t ag = (((p >> 8) & 0x00FF00FF) * (256 - weight) + ((q >> 8) & 0x00FF00FF) * weight) & 0xFF00FF00;
+    return rb | ag;
+}
+
+// Interpolate between 2 rows of pixels, 4 pixels at once
+__attribute__((target("sse2"))) static void LerpRowsSSE2(uint32_t* out, const uint32_t* top, const uint32_t* bottom, uint32_t weight, int count)
+{
+    const PixelUWords topWeight = { (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight), (unsigned short)(256 - weight) };
+    const PixelUWords bottomWeight = { (unsigned short)weight, (unsigned short)weight, (unsigned short)weight, (unsigned short)weight, (unsigned short)weight, (unsigned short)weight, (unsigned short)weight, (unsigned short)weight };
+    const PixelBytes zero = { 0 };
+
+    int x = 0;
+    for(; x + 4 <= count; x += 4) {
+        PixelBytes t = *(const PixelBytesUnaligned*)(top + x);
+        PixelBytes b = *(const PixelBytesUnaligned*)(bottom + x);
+
+        PixelUWords low = ((PixelUWords)__builtin_ia32_punpcklbw128(t, zero) * topWeight + (PixelUWords)__builtin_ia32_punpcklbw128(b, zero) * bottomWeight) >> 8;
+        PixelUWords high = ((PixelUWords)__builtin_ia32_punpckhbw128(t, zero) * topWeight + (PixelUWords)__builtin_ia32_punpckhbw128(b, zero) * bottomWeight) >> 8;
+        *(PixelBytesUnaligned*)(out + x) = __builtin_ia32_packuswb128((PixelWords)low, (PixelWords)high);
+    }
+    for(; x < count; x++)
+        out[x] = LerpPixel(top[x], bottom[x], weight);
+}
+
+static void LerpRows(uint32_t* out, const uint32_t* top, const uint32_t* bottom, uint32_t weight, int count)
+{
+    if(ResizeUseSSE2())
+        return LerpRowsSSE2(out, top, bottom, weight, count);
+
+    for(int x = 0; x < count; x++)
+        out[x] = LerpPixel(top[x], bottom[x], weight);
+}
+
+// Nearest source pixel is found using a table of source columns calculated in 16.16 fixed point
 Image* Image::ResizeNearestNeighbor(Image* source, int newWidth, int newHeight)
 {
     Image* result = new Image(newWidth, newHeight);
     uint32_t* src = (uint32_t*)source->GetBufferPtr();
     uint32_t* dest = (uint32_t*)result->GetBufferPtr();
 
-    double x_ratio = source->width / (double)newWidth;
-	double y_ratio = source->height / (double)newHeight;
-	double px, py;
-	for (int y = 0; y < newHeight; y++) {
-		for (int x = 0; x < newWidth; x++) {
-			px = Math::floor((double)x * x_ratio);
-			py = Math::floor((double)y * y_ratio);
-			dest[(y*newWidth) + x] = src[(uint32_t)((py*source->width) + px)];
-		}
-	}
-    
+    uint32_t* xTable = new uint32_t[newWidth];
+    uint32_t xStep = ((uint32_t)source->width << 16) / newWidth;
+    for(int x = 0; x < newWidth; x++)
+        xTable[x] = (x * xStep) >> 16;
+
+    uint32_t yStep = ((uint32_t)source->height << 16) / newHeight;
+    int prevY = -1;
+    for(int y = 0; y < newHeight; y++) {
+        int srcY = (y * yStep) >> 16;
+        uint32_t* destRow = dest + y * newWidth;
+
+        // Same source row as the previous line, happens when scaling up
+        if(srcY == prevY) {
+            memcpy(destRow, destRow - newWidth, newWidth * 4);
+            continue;
+        }
+
+        const uint32_t* srcRow = src + srcY * source->width;
+        for(int x = 0; x < newWidth; x++)
+            destRow[x] = srcRow[xTable[x]];
+        prevY = srcY;
+    }
+
+    delete[] xTable;
     return result;
 }
 // http://tech-algorithm.com/articles/bilinear-image-scaling/
+// Done in two passes, first the 2 source rows are interpolated and then the pixels of that row
 Image* Image::ResizeBilinear(Image* source, int newWidth, int newHeight)
 {
     Image* result = new Image(newWidth, newHeight);
-    uint8_t* src = (uint8_t*)source->GetBufferPtr();
-    uint8_t* dest = (uint8_t*)result->GetBufferPtr();
-    int a, b, c, d, x, y, index;
+    uint32_t* src = (uint32_t*)source->GetBufferPtr();
+    uint32_t* dest = (uint32_t*)result->GetBufferPtr();
 
-    float x_ratio = ((float)(source->width-1))/newWidth;
-    float y_ratio = ((float)(source->height-1))/newHeight;
+    // Source columns and weights for every destination column, in 16.16 fixed point
+    uint32_t* xLeft = new uint32_t[newWidth];
+    uint32_t* xRight = new uint32_t[newWidth];
+    uint8_t* xWeight = new uint8_t[newWidth];
+    uint32_t xStep = ((uint32_t)(source->width - 1) << 16) / newWidth;
+    for(int x = 0; x < newWidth; x++) {
+        uint32_t pos = x * xStep;
+        xLeft[x] = pos >> 16;
+        xRight[x] = Math::Min(xLeft[x] + 1, source->width - 1);
+        xWeight[x] = (pos >> 8) & 0xFF;
+    }
 
-    float x_diff, y_diff, blue, red, green;
-    #if BILINEAR_ALPHA
-    float alpha;
-    #endif
-    
-    int offset = 0;
-    for (int i = 0; i < newHeight; i++) {
-        for (int j = 0; j < newWidth; j++) {
-            x = (int)(x_ratio * j);
-            y = (int)(y_ratio * i);
-            x_diff = (x_ratio * j) - x;
-            y_diff = (y_ratio * i) - y;
-            index = (y*source->width+x);   
-
-            a = src[index];
-            b = src[index+1];
-            c = src[index+source->width];
-            d = src[index+source->width+1];
-
-            // blue element
-            // Yb = Ab(1-w)(1-h) + Bb(w)(1-h) + Cb(h)(1-w) + Db(wh)
-            blue = (a&0xff)*(1-x_diff)*(1-y_diff) + (b&0xff)*(x_diff)*(1-y_diff) +
-                   (c&0xff)*(y_diff)*(1-x_diff)   + (d&0xff)*(x_diff*y_diff);
-
-            // green element
-            // Yg = Ag(1-w)(1-h) + Bg(w)(1-h) + Cg(h)(1-w) + Dg(wh)
-            green = ((a>>8)&0xff)*(1-x_diff)*(1-y_diff) + ((b>>8)&0xff)*(x_diff)*(1-y_diff) +
-                    ((c>>8)&0xff)*(y_diff)*(1-x_diff)   + ((d>>8)&0xff)*(x_diff*y_diff);
-
-            // red element
-            // Yr = Ar(1-w)(1-h) + Br(w)(1-h) + Cr(h)(1-w) + Dr(wh)
-            red = ((a>>16)&0xff)*(1-x_diff)*(1-y_diff) + ((b>>16)&0xff)*(x_diff)*(1-y_diff) +
-                  ((c>>16)&0xff)*(y_diff)*(1-x_diff)   + ((d>>16)&0xff)*(x_diff*y_diff);
-
-            #if BILINEAR_ALPHA
-            alpha = ((a>>24)&0xff)*(1-x_diff)*(1-y_diff) + ((b>>24)&0xff)*(x_diff)*(1-y_diff) +
-                    ((c>>24)&0xff)*(y_diff)*(1-x_diff)   + ((d>>24)&0xff)*(x_diff*y_diff);
-
-            dest[offset++] = 
-                    ((((int)alpha)<<24)&0xff000000) |
-                    ((((int)red)<<16)&0xff0000) |
-                    ((((int)green)<<8)&0xff00) |
-                    ((int)blue);
-            #else
-            dest[offset++] = 
-                    0xff000000 | // hardcode alpha
-                    ((((int)red)<<16)&0xff0000) |
-                    ((((int)green)<<8)&0xff00) |
-                    ((int)blue);
-            #endif
+    uint32_t* rowBuffer = new uint32_t[source->width];
+    uint32_t yStep = ((uint32_t)(source->height - 1) << 16) / newHeight;
+    for(int y = 0; y < newHeight; y++) {
+        uint32_t pos = y * yStep;
+        uint32_t srcY = pos >> 16;
+        uint32_t yWeight = (pos >> 8) & 0xFF;
+
+        const uint32_t* row = src + srcY * source->width;
+        if(yWeight) {
+            LerpRows(rowBuffer, row, src + Math::Min(srcY + 1, source->height - 1) * source->width, yWeight, source->width);
+            row = rowBuffer;
         }
+
+        uint32_t* destRow = dest + y * newWidth;
+        for(int x = 0; x < newWidth; x++)
+            destRow[x] = LerpPixel(row[xLeft[x]], row[xRight[x]], xWeight[x]);
+
+        #if !BILINEAR_ALPHA
+        for(int x = 0; x < newWidth; x++)
+            destRow[x] |= 0xFF000000; // hardcode alpha
+        #endif
     }
 
+    delete[] xLeft;
+    delete[] xRight;
+    delete[] xWeight;
+    delete[] rowBuffer;
 	return result;
-}
\ No newline at end of file
+}
+
+// Which source pixels cover each destination pixel and by how much
+// Sizes are measured in units where a source pixel is dstSize units and a destination pixel srcSize units
+struct BoxTable
+{
+    int* start;         // First source pixel
+    int* count;         // Number of source pixels
+    int* offset;        // Index of the first weight
+    uint32_t* weights;  // Amount of units covered
+};
+
+static BoxTable CreateBoxTable(int srcSize, int dstSize)
+{
+    BoxTable table;
+    table.start = new int[dstSize];
+    table.count = new int[dstSize];
+    table.offset = new int[dstSize];
+    table.weights = new uint32_t[srcSize + dstSize];
+
+    int index = 0;
+    for(int i = 0; i < dstSize; i++) {
+        uint32_t begin = i * srcSize;
+        uint32_t end = (i + 1) * srcSize;
+
+        table.start[i] = begin / dstSize;
+        table.count[i] = (end - 1) / dstSize - table.start[i] + 1;
+        table.offset[i] = index;
+        for(int j = table.start[i]; j < table.start[i] + table.count[i]; j++)
+            table.weights[index++] = Math::Min(end, (j + 1) * dstSize) - Math::Max(begin, j * dstSize);
+    }
+    return table;
+}
+
+static void DeleteBoxTable(BoxTable* table)
+{
+    delete[] table->start;
+    delete[] table->count;
+    delete[] table->offset;
+    delete[] table->weights;
+}
+
+// Divide every channel sum by the total weight using a multiplication with the reciprocal
+static inline uint32_t BoxNormalize(uint32_t sum, uint32_t total, uint32_t reciprocal)
+{
+    return (uint32_t)(((uint64_t)(sum + total / 2) * reciprocal) >> 32);
+}
+
+// Add every channel of row multiplied by weight to the 4 sums per pixel, 4 pixels at once
+// pmaddwd works on signed words, so weight needs to be smaller than 32768
+__attribute__((target("sse2"))) static void BoxAccumulateSSE2(uint32_t* sums, const uint32_t* row, uint32_t weight, int count)
+{
+    const PixelWords weights = { (short)weight, 0, (short)weight, 0, (short)weight, 0, (short)weight, 0 };
+    const PixelBytes zero = { 0 };
+
+    int x = 0;
+    for(; x + 4 <= count; x += 4) {
+        PixelBytes pixels = *(const PixelBytesUnaligned*)(row + x);
+        PixelBytes low = __builtin_ia32_punpcklbw128(pixels, zero);
+        PixelBytes high = __builtin_ia32_punpckhbw128(pixels, zero);
+
+        // Every channel as a 32 bit value, multiplied with the weight
+        PixelDwordsUnaligned* s = (PixelDwordsUnaligned*)(sums + x * 4);
+        s[0] += __builtin_ia32_pmaddwd128((PixelWords)__builtin_ia32_punpcklwd128((PixelWords)low, (PixelWords)zero), weights);
+        s[1] += __builtin_ia32_pmaddwd128((PixelWords)__builtin_ia32_punpckhwd128((PixelWords)low, (PixelWords)zero), weights);
+        s[2] += __builtin_ia32_pmaddwd128((PixelWords)__builtin_ia32_punpcklwd128((PixelWords)high, (PixelWords)zero), weights);
+        s[3] += __builtin_ia32_pmaddwd128((PixelWords)__builtin_ia32_punpckhwd128((PixelWords)high, (PixelWords)zero), weights);
+    }
+    for(; x < count; x++) {
+        uint32_t p = row[x];
+        sums[x*4 + 0] += (p & 0xFF) * weight;
+        sums[x*4 + 1] += ((p >> 8) & 0xFF) * weight;
+        sums[x*4 + 2] += ((p >> 16) & 0xFF) * weight;
+        sums[x*4 + 3] += (p >> 24) * weight;
+    }
+}
+
+static void BoxAccumulate(uint32_t* sums, const uint32_t* row, uint32_t weight, int count)
+{
+    if(weight < 32768 && ResizeUseSSE2())
+        return BoxAccumulateSSE2(sums, row, weight, count);
+
+    for(int x = 0; x < count; x++) {
+        uint32_t p = row[x];
+        sums[x*4 + 0] += (p & 0xFF) * weight;
+        sums[x*4 + 1] += ((p >> 8) & 0xFF) * weight;
+        sums[x*4 + 2] += ((p >> 16) & 0xFF) * weight;
+        sums[x*4 + 3] += (p >> 24) * weight;
+    }
+}
+
+// Area averaging done in two passes, every needed source row is first reduced horizontally
+// After that the reduced rows are added together for every destination row
+Image* Image::ResizeBox(Image* source, int newWidth, int newHeight)
+{
+    Image* result = new Image(newWidth, newHeight);
+    uint32_t* src = (uint32_t*)source->GetBufferPtr();
+    uint32_t* dest = (uint32_t*)result->GetBufferPtr();
+
+    BoxTable xTable = CreateBoxTable(source->width, newWidth);
+    BoxTable yTable = CreateBoxTable(source->height, newHeight);
+    uint32_t xReciprocal = (0xFFFFFFFF / source->width) + 1;
+    uint32_t yReciprocal = (0xFFFFFFFF / source->height) + 1;
+
+    // Source row reduced to the new width
+    uint32_t* rowBuffer = new uint32_t[newWidth];
+    int rowBufferY = -1;
+
+    // Channel sums of the destination row
+    uint32_t* sums = new uint32_t[newWidth * 4];
+
+    for(int y = 0; y < newHeight; y++)
+    {
+        memset(sums, 0, newWidth * 4 * sizeof(uint32_t));
+        for(int i = 0; i < yTable.count[y]; i++)
+        {
+            int srcY = yTable.start[y] + i;
+
+            // Rows on the border of 2 destination rows are used twice
+            if(srcY != rowBufferY) {
+                const uint32_t* srcRow = src + srcY * source->width;
+                for(int x = 0; x < newWidth; x++) {
+                    uint32_t b = 0, g = 0, r = 0, a = 0;
+                    const uint32_t* weight = xTable.weights + xTable.offset[x];
+                    const uint32_t* pixel = srcRow + xTable.start[x];
+                    for(int j = 0; j < xTable.count[x]; j++) {
+                        b += (pixel[j] & 0xFF) * weight[j];
+                        g += ((pixel[j] >> 8) & 0xFF) * weight[j];
+                        r += ((pixel[j] >> 16) & 0xFF) * weight[j];
+                        a += (pixel[j] >> 24) * weight[j];
+                    }
+                    rowBuffer[x] = BoxNormalize(b, source->width, xReciprocal) | (BoxNormalize(g, source->width, xReciprocal) << 8) | (BoxNormalize(r, source->width, xReciprocal) << 16) | (BoxNormalize(a, source->width, xReciprocal) << 24);
+                }
+                rowBufferY = srcY;
+            }
+
+            BoxAccumulate(sums, rowBuffer, yTable.weights[yTable.offset[y] + i], newWidth);
+        }
+
+        uint32_t* destRow = dest + y * newWidth;
+        for(int x = 0; x < newWidth; x++)
+            destRow[x] = BoxNormalize(sums[x*4 + 0], source->height, yReciprocal) | (BoxNormalize(sums[x*4 + 1], source->height, yReciprocal) << 8) | (BoxNormalize(sums[x*4 + 2], source->height, yReciprocal) << 16) | (BoxNormalize(sums[x*4 + 3], source->height, yReciprocal) << 24);
+    }
+
+    DeleteBoxTable(&xTable);
+    DeleteBoxTable(&yTable);
+    delete[] rowBuffer;
+    delete[] sums;
+    return result;
+}
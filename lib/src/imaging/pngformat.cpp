@@ -71,23 +71,6 @@ static const uint32_t distanceExtraBits[] = {
 static const uint32_t codeLengthCodesOrder[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
 
 
-void printBT(const char* prefix, const HuffmanNode* node, bool isLeft)
-{
-    if( node != nullptr )
-    {
-        Print("%s%s%d\n", prefix, (isLeft ? "├──" : "└──" ), node->symbol);
-
-        // enter the next tree level - left and right branch
-        printBT(str_Combine((char*)prefix, isLeft ? (char*)"│   " : (char*)"    "), node->left, true);
-        printBT(str_Combine((char*)prefix, isLeft ? (char*)"│   " : (char*)"    "), node->right, false);
-    }
-}
-
-void printBT(const HuffmanNode* node)
-{
-    printBT("", node, false);    
-}
-
 Image* PNGDecoder::Convert(const char* filepath)
 {
     Print("[PNG] Converting image file %s\n", filepath);
@@ -192,65 +175,47 @@ Image* PNGDecoder::ConvertRAW(const uint8_t* rawData)
         offset += imgDataLens[i];
     }
 
-    // Decompress image data
-    Vector<uint8_t>* imageData = ZLIBDecompressor::Decompress(IDAT);
-    uint8_t* imageDataRaw = imageData->data();
-
-    // We don't need this anymore
-    delete IDAT;
+    // Size of one row of pixels
+    uint32_t stride = ihdr->width * BYTES_PER_PIXEL;
 
     // Create resulting image
     Image* result = new Image(ihdr->width, ihdr->height);
-    uint8_t* recon = (uint8_t*)result->GetBufferPtr();
-    uint32_t reconIndex = 0;
-    uint32_t stride = ihdr->width * BYTES_PER_PIXEL;
+    uint8_t* out = (uint8_t*)result->GetBufferPtr();
+
+    // The row above the first row is all zero's
+    uint8_t* zeroRow = new uint8_t[stride];
+    memset(zeroRow, 0, stride);
+    const uint8_t* prev = zeroRow;
 
-    uint32_t index = 0;
+    // Decompress one row at a time, every row starts with a filter type byte
+    ZLIBDecompressor* decompressor = new ZLIBDecompressor(IDAT, IDATLength, stride + 1);
     for(uint32_t r = 0; r < ihdr->height; r++)
     {
-        uint8_t filterType = imageDataRaw[index++];
-        uint8_t reconX = 0;
-        for(uint32_t c = 0; c < stride; c++)
-        {
-            uint8_t filtX = imageDataRaw[index++];
-            if(filterType == 0)
-                reconX = filtX;
-            else if(filterType == 1)
-                reconX = filtX + Recon_a(recon, stride, r, c);
-            else if(filterType == 2)
-                reconX = filtX + Recon_b(recon, stride, r, c);
-            else if(filterType == 3)
-                reconX = filtX + ((Recon_a(recon, stride, r, c) + Recon_b(recon, stride, r, c)) / 2);
-            else if(filterType == 4)
-                reconX = filtX + PaethPredictor(recon, Recon_a(recon, stride, r, c), Recon_b(recon, stride, r, c), Recon_c(recon, stride, r, c));
-            else {
-                Print("[PNGDecoder] invalid filter type %d\n", filterType);
-            }
-            
-            recon[reconIndex] = reconX & 0xFF;
-            reconIndex++;
-        } 
+        uint8_t* row = decompressor->Read(stride + 1);
+        if(row == 0) {
+            Log(Error, "[PNG] Could not decompress image data");
+            delete result;
+            result = 0;
+            break;
+        }
+
+        if(!UnfilterRow(row[0], row + 1, prev, out, ihdr->width)) {
+            Print("[PNGDecoder] invalid filter type %d\n", row[0]);
+            delete result;
+            result = 0;
+            break;
+        }
+        prev = out;
+        out += stride;
     }
 
-    // Convert to right pixel format
-    for(uint32_t i = 0; i < (result->GetHeight() * stride); i += 4)
-    {
-        const uint8_t a = recon[i + 3];
-        const uint8_t b = recon[i + 2];
-        const uint8_t g = recon[i + 1];
-        const uint8_t r = recon[i + 0];
-
-        recon[i + 3] = a;
-        recon[i + 2] = r;
-        recon[i + 1] = g;
-        recon[i + 0] = b;
-    }    
-
-    delete imageData;
+    delete decompressor;
+    delete[] zeroRow;
+    delete[] IDAT;
     return result;
 }
 
-uint8_t PNGDecoder::PaethPredictor(uint8_t* recon, uint8_t a, uint8_t b, uint8_t c)
+uint8_t PNGDecoder::PaethPredictor(uint8_t a, uint8_t b, uint8_t c)
 {
     int p = a + b - c;
     int pa = Math::Abs(p - a);
@@ -267,177 +232,445 @@ uint8_t PNGDecoder::PaethPredictor(uint8_t* recon, uint8_t a, uint8_t b, uint8_t
     
     return pr;
 }
-uint8_t PNGDecoder::Recon_a(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c)
+
+// The png data is stored as RGBA, but images use ARGB which is BGRA in memory
+// Every filter only uses the same channel of the pixels around it, so the channels can be swapped before unfiltering
+static inline uint32_t SwapRedBlue(uint32_t pixel)
 {
-    if(c >= BYTES_PER_PIXEL)
-        return recon[r * stride + c - BYTES_PER_PIXEL];
-    return 0;
+    return (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF) | ((pixel & 0xFF) << 16);
 }
-uint8_t PNGDecoder::Recon_b(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c)
+
+typedef char PixelBytes __attribute__((vector_size(16)));
+typedef short PixelWords __attribute__((vector_size(16)));
+typedef int PixelDwords __attribute__((vector_size(16)));
+typedef int PixelDwordsUnaligned __attribute__((vector_size(16), aligned(1)));
+
+// Does the cpu support SSE2? -1 when not checked yet
+static int unfilterSSE2 = -1;
+
+// Load one pixel into the lowest 4 words of a vector
+__attribute__((target("sse2"))) static inline PixelWords LoadPixel(uint32_t pixel)
 {
-    if(r > 0)
-        return recon[(r-1) * stride + c];
-    return 0;
+    PixelDwords d = { (int)pixel, 0, 0, 0 };
+    return (PixelWords)__builtin_ia32_punpcklbw128((PixelBytes)d, (PixelBytes){ 0 });
 }
-uint8_t PNGDecoder::Recon_c(uint8_t* recon, uint32_t stride, uint32_t r, uint32_t c)
+// Store the lowest 4 words of a vector as one pixel
+__attribute__((target("sse2"))) static inline void StorePixel(uint8_t* dst, PixelWords pixel)
 {
-    if((r > 0) && (c >= BYTES_PER_PIXEL))
-        return recon[(r - 1) * stride + c - BYTES_PER_PIXEL];
-    return 0;
+    PixelBytes bytes = __builtin_ia32_packuswb128(pixel, pixel);
+    *(uint32_t*)dst = ((PixelDwords)bytes)[0];
 }
 
+// Same as the scalar version, but works on the 4 channels of a pixel at once or 4 pixels at once for the up filter
+__attribute__((target("sse2"))) static void UnfilterRowSSE2(uint8_t filterType, const uint8_t* filt, const uint8_t* prev, uint8_t* out, uint32_t width)
+{
+    const PixelWords byteMask = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint32_t x = 0;
+
+    if(filterType == 0 || filterType == 2) {
+        // The up filter does not depend on the pixel to the left, so 4 pixels can be done at once
+        const PixelDwords greenAlpha = { (int)0xFF00FF00, (int)0xFF00FF00, (int)0xFF00FF00, (int)0xFF00FF00 };
+        const PixelDwords lowByte = { 0xFF, 0xFF, 0xFF, 0xFF };
+        for(; x + 4 <= width; x += 4) {
+            PixelDwords f = *(const PixelDwordsUnaligned*)(filt + x * 4);
+            f = (f & greenAlpha) | (__builtin_ia32_psrldi128(f, 16) & lowByte) | __builtin_ia32_pslldi128(f & lowByte, 16);
+
+            PixelBytes result = (PixelBytes)f;
+            if(filterType == 2)
+                result += (PixelBytes)*(const PixelDwordsUnaligned*)(prev + x * 4);
+            *(PixelDwordsUnaligned*)(out + x * 4) = (PixelDwords)result;
+        }
+        for(; x < width; x++) {
+            uint32_t f = SwapRedBlue(((const uint32_t*)filt)[x]);
+            StorePixel(out + x * 4, (LoadPixel(f) + (filterType == 2 ? LoadPixel(((const uint32_t*)prev)[x]) : (PixelWords){ 0 })) & byteMask);
+        }
+        return;
+    }
 
+    // The other filters use the pixel on the left, so they go one pixel at a time
+    PixelWords a = { 0 }; // Pixel on the left
+    PixelWords c = { 0 }; // Pixel above the one on the left
+    for(; x < width; x++)
+    {
+        PixelWords f = LoadPixel(SwapRedBlue(((const uint32_t*)filt)[x]));
+        PixelWords b = LoadPixel(((const uint32_t*)prev)[x]);
+        PixelWords predictor;
+
+        if(filterType == 1)
+            predictor = a;
+        else if(filterType == 3)
+            predictor = (a + b) >> 1;
+        else {
+            // Paeth, all distances are calculated on words so they can not overflow
+            PixelWords pa = b - c;
+            PixelWords pb = a - c;
+            PixelWords pc = pa + pb;
+            pa = __builtin_ia32_pmaxsw128(pa, -pa);
+            pb = __builtin_ia32_pmaxsw128(pb, -pb);
+            pc = __builtin_ia32_pmaxsw128(pc, -pc);
+
+            PixelWords useA = (pa <= pb) & (pa <= pc);
+            PixelWords useB = ~useA & (pb <= pc);
+            predictor = (a & useA) | (b & useB) | (c & ~(useA | useB));
+        }
 
+        a = (f + predictor) & byteMask;
+        c = b;
+        StorePixel(out + x * 4, a);
+    }
+}
 
+bool PNGDecoder::UnfilterRow(uint8_t filterType, const uint8_t* filt, const uint8_t* prev, uint8_t* out, uint32_t width)
+{
+    if(filterType > 4)
+        return false;
 
+    if(unfilterSSE2 == -1) {
+        unsigned int eax, ebx, ecx, edx;
+        asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+        unfilterSSE2 = (edx & (1 << 26)) ? 1 : 0; // SSE2
+    }
+    if(unfilterSSE2) {
+        UnfilterRowSSE2(filterType, filt, prev, out, width);
+        return true;
+    }
 
+    // Swap the channels while copying the row, after that it can be unfiltered in place
+    for(uint32_t x = 0; x < width; x++)
+        ((uint32_t*)out)[x] = SwapRedBlue(((const uint32_t*)filt)[x]);
 
+    uint32_t stride = width * BYTES_PER_PIXEL;
+    for(uint32_t i = 0; i < stride; i++)
+    {
+        uint8_t a = i >= BYTES_PER_PIXEL ? out[i - BYTES_PER_PIXEL] : 0;
+        uint8_t b = prev[i];
+        uint8_t c = i >= BYTES_PER_PIXEL ? prev[i - BYTES_PER_PIXEL] : 0;
+
+        if(filterType == 1)
+            out[i] += a;
+        else if(filterType == 2)
+            out[i] += b;
+        else if(filterType == 3)
+            out[i] += (a + b) / 2;
+        else if(filterType == 4)
+            out[i] += PaethPredictor(a, b, c);
+    }
+    return true;
+}
 
-
-
-
-
-
-
-
-Vector<uint8_t>* ZLIBDecompressor::Decompress(uint8_t* input)
+ZLIBDecompressor::ZLIBDecompressor(uint8_t* input, uint32_t inputSize, uint32_t maxRead)
+: reader(input, inputSize)
+{
+    // Room for the history, one read and the matches that can overshoot it
+    this->windowCapacity = ZLIB_WINDOW_SIZE + maxRead + 2 * ZLIB_MAX_MATCH;
+    this->window = new uint8_t[this->windowCapacity];
+}
+ZLIBDecompressor::~ZLIBDecompressor()
+{
+    this->FreeTables();
+    if(this->window)
+        delete[] this->window;
+}
+bool ZLIBDecompressor::ReadHeader()
 {
     /*
         Manely checking that this buffer is supported and valid, main function is the inflate method
     */
 
-    BitReader* reader = new BitReader(input);
-
-    uint8_t CMF = reader->ReadByte();
+    uint8_t CMF = this->reader.ReadByte();
     uint8_t method = CMF & 0xF;
-    if(method != 8) return 0; // Only CM=8 is supported
+    if(method != 8) return false; // Only CM=8 is supported
 
     uint8_t CINFO = (CMF >> 4) & 0xF;
-    if(CINFO > 7) return 0; // CINFO must be smaller that 8
+    if(CINFO > 7) return false; // CINFO must be smaller that 8
 
-    uint8_t FLG = reader->ReadByte();
-    if(((CMF * 256 + FLG) % 31) != 0) return 0; // CMF+FLG checksum not correct
+    uint8_t FLG = this->reader.ReadByte();
+    if(((CMF * 256 + FLG) % 31) != 0) return false; // CMF+FLG checksum not correct
 
     uint8_t FDICT = (FLG >> 5) & 1;
-    if(FDICT != 0) return 0; // FDICT is not supported
-
-    // Perform actual decompression
-    Vector<uint8_t>* result = ZLIBDecompressor::Inflate(reader);
-    
-    // Ignored for now
-    uint32_t adler32 = reader->ReadBytes<uint32_t>(4);
+    if(FDICT != 0) return false; // FDICT is not supported
 
-    delete reader;
-    return result;
+    // The adler32 checksum at the end is ignored for now
+    return true;
 }
-Vector<uint8_t>* ZLIBDecompressor::Inflate(BitReader* reader)
+uint8_t* ZLIBDecompressor::Read(uint32_t n)
 {
-    uint8_t endOfBlocks = 0;
-    Vector<uint8_t>* buffer = new Vector<uint8_t>();
-    while (!endOfBlocks) 
+    if(!this->headerDone) {
+        this->headerDone = true;
+        this->error = !this->ReadHeader();
+    }
+
+    while(!this->error && this->windowSize - this->readPos < n)
     {
-        endOfBlocks = reader->ReadBit();
-        uint8_t blockType = reader->ReadBits<uint8_t>(2);
+        if(this->inBlock)
+            this->error = !this->InflateBlock(n);
+        else if(this->lastBlock)
+            return 0; // End of data
+        else
+            this->error = !this->StartBlock();
+    }
+    if(this->error)
+        return 0;
 
-        //Print("[ZLIBDecompressor] Blocktype %d\n", blockType);
-        if(blockType == 0) {
-            ZLIBDecompressor::InflateBlockNoCompression(reader, buffer);
-        }
-        else if(blockType == 1) {
-            ZLIBDecompressor::InflateBlockStatic(reader, buffer);
-        }
-        else if(blockType == 2) {
-            ZLIBDecompressor::InflateBlockDynamic(reader, buffer);
+    uint8_t* ret = this->window + this->readPos;
+    this->readPos += n;
+    return ret;
+}
+bool ZLIBDecompressor::StartBlock()
+{
+    this->lastBlock = this->reader.ReadBit();
+    this->blockType = this->reader.ReadBits<uint8_t>(2);
+
+    //Print("[ZLIBDecompressor] Blocktype %d\n", blockType);
+    if(this->blockType == 0) {
+        uint16_t len = this->reader.ReadBytes<uint16_t>(2);
+        uint16_t nlen = this->reader.ReadBytes<uint16_t>(2);
+        if((uint16_t)~nlen != len) {
+            Log(Error, "[ZLIBDecompressor] Invalid length of uncompressed block");
+            return false;
         }
-        else {
-            Print("[ZLIBDecompressor] Invalid blocktype %d\n", blockType);
-            return 0;
+        this->storedRemaining = len;
+    }
+    else if(this->blockType == 1) {
+        static HuffmanTable* staticLiteralLengthTable = 0;
+        static HuffmanTable* staticDistanceTable = 0;
+
+        if(staticLiteralLengthTable == 0) {
+            uint8_t bl[288];
+            for(int i = 0; i < 144; i++)
+                bl[i] = 8;
+            for(int i = 144; i < 256; i++)
+                bl[i] = 9;
+            for(int i = 256; i < 280; i++)
+                bl[i] = 7;
+            for(int i = 280; i < 288; i++)
+                bl[i] = 8;
+            
+            staticLiteralLengthTable = new HuffmanTable();
+            BuildTable(staticLiteralLengthTable, bl, 288);
+
+            for(int i = 0; i < 30; i++)
+                bl[i] = 5;
+
+            staticDistanceTable = new HuffmanTable();
+            BuildTable(staticDistanceTable, bl, 30);
         }
+
+        this->literalLengthTable = staticLiteralLengthTable;
+        this->distanceTable = staticDistanceTable;
+    }
+    else if(this->blockType == 2) {
+        this->literalLengthTable = new HuffmanTable();
+        this->distanceTable = new HuffmanTable();
+        if(!DecodeTables(&this->reader, this->literalLengthTable, this->distanceTable))
+            return false;
+    }
+    else {
+        Print("[ZLIBDecompressor] Invalid blocktype %d\n", this->blockType);
+        return false;
     }
 
-    return buffer;
+    this->inBlock = true;
+    return true;
 }
-void ZLIBDecompressor::InflateBlockNoCompression(BitReader* reader, Vector<uint8_t>* target)
+void ZLIBDecompressor::FreeTables()
 {
-    uint16_t len = reader->ReadBytes<uint16_t>(2);
-    uint16_t nlen = reader->ReadBytes<uint16_t>(2);
-
-    for(uint16_t i = 0; i < len; i++)
-        target->push_back(reader->ReadByte());
+    // Tables of static blocks are shared
+    if(this->blockType == 2) {
+        if(this->literalLengthTable)
+            delete this->literalLengthTable;
+        if(this->distanceTable)
+            delete this->distanceTable;
+    }
+    this->literalLengthTable = 0;
+    this->distanceTable = 0;
 }
-uint32_t ZLIBDecompressor::DecodeSymbol(BitReader* reader, HuffmanTree* tree)
+void ZLIBDecompressor::Compact()
 {
-    HuffmanNode* node = tree->root;
+    // Keep the history used by back-references and everything that is not read yet
+    uint32_t keepFrom = this->windowSize > ZLIB_WINDOW_SIZE ? this->windowSize - ZLIB_WINDOW_SIZE : 0;
+    if(this->readPos < keepFrom)
+        keepFrom = this->readPos;
+    if(keepFrom == 0)
+        return;
+
+    memmove(this->window, this->window + keepFrom, this->windowSize - keepFrom);
+    this->windowSize -= keepFrom;
+    this->readPos -= keepFrom;
+}
+uint32_t ZLIBDecompressor::DecodeSymbol(BitReader* reader, HuffmanTable* table)
+{
+    uint32_t bits = reader->PeekBits(HUFFMAN_PRIMARY_BITS + table->overflowBits);
+    uint32_t entry = table->primary[bits & ((1 << HUFFMAN_PRIMARY_BITS) - 1)];
 
-    while(node->left || node->right) {
-        uint8_t b = reader->ReadBit();
-        if(b) node = node->right;
-        else node = node->left;
+    // Code is longer than the primary table, the remaining bits select the entry in the overflow table
+    if(entry & HUFFMAN_OVERFLOW)
+        entry = table->overflow[(entry & 0xFFFF) + (bits >> HUFFMAN_PRIMARY_BITS)];
+
+    reader->ConsumeBits((entry >> 16) & 0xFF);
+    return entry & 0xFFFF;
+}
+// Copy a earlier part of the output, which can overlap the bytes being written
+static inline void CopyMatch(uint8_t* dst, uint32_t distance, uint32_t length)
+{
+    const uint8_t* src = dst - distance;
+    if(distance == 1) { // Run of the same byte
+        memset(dst, *src, length);
+        return;
+    }
+    if(distance >= 4) { // Every 4 bytes read are already written
+        for(; length >= 4; length -= 4, dst += 4, src += 4)
+            *(uint32_t*)dst = *(const uint32_t*)src;
     }
-    return node->symbol;
+    while(length--)
+        *dst++ = *src++;
 }
-void ZLIBDecompressor::InflateBlockData(BitReader* reader, HuffmanTree* literalLengthTree, HuffmanTree* distanceTree, Vector<uint8_t>* target)
+bool ZLIBDecompressor::InflateBlock(uint32_t n)
 {
-    while(true)
+    if(this->blockType == 0) { // Non compressed block
+        while(this->storedRemaining > 0 && this->windowSize - this->readPos < n)
+        {
+            if(this->windowSize == this->windowCapacity)
+                this->Compact();
+
+            uint32_t len = Math::Min(this->storedRemaining, this->windowCapacity - this->windowSize);
+            this->reader.ReadAlignedBytes(this->window + this->windowSize, len);
+            this->windowSize += len;
+            this->storedRemaining -= len;
+        }
+        if(this->storedRemaining == 0)
+            this->inBlock = false;
+        return true;
+    }
+
+    while(this->windowSize - this->readPos < n)
     {
-        uint32_t sym = DecodeSymbol(reader, literalLengthTree);
+        // Make sure the longest match fits
+        if(this->windowCapacity - this->windowSize < ZLIB_MAX_MATCH)
+            this->Compact();
+
+        uint32_t sym = DecodeSymbol(&this->reader, this->literalLengthTable);
         if (sym <= 255) { // Literal byte
-            target->push_back(sym & 0xFF);
+            this->window[this->windowSize++] = sym & 0xFF;
         }
         else if(sym == 256) { // End of block
-            return;
+            this->FreeTables();
+            this->inBlock = false;
+            return true;
         }
-        else { // <length, backward distance> pair
+        else if(sym <= 285) { // <length, backward distance> pair
             sym -= 257;
-            uint32_t length = reader->ReadBits<uint32_t>(lengthExtraBits[sym]) + lengthBase[sym];
-            uint32_t distSym = DecodeSymbol(reader, distanceTree);
-            uint32_t dist = reader->ReadBits<uint32_t>(distanceExtraBits[distSym]) + distanceBase[distSym];
-            
-            dist = target->Size() - dist;
-            for(uint32_t i = 0; i < length; i++, dist++) {
-                target->push_back(target->GetAt(dist));
+            uint32_t length = this->reader.ReadBits<uint32_t>(lengthExtraBits[sym]) + lengthBase[sym];
+            uint32_t distSym = DecodeSymbol(&this->reader, this->distanceTable);
+            if(distSym >= 30) {
+                Log(Error, "[ZLIBDecompressor] Invalid distance symbol");
+                return false;
             }
+            uint32_t dist = this->reader.ReadBits<uint32_t>(distanceExtraBits[distSym]) + distanceBase[distSym];
+            if(dist > this->windowSize) {
+                Log(Error, "[ZLIBDecompressor] Distance is before start of data");
+                return false;
+            }
+            
+            CopyMatch(this->window + this->windowSize, dist, length);
+            this->windowSize += length;
+        }
+        else {
+            Log(Error, "[ZLIBDecompressor] Invalid symbol");
+            return false;
         }
     }
+    return true;
 }
-HuffmanTree* ZLIBDecompressor::BitListToTree(Vector<uint32_t>* bitList, Vector<uint8_t>* alphabet)
+// Huffman codes are stored starting at the most significant bit, but are read from the lowest bit
+static inline uint32_t ReverseBits(uint32_t code, uint32_t length)
+{
+    uint32_t result = 0;
+    for(uint32_t i = 0; i < length; i++, code >>= 1)
+        result = (result << 1) | (code & 1);
+    return result;
+}
+bool ZLIBDecompressor::BuildTable(HuffmanTable* table, const uint8_t* lengths, uint32_t count)
 {
     uint32_t maxBits = 0;
-    for(uint32_t d : *bitList)
-        if(d > maxBits)
-            maxBits = d;
-    
-    uint32_t* blCount = new uint32_t[(maxBits+1)];
-    memset(blCount, 0, (maxBits + 1) * sizeof(uint32_t));
-    for(uint32_t i = 0; i < (maxBits+1); i++) {
-        // Count occurencies in bitList
-        for(uint32_t item : *bitList)
-            if(i == item && item != 0)
-                blCount[i] += 1;
+    uint32_t blCount[16];
+    memset(blCount, 0, sizeof(blCount));
+    for(uint32_t i = 0; i < count; i++) {
+        blCount[lengths[i]] += 1;
+        if(lengths[i] > maxBits)
+            maxBits = lengths[i];
+    }
+    blCount[0] = 0;
+
+    // More codes than fit in their lengths would give codes past the end of the table (Kraft sum above 1)
+    // Incomplete codes are fine, the missing entries stay invalid
+    int left = 1;
+    for(uint32_t bits = 1; bits < 16; bits++) {
+        left = (left << 1) - blCount[bits];
+        if(left < 0) {
+            Log(Error, "[ZLIBDecompressor] Over-subscribed code lengths");
+            return false;
+        }
     }
 
-    uint32_t* nextCode = new uint32_t[(maxBits+1)];
-    memset(nextCode, 0, (maxBits + 1) * sizeof(uint32_t));
+    // First code for every code length
+    uint32_t nextCode[16];
     nextCode[0] = 0;
-    nextCode[1] = 0;
-    for(uint32_t bits = 2; bits < (maxBits+1); bits++) {
-        nextCode[bits] = ((nextCode[bits-1] + blCount[bits-1]) << 1);
+    for(uint32_t bits = 1; bits < 16; bits++)
+        nextCode[bits] = (nextCode[bits-1] + blCount[bits-1]) << 1;
+
+    // Canonical code of every symbol
+    uint16_t codes[288];
+    for(uint32_t i = 0; i < count; i++)
+        if(lengths[i])
+            codes[i] = nextCode[lengths[i]]++;
+
+    for(int i = 0; i < (1 << HUFFMAN_PRIMARY_BITS); i++)
+        table->primary[i] = HUFFMAN_INVALID;
+
+    if(table->overflow) {
+        delete[] table->overflow;
+        table->overflow = 0;
     }
-    
-    HuffmanTree* result = new HuffmanTree();
-    for(int i = 0; i < alphabet->Size(); i++) {
-        uint32_t c = i;
-        uint32_t bitLen = (i < bitList->Size()) ? bitList->GetAt(i) : 0;
-        if(bitLen) {
-            result->Insert(nextCode[bitLen], bitLen, c);
-            nextCode[bitLen] += 1;
+    table->overflowBits = maxBits > HUFFMAN_PRIMARY_BITS ? maxBits - HUFFMAN_PRIMARY_BITS : 0;
+
+    // Give every primary entry that starts a long code its own part of the overflow table
+    uint32_t overflowParts = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        if(lengths[i] <= HUFFMAN_PRIMARY_BITS)
+            continue;
+        
+        uint32_t prefix = ReverseBits(codes[i], lengths[i]) & ((1 << HUFFMAN_PRIMARY_BITS) - 1);
+        if(!(table->primary[prefix] & HUFFMAN_OVERFLOW))
+            table->primary[prefix] = HUFFMAN_OVERFLOW | ((overflowParts++) << table->overflowBits);
+    }
+    if(overflowParts) {
+        uint32_t overflowSize = overflowParts << table->overflowBits;
+        table->overflow = new uint32_t[overflowSize];
+        for(uint32_t i = 0; i < overflowSize; i++)
+            table->overflow[i] = HUFFMAN_INVALID;
+    }
+
+    // Fill all the entries that start with the bits of each code
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t len = lengths[i];
+        if(len == 0)
+            continue;
+
+        uint32_t reversed = ReverseBits(codes[i], len);
+        if(len <= HUFFMAN_PRIMARY_BITS) {
+            for(uint32_t j = reversed; j < (1 << HUFFMAN_PRIMARY_BITS); j += (1 << len))
+                table->primary[j] = i | (len << 16);
+        }
+        else {
+            uint32_t* part = table->overflow + (table->primary[reversed & ((1 << HUFFMAN_PRIMARY_BITS) - 1)] & 0xFFFF);
+            for(uint32_t j = reversed >> HUFFMAN_PRIMARY_BITS; j < (1U << table->overflowBits); j += (1 << (len - HUFFMAN_PRIMARY_BITS)))
+                part[j] = i | (len << 16);
         }
     }
-    delete blCount;
-    delete nextCode;
-    return result;
+    return true;
 }
-DecodeTreesResult ZLIBDecompressor::DecodeTrees(BitReader* reader)
+bool ZLIBDecompressor::DecodeTables(BitReader* reader, HuffmanTable* literalLengthTable, HuffmanTable* distanceTable)
 {
     // The number of literal/length codes
     uint32_t HLIT = reader->ReadBits<uint8_t>(5) + 257;
@@ -448,129 +681,56 @@ DecodeTreesResult ZLIBDecompressor::DecodeTrees(BitReader* reader)
     // The number of code length codes
     uint32_t HCLEN = reader->ReadBits<uint8_t>(4) + 4;
 
-    // Create result container
-    DecodeTreesResult result;
-
     // Read code lengths for the code length alphabet
-    uint32_t codeLengthTreeBitList[19];
-    for(int i = 0; i < 19; i++)
-        codeLengthTreeBitList[i] = 0;
-    
+    uint8_t codeLengthLengths[19];
+    memset(codeLengthLengths, 0, sizeof(codeLengthLengths));
     for(uint32_t i = 0; i < HCLEN; i++)
-        codeLengthTreeBitList[codeLengthCodesOrder[i]] = reader->ReadBits<uint8_t>(3);
-
-    Vector<uint32_t> codeLengthBitList;
-    Vector<uint8_t> codeLengthAlphaList;
-    for(int i = 0; i < 19; i++) {
-        codeLengthBitList.push_back(codeLengthTreeBitList[i]);
-        codeLengthAlphaList.push_back(i);
-    }
+        codeLengthLengths[codeLengthCodesOrder[i]] = reader->ReadBits<uint8_t>(3);
 
-    // Construct code length tree
-    HuffmanTree* codeLengthTree = BitListToTree(&codeLengthBitList, &codeLengthAlphaList);
+    // Construct code length table
+    HuffmanTable* codeLengthTable = new HuffmanTable();
+    bool valid = BuildTable(codeLengthTable, codeLengthLengths, 19);
 
     // Read literal/length + distance code length list
-    Vector<uint32_t> bl;
-    while (bl.Size() < HLIT + HDIST)
+    uint8_t bl[288 + 32];
+    uint32_t count = 0;
+    while (valid && count < HLIT + HDIST)
     {
-        uint32_t sym = DecodeSymbol(reader, codeLengthTree);
-        if((sym >= 0) && (sym <= 15)) { // literal value
-            bl.push_back(sym);
+        uint32_t sym = DecodeSymbol(reader, codeLengthTable);
+        if(sym <= 15) { // literal value
+            bl[count++] = sym;
+            continue;
         }
-        else if(sym == 16) {
+
+        uint8_t value = 0;
+        uint32_t repeat_length = 0;
+        if(sym == 16 && count > 0) {
             // copy the previous code length 3..6 times.
             // the next 2 bits indicate repeat length ( 0 = 3, ..., 3 = 6 )
-            uint32_t prev_code_length = bl.GetAt(bl.Size() - 1);
-            uint32_t repeat_length = reader->ReadBits<uint8_t>(2) + 3;
-            for(uint32_t i = 0; i < repeat_length; i++)
-                bl.push_back(prev_code_length);
+            value = bl[count - 1];
+            repeat_length = reader->ReadBits<uint8_t>(2) + 3;
         }
         else if(sym == 17) {
             // repeat code length 0 for 3..10 times. (3 bits of length)
-            uint32_t repeat_length = reader->ReadBits<uint8_t>(3) + 3;
-            for(uint32_t i = 0; i < repeat_length; i++)
-                bl.push_back(0);
+            repeat_length = reader->ReadBits<uint8_t>(3) + 3;
         }
         else if(sym == 18) {
             // repeat code length 0 for 11..138 times. (7 bits of length)
-            uint32_t repeat_length = reader->ReadBits<uint8_t>(7) + 11;
-            for(uint32_t i = 0; i < repeat_length; i++)
-                bl.push_back(0);
+            repeat_length = reader->ReadBits<uint8_t>(7) + 11;
         }
-        else
-            Log(Error, "[ZLIBDecompressor] Invalid symbol");
-    }
-    delete codeLengthTree;
-
-    // Construct trees
-    Vector<uint32_t> blTemp;
-    Vector<uint8_t> alphaTemp;
-    for(uint32_t i = 0; i < HLIT; i++)
-        blTemp.push_back(bl[i]);
-    
-    for(int i = 0; i < 286; i++)
-        alphaTemp.push_back(i);
-    
-    // Create first tree for the literal lengths
-    result.literalLengthTree = BitListToTree(&blTemp, &alphaTemp);
-
-    // Reset lists for re-use
-    blTemp.clear();
-    alphaTemp.clear();
 
-    for(int i = HLIT; i < bl.Size(); i++)
-        blTemp.push_back(bl[i]);
-    
-    for(int i = 0; i < 30; i++)
-        alphaTemp.push_back(i);
-
-    // Create second list
-    result.distanceTree = BitListToTree(&blTemp, &alphaTemp);
-
-    // And exit function
-    return result;
-}
-void ZLIBDecompressor::InflateBlockDynamic(BitReader* reader, Vector<uint8_t>* target)
-{
-    DecodeTreesResult ret = ZLIBDecompressor::DecodeTrees(reader);
-
-    InflateBlockData(reader, ret.literalLengthTree, ret.distanceTree, target);
-    delete ret.literalLengthTree;
-    delete ret.distanceTree;
-}
-
-void ZLIBDecompressor::InflateBlockStatic(BitReader* reader, Vector<uint8_t>* target)
-{
-    static HuffmanTree* literalLengthTree = 0;
-    static HuffmanTree* distanceTree = 0;
-
-    if(literalLengthTree == 0) {
-        Vector<uint32_t> bl1;
-        
-        Vector<uint8_t> alphaTemp;
-        for(int i = 0; i < 286; i++)
-            alphaTemp.push_back(i);
-
-        for(int i = 0; i < 144; i++)
-            bl1.push_back(8);
-        for(int i = 144; i < 256; i++)
-            bl1.push_back(9);
-        for(int i = 256; i < 280; i++)
-            bl1.push_back(7);
-        for(int i = 280; i < 288; i++)
-            bl1.push_back(8);
-        
-        literalLengthTree = BitListToTree(&bl1, &alphaTemp);
-
-        bl1.clear();
-        alphaTemp.clear();
-        for(int i = 0; i < 30; i++) {
-            bl1.push_back(5);
-            alphaTemp.push_back(i);
+        if(repeat_length == 0 || count + repeat_length > HLIT + HDIST) {
+            Log(Error, "[ZLIBDecompressor] Invalid symbol");
+            valid = false;
+            break;
         }
-
-        distanceTree = BitListToTree(&bl1, &alphaTemp);
+        for(uint32_t i = 0; i < repeat_length; i++)
+            bl[count++] = value;
     }
+    delete codeLengthTable;
+    if(!valid)
+        return false;
 
-    ZLIBDecompressor::InflateBlockData(reader, literalLengthTree, distanceTree, target);
-}
\ No newline at end of file
+    // Create the tables for the literal lengths and the distances
+    return BuildTable(literalLengthTable, bl, HLIT) && BuildTable(distanceTable, bl + HLIT, HDIST);
+}
@@ -55,4 +55,115 @@ IPCMessage LIBHeisenKernel::ICPReceive(int fromID, int* errOut, int type)
     IPCMessage result;
     DoSyscall(SYSCALL_IPC_RECEIVE, (uint32_t)&result, fromID, (uint32_t)errOut, type);
     return result;
+}
+
+int LIBHeisenKernel::FutexWait(volatile uint32_t* address, uint32_t expected)
+{
+    return DoSyscall(SYSCALL_FUTEX_WAIT, (uint32_t)address, expected);
+}
+
+int LIBHeisenKernel::FutexWake(volatile uint32_t* address, int count)
+{
+    return DoSyscall(SYSCALL_FUTEX_WAKE, (uint32_t)address, count);
+}
+
+IPCChannel::IPCChannel(void* region, uint32_t size, bool initialize)
+{
+    this->header = (IPCChannelHeader*)region;
+    this->slots = (IPCMessage*)((uint32_t)region + sizeof(IPCChannelHeader));
+
+    if(initialize) {
+        // Round the number of slots down to a power of 2 so indexing is just a mask
+        uint32_t slotCount = (size - sizeof(IPCChannelHeader)) / sizeof(IPCMessage);
+        uint32_t capacity = 1;
+        while(capacity * 2 <= slotCount)
+            capacity *= 2;
+
+        this->header->head = 0;
+        this->header->tail = 0;
+        this->header->consumerWaiting = 0;
+        this->header->producerWaiting = 0;
+        this->header->capacity = capacity;
+        __sync_synchronize();
+    }
+}
+
+bool IPCChannel::TrySend(const IPCMessage& message)
+{
+    uint32_t head = header->head;
+    if(head - header->tail == header->capacity)
+        return false;
+
+    slots[head & (header->capacity - 1)] = message;
+    
+    // The message needs to be visible before the consumer sees the new head
+    asm volatile ("" : : : "memory");
+    header->head = head + 1;
+
+    // Full barrier, the store to head may not pass the load of consumerWaiting
+    __sync_synchronize();
+    if(header->consumerWaiting) {
+        header->consumerWaiting = 0;
+        FutexWake(&header->consumerWaiting);
+    }
+    return true;
+}
+
+void IPCChannel::Send(const IPCMessage& message)
+{
+    while(!TrySend(message))
+    {
+        header->producerWaiting = 1;
+        __sync_synchronize();
+
+        // Consumer could have read a message in the meantime, retry without blocking
+        if(header->head - header->tail < header->capacity) {
+            header->producerWaiting = 0;
+            continue;
+        }
+        FutexWait(&header->producerWaiting, 1);
+    }
+}
+
+bool IPCChannel::TryReceive(IPCMessage* message)
+{
+    uint32_t tail = header->tail;
+    if(tail == header->head)
+        return false;
+    
+    *message = slots[tail & (header->capacity - 1)];
+
+    // Slot needs to be read before the producer can reuse it
+    asm volatile ("" : : : "memory");
+    header->tail = tail + 1;
+
+    __sync_synchronize();
+    if(header->producerWaiting) {
+        header->producerWaiting = 0;
+        FutexWake(&header->producerWaiting);
+    }
+    return true;
+}
+
+IPCMessage IPCChannel::Receive()
+{
+    IPCMessage result;
+    while(!TryReceive(&result))
+    {
+        header->consumerWaiting = 1;
+        __sync_synchronize();
+
+        // Producer could have added a message in the meantime
+        if(header->head != header->tail) {
+            header->consumerWaiting = 0;
+            continue;
+        }
+        FutexWait(&header->consumerWaiting, 1);
+    }
+    return result;
+}
+
+int IPCChannel::Available()
+{
+    return header->head - header->tail;
 }
\ No newline at end of file
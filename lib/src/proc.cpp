@@ -17,6 +17,7 @@
 
 #include <proc.h>
 #include <listing.h>
+#include <time.h>
 
 using namespace LIBHeisenKernel;
 
@@ -57,6 +58,10 @@ void Process::SetScheduler(bool active)
 {
     DoSyscall(SYSCALL_SET_SCHEDULER, active);
 }
+bool Process::SetPriority(int priority, int procPID, int thread)
+{
+    return DoSyscall(SYSCALL_SET_SCHEDULER, SCHEDULER_SET_PRIORITY, procPID, thread, priority);
+}
 void Process::WriteStdOut(char byte)
 {
     char bytes[1];
@@ -71,6 +76,10 @@ char Process::ReadStdIn()
 {
     return DoSyscall(SYSCALL_READ_STDIO);
 }
+int Process::ReadStdIn(char* buffer, int length)
+{
+    return DoSyscall(SYSCALL_READ_STDIO, (uint32_t)buffer, length);
+}
 void Process::BindSTDIO(int fromID, int toID)
 {
     DoSyscall(SYSCALL_REDIRECT_STDIO, fromID, toID);
@@ -86,4 +95,13 @@ bool Process::Active(int pid)
 void Process::Unblock(int procPID, int thread)
 {
     DoSyscall(SYSCALL_UNBLOCK, procPID, thread);
-}
\ No newline at end of file
+}
+int Process::TimeSinceLaunch()
+{
+    int procCount = SystemInfo::Properties["processes"].size();
+    for(int i = 0; i < procCount; i++)
+        if((int)SystemInfo::Properties["processes"][i]["pid"] == Process::ID)
+            return (int)(Time::Ticks() - (uint64_t)SystemInfo::Properties["processes"][i]["start-ticks"]);
+    
+    return 0;
+}
@@ -17,15 +17,152 @@
 
 #include <string.h>
 
+// Copies and fills of at least this size bypass the cache using non-temporal stores
+#define MEM_NONTEMPORAL_THRESHOLD (256 * 1024)
+
+// Does the cpu support non-temporal stores? -1 when not checked yet
+static int nonTemporal = -1;
+static bool UseNonTemporal(size_t size)
+{
+	if(size < MEM_NONTEMPORAL_THRESHOLD)
+		return false;
+
+	if(nonTemporal == -1) {
+		unsigned int eax, ebx, ecx, edx;
+		asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+		nonTemporal = (edx & (1 << 26)) ? 1 : 0; // SSE2
+	}
+	return nonTemporal;
+}
+
+// Copy forwards with rep movsd, and rep movsb for the remaining bytes
+static inline void CopyForward(void* dst, const void* src, unsigned int size)
+{
+	unsigned int dwords = size / 4;
+	unsigned int bytes = size % 4;
+	asm volatile("rep movsl\n\t"
+				 "movl %3, %%ecx\n\t"
+				 "rep movsb"
+				 : "+D"(dst), "+S"(src), "+c"(dwords)
+				 : "r"(bytes)
+				 : "memory");
+}
+
+// Fill with rep stosd, and rep stosb for the remaining bytes
+static inline void FillForward(void* dst, unsigned int pattern, unsigned int size)
+{
+	unsigned int dwords = size / 4;
+	unsigned int bytes = size % 4;
+	asm volatile("rep stosl\n\t"
+				 "movl %3, %%ecx\n\t"
+				 "rep stosb"
+				 : "+D"(dst), "+c"(dwords)
+				 : "a"(pattern), "r"(bytes)
+				 : "memory");
+}
+
+// Copy using movnti, which writes around the cache (SSE2)
+static void CopyNonTemporal(void* dstptr, const void* srcptr, unsigned int size)
+{
+	unsigned char* dst = (unsigned char*)dstptr;
+	const unsigned char* src = (const unsigned char*)srcptr;
+
+	// Align the destination, so the stores can be combined into full cache lines
+	unsigned int head = (16 - ((unsigned int)dst & 15)) & 15;
+	CopyForward(dst, src, head);
+	dst += head;
+	src += head;
+	size -= head;
+
+	unsigned int blocks = size / 32;
+	if(blocks) {
+		asm volatile("1:\n\t"
+					 "prefetchnta 512(%%esi)\n\t"
+					 "movl 0(%%esi), %%eax\n\t"
+					 "movl 4(%%esi), %%edx\n\t"
+					 "movnti %%eax, 0(%%edi)\n\t"
+					 "movnti %%edx, 4(%%edi)\n\t"
+					 "movl 8(%%esi), %%eax\n\t"
+					 "movl 12(%%esi), %%edx\n\t"
+					 "movnti %%eax, 8(%%edi)\n\t"
+					 "movnti %%edx, 12(%%edi)\n\t"
+					 "movl 16(%%esi), %%eax\n\t"
+					 "movl 20(%%esi), %%edx\n\t"
+					 "movnti %%eax, 16(%%edi)\n\t"
+					 "movnti %%edx, 20(%%edi)\n\t"
+					 "movl 24(%%esi), %%eax\n\t"
+					 "movl 28(%%esi), %%edx\n\t"
+					 "movnti %%eax, 24(%%edi)\n\t"
+					 "movnti %%edx, 28(%%edi)\n\t"
+					 "addl $32, %%esi\n\t"
+					 "addl $32, %%edi\n\t"
+					 "decl %%ecx\n\t"
+					 "jnz 1b\n\t"
+					 "sfence"
+					 : "+D"(dst), "+S"(src), "+c"(blocks)
+					 :
+					 : "eax", "edx", "memory");
+	}
+
+	CopyForward(dst, src, size % 32);
+}
+
+// Fill using movnti, see CopyNonTemporal
+static void FillNonTemporal(void* dstptr, unsigned int pattern, unsigned int size)
+{
+	unsigned char* dst = (unsigned char*)dstptr;
+
+	unsigned int head = (16 - ((unsigned int)dst & 15)) & 15;
+	FillForward(dst, pattern, head);
+	dst += head;
+	size -= head;
+
+	unsigned int blocks = size / 32;
+	if(blocks) {
+		asm volatile("1:\n\t"
+					 "movnti %%eax, 0(%%edi)\n\t"
+					 "movnti %%eax, 4(%%edi)\n\t"
+					 "movnti %%eax, 8(%%edi)\n\t"
+					 "movnti %%eax, 12(%%edi)\n\t"
+					 "movnti %%eax, 16(%%edi)\n\t"
+					 "movnti %%eax, 20(%%edi)\n\t"
+					 "movnti %%eax, 24(%%edi)\n\t"
+					 "movnti %%eax, 28(%%edi)\n\t"
+					 "addl $32, %%edi\n\t"
+					 "decl %%ecx\n\t"
+					 "jnz 1b\n\t"
+					 "sfence"
+					 : "+D"(dst), "+c"(blocks)
+					 : "a"(pattern)
+					 : "memory");
+	}
+
+	FillForward(dst, pattern, size % 32);
+}
+
 void* memmove(void* dstptr, const void* srcptr, size_t size) {
 	unsigned char* dst = (unsigned char*) dstptr;
 	const unsigned char* src = (const unsigned char*) srcptr;
-	if (dst < src) {
-		for (size_t i = 0; i < size; i++)
-			dst[i] = src[i];
+	if (dst <= src || dst >= src + size) {
+		// A forward copy is safe, even when the regions overlap
+		CopyForward(dst, src, size);
 	} else {
-		for (size_t i = size; i != 0; i--)
-			dst[i-1] = src[i-1];
+		// Destination starts inside the source, copy backwards from the end
+		// First the bytes that do not fit in a dword, then the dwords
+		unsigned int dwords = size / 4;
+		unsigned int bytes = size % 4;
+		dst += size - 1;
+		src += size - 1;
+		asm volatile("std\n\t"
+					 "rep movsb\n\t"
+					 "subl $3, %%esi\n\t"
+					 "subl $3, %%edi\n\t"
+					 "movl %3, %%ecx\n\t"
+					 "rep movsl\n\t"
+					 "cld"
+					 : "+D"(dst), "+S"(src), "+c"(bytes)
+					 : "r"(dwords)
+					 : "memory");
 	}
 	return dstptr;
 }
@@ -50,17 +187,19 @@ int memcmp(const void* aptr, const void* bptr, size_t size) {
 }
 
 void* memset(void* bufptr, int value, size_t size) {
-	unsigned char* buf = (unsigned char*) bufptr;
-	for (size_t i = 0; i < size; i++)
-		buf[i] = (unsigned char) value;
+	unsigned int pattern = (unsigned char)value * 0x01010101;
+	if (UseNonTemporal(size))
+		FillNonTemporal(bufptr, pattern, size);
+	else
+		FillForward(bufptr, pattern, size);
 	return bufptr;
 }
 
 void* memcpy(void* __restrict__ dstptr, const void* __restrict__ srcptr, size_t size) {
-	unsigned char* dst = (unsigned char*) dstptr;
-	const unsigned char* src = (const unsigned char*) srcptr;
-	for (size_t i = 0; i < size; i++)
-		dst[i] = src[i];
+	if (UseNonTemporal(size))
+		CopyNonTemporal(dstptr, srcptr, size);
+	else
+		CopyForward(dstptr, srcptr, size);
 	return dstptr;
 }
 
@@ -54,6 +54,22 @@ bool LIBHeisenKernel::EjectDisk(char* path)
 {
     return (bool)DoSyscall(SYSCALL_EJECT_DISK, (uint32_t)path);
 }
+int LIBHeisenKernel::OpenFile(char* path)
+{
+    return (int)DoSyscall(SYSCALL_OPEN_FILE, (uint32_t)path);
+}
+int LIBHeisenKernel::ReadFromFile(int fd, uint8_t* buffer, uint32_t len, uint32_t offset)
+{
+    return (int)DoSyscall(SYSCALL_READ_OPEN_FILE, (uint32_t)fd, (uint32_t)buffer, len, offset);
+}
+int LIBHeisenKernel::SeekFile(int fd, int offset, int whence)
+{
+    return (int)DoSyscall(SYSCALL_SEEK_FILE, (uint32_t)fd, (uint32_t)offset, (uint32_t)whence);
+}
+bool LIBHeisenKernel::CloseFile(int fd)
+{
+    return (bool)DoSyscall(SYSCALL_CLOSE_FILE, (uint32_t)fd);
+}
 List<VFSEntry> LIBHeisenKernel::DirectoryListing(char* path)
 {
     List<VFSEntry> result;